@@ -0,0 +1,108 @@
+#include "bench.h"
+#include "s6502/lib/host_time.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct bench_metric_s {
+    char* name;
+    const char* metric;
+    double value;
+} bench_metric_t;
+
+static b8 g_bench_json;
+static bench_metric_t* g_bench_metrics;
+static u32 g_bench_num_metrics;
+static u32 g_bench_metrics_capacity;
+
+// Write a string as a JSON string literal
+static void bench_write_json_string(const char* string) {
+    putchar('"');
+
+    for (const char* c = string; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            printf("\\%c", *c);
+        else if ((u8)*c < 0x20)
+            printf("\\u%04x", (u8)*c);
+        else
+            putchar(*c);
+    }
+
+    putchar('"');
+}
+
+
+double bench_now() {
+    return host_time_now();
+}
+
+void bench_set_json(b8 json) {
+    g_bench_json = json;
+}
+
+void bench_log(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vfprintf(g_bench_json ? stderr : stdout, format, args);
+    va_end(args);
+}
+
+void bench_record(const char* name, const char* metric, double value) {
+    if (g_bench_num_metrics == g_bench_metrics_capacity) {
+        g_bench_metrics_capacity = g_bench_metrics_capacity ? g_bench_metrics_capacity * 2 : 64;
+        g_bench_metrics = (bench_metric_t*)realloc(g_bench_metrics, g_bench_metrics_capacity * sizeof(bench_metric_t));
+    }
+
+    u32 length = (u32)strlen(name) + 1;
+    bench_metric_t* entry = &g_bench_metrics[g_bench_num_metrics++];
+    entry->name = (char*)malloc(length);
+    memcpy(entry->name, name, length);
+    entry->metric = metric;
+    entry->value = value;
+}
+
+void bench_finish() {
+    if (g_bench_json) {
+        // Consecutive metrics of the same benchmark are grouped into one object
+        printf("{\n  \"benchmarks\": [");
+
+        for (u32 i = 0; i < g_bench_num_metrics; i++) {
+            b8 first = i == 0 || strcmp(g_bench_metrics[i - 1].name, g_bench_metrics[i].name) != 0;
+            b8 last = i + 1 == g_bench_num_metrics || strcmp(g_bench_metrics[i + 1].name, g_bench_metrics[i].name) != 0;
+
+            if (first) {
+                printf(i ? ",\n    { \"name\": " : "\n    { \"name\": ");
+                bench_write_json_string(g_bench_metrics[i].name);
+                printf(", \"metrics\": { ");
+            }
+            else {
+                printf(", ");
+            }
+
+            bench_write_json_string(g_bench_metrics[i].metric);
+            printf(": %.6g", g_bench_metrics[i].value);
+
+            if (last)
+                printf(" } }");
+        }
+
+        printf("\n  ]\n}\n");
+    }
+
+    for (u32 i = 0; i < g_bench_num_metrics; i++)
+        free(g_bench_metrics[i].name);
+
+    free(g_bench_metrics);
+    g_bench_metrics = NULL;
+    g_bench_num_metrics = 0;
+    g_bench_metrics_capacity = 0;
+}
+
+u8 bench_on_load(pci_t* pci, u16 addr) {
+    return ((u8*)pci->data)[addr];
+}
+
+void bench_on_store(pci_t* pci, u16 addr, u8 value) {
+    ((u8*)pci->data)[addr] = value;
+}
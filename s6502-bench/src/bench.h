@@ -0,0 +1,54 @@
+#pragma once
+#include "s6502/cpu.h"
+
+// Shared benchmark infrastructure. Results are printed as they're measured, and also recorded
+// as named metrics, written out as JSON at the end with `--json` to track regressions across versions.
+
+#define BENCH_PROGRAM_ADDR  0x0200
+#define BENCH_CHUNK_CYCLES  1000
+
+// Nested loop program, also the workload of the machine pool, snapshot, event and interrupt benchmarks
+#define BENCH_HALT_ADDR     0x021a
+#define BENCH_INSTRUCTIONS  (2 + 256 * (2 + 256 * 7 + 2))
+
+extern const u8 g_bench_program[];
+extern const u32 g_bench_program_size;
+
+// A synthetic program, loaded at `BENCH_PROGRAM_ADDR`, halting on a jump or branch to itself
+typedef struct bench_program_s {
+    const char* name;
+    const u8* code;
+    u32 code_size;
+    u16 halt_addr;
+    void (*setup)(u8* memory);  // (optional) Prepares the program's data in a 64 KiB memory image
+} bench_program_t;
+
+extern const bench_program_t g_bench_programs[];
+extern const u32 g_bench_num_programs;
+
+// @returns Host time in seconds, monotonic on POSIX hosts
+double bench_now();
+
+// Select the output format. With JSON, human readable output goes to stderr instead of stdout.
+// @param[in] json
+void bench_set_json(b8 json);
+
+// Print human readable output, printf-style
+void bench_log(const char* format, ...);
+
+// Record a metric of a benchmark
+// @param[in] name Benchmark name, '/'-separated
+// @param[in] metric Metric name, including its unit
+// @param[in] value
+void bench_record(const char* name, const char* metric, double value);
+
+// Write the recorded metrics to stdout as JSON, if selected, and free them
+void bench_finish();
+
+// Callback-based RAM over `pci->data`, for comparison with memory PCI units
+u8 bench_on_load(pci_t* pci, u16 addr);
+void bench_on_store(pci_t* pci, u16 addr, u8 value);
+
+// Benchmark suites
+void bench_programs();
+void bench_bus_lookup();
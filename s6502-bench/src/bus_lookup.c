@@ -0,0 +1,99 @@
+#include "bench.h"
+
+#include <stdio.h>
+
+// Bus dispatch cost to device PCI units, by the number of units attached
+
+#define LOOKUP_ADDRESSES    4096        // Pseudo-random addresses, cycled through
+#define LOOKUP_ACCESSES     (1 << 22)
+#define LOOKUP_MAX_PCI      256
+
+static u8 bench_lookup_on_load(pci_t* pci, u16 addr) {
+    (void)pci;
+    return (u8)addr;
+}
+
+// Measures loads through the bus, with the address space split evenly between device PCI units
+// @param[in] num_pci Number of PCI units, a power of two up to `LOOKUP_MAX_PCI`
+// @param[in] aligned Place units on page boundaries. Otherwise they're shifted by half a page,
+//                    so pages holding a boundary have to search the attached units.
+// @param[in] sealed Seal the bus, see `bus_seal`
+// @param[in] addresses `LOOKUP_ADDRESSES` addresses to load from
+// @returns Nanoseconds per load
+static double bench_lookup(u32 num_pci, b8 aligned, b8 sealed, const u16* addresses) {
+    static pci_t units[LOOKUP_MAX_PCI];
+    u32 size = (BUS_ADDR_MAX + 1) / num_pci;
+    u32 shift = aligned || num_pci == 1 ? 0 : BUS_PAGE_SIZE / 2;
+
+    bus_t* bus = bus_create();
+
+    for (u32 i = 0; i < num_pci; i++) {
+        u32 start = i == 0 ? 0 : i * size + shift;
+        u32 end = i + 1 == num_pci ? BUS_ADDR_MAX : (i + 1) * size + shift - 1;
+
+        memset(&units[i], 0, sizeof(pci_t));
+        units[i].name = "Device";
+        units[i].on_load = bench_lookup_on_load;
+        bus_attach_pci(bus, &units[i], (u16)start, (u16)end);
+    }
+
+    if (sealed)
+        bus_seal(bus);
+
+    u32 checksum = 0;
+    double start = bench_now();
+
+    for (u32 i = 0; i < LOOKUP_ACCESSES; i++) {
+        u8 value = 0;
+        bus_load(bus, addresses[i % LOOKUP_ADDRESSES], &value);
+        checksum += value;
+    }
+
+    double elapsed = bench_now() - start;
+    bus_free(bus);
+
+    // Every unit returns the address' low byte, so the sum is known up front
+    u32 expected = 0;
+    for (u32 i = 0; i < LOOKUP_ACCESSES; i++)
+        expected += (u8)addresses[i % LOOKUP_ADDRESSES];
+
+    if (checksum != expected)
+        bench_log("bus lookup, %u PCI units: wrong loads\n", num_pci);
+
+    return elapsed / LOOKUP_ACCESSES * 1e9;
+}
+
+
+void bench_bus_lookup() {
+    static u16 addresses[LOOKUP_ADDRESSES];
+
+    u32 seed = 1;
+    for (u32 i = 0; i < LOOKUP_ADDRESSES; i++) {
+        seed = seed * 1103515245 + 12345;
+        addresses[i] = (u16)(seed >> 8);
+    }
+
+    static const struct {
+        const char* name;
+        b8 aligned;
+        b8 sealed;
+    } layouts[] = {
+        { "aligned", TRUE, FALSE },
+        { "unaligned", FALSE, FALSE },
+        { "unaligned sealed", FALSE, TRUE }
+    };
+
+    for (u32 l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+        for (u32 num_pci = 1; num_pci <= LOOKUP_MAX_PCI; num_pci *= 2) {
+            double ns = bench_lookup(num_pci, layouts[l].aligned, layouts[l].sealed, addresses);
+            const char* layout = layouts[l].name;
+
+            bench_log("bus lookup, %u %s PCI units: %.2f ns/access\n", num_pci, layout, ns);
+
+            char name[64];
+            snprintf(name, sizeof(name), "bus_lookup/%s%s/%u", layouts[l].aligned ? "aligned" : "unaligned",
+                layouts[l].sealed ? "_sealed" : "", num_pci);
+            bench_record(name, "ns_per_access", ns);
+        }
+    }
+}
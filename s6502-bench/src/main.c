@@ -0,0 +1,1319 @@
+#include "bench.h"
+
+#include "s6502/machine_pool.h"
+#include "s6502/snapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+    #include <unistd.h>
+#endif
+
+// Differential check of the JIT against the interpreter
+
+#define DIFF_MEMORY_END     0x0600  // Memory RAM below, callback RAM above (exercising the JIT's bus calls)
+#define DIFF_MAX_CYCLES     400000
+
+// Mixes indexed page crossings, subroutines, the stack, read-modify-write and binary and decimal
+// arithmetic on both kinds of RAM.
+// On one iteration the subroutine modifies the instruction right after its store, through a pointer
+// taken from the table at $0300.
+static const u8 g_diff_program[] = {
+    0xa2, 0x00,             // 0200: LDX #$00
+    0xa9, 0x34,             // 0202: LDA #$34
+    0x85, 0x20,             // 0204: STA $20
+    0xa9, 0x05,             // 0206: LDA #$05
+    0x85, 0x21,             // 0208: STA $21
+    0xa9, 0x46,             // 020a: LDA #$46
+    0x85, 0x30,             // 020c: STA $30
+    0xa0, 0xf0,             // 020e: LDY #$f0
+    0xbd, 0x00, 0x03,       // 0210: LDA $0300,X
+    0x85, 0x31,             // 0213: STA $31
+    0xbd, 0xf0, 0x03,       // 0215: LDA $03f0,X
+    0x20, 0x40, 0x02,       // 0218: JSR $0240
+    0x9d, 0x00, 0x04,       // 021b: STA $0400,X
+    0x91, 0x20,             // 021e: STA ($20),Y
+    0xb1, 0x20,             // 0220: LDA ($20),Y
+    0x2c, 0x00, 0x04,       // 0222: BIT $0400
+    0x08,                   // 0225: PHP
+    0x68,                   // 0226: PLA
+    0x9d, 0x00, 0x05,       // 0227: STA $0500,X
+    0xe8,                   // 022a: INX
+    0xd0, 0xe3,             // 022b: BNE $0210
+    0xf0, 0xfe              // 022d: BEQ $022d
+};
+
+#define DIFF_HALT_ADDR      0x022d
+#define DIFF_SUBROUTINE_ADDR 0x0240
+#define DIFF_TABLE_ADDR     0x0300
+#define DIFF_MODIFY_INDEX   0x80    // Iteration whose pointer targets the code
+#define DIFF_WATCH_RAM_ADDR 0x0400  // Loaded by BIT every iteration, from a page with direct memory
+#define DIFF_WATCH_CALLBACK_ADDR 0x0610 // First of the 16 bytes ROR and ADC access in callback RAM
+
+static const u8 g_diff_subroutine[] = {
+    0x8a,                   // 0240: TXA
+    0xa0, 0x00,             // 0241: LDY #$00
+    0x91, 0x30,             // 0243: STA ($30),Y
+    0xa9, 0x00,             // 0245: LDA #$00
+    0x1d, 0xf0, 0x03,       // 0247: ORA $03f0,X
+    0x0a,                   // 024a: ASL A
+    0x6a,                   // 024b: ROR A
+    0x2e, 0x00, 0x06,       // 024c: ROL $0600
+    0x5e, 0x00, 0x06,       // 024f: LSR $0600,X
+    0x38,                   // 0252: SEC
+    0x7e, 0x10, 0x06,       // 0253: ROR $0610,X
+    0xc9, 0x80,             // 0256: CMP #$80
+    0xb0, 0x02,             // 0258: BCS $025c
+    0xa9, 0x01,             // 025a: LDA #$01
+    0x79, 0x00, 0x06,       // 025c: ADC $0600,Y
+    0xf8,                   // 025f: SED
+    0x7d, 0x10, 0x06,       // 0260: ADC $0610,X
+    0xe9, 0x27,             // 0263: SBC #$27
+    0xd8,                   // 0265: CLD
+    0x48,                   // 0266: PHA
+    0x68,                   // 0267: PLA
+    0x60                    // 0268: RTS
+};
+
+typedef struct diff_machine_s {
+    u8 callback_memory[BUS_ADDR_MAX + 1];
+    pci_t* ram;
+    pci_t callback_ram;
+    bus_t* bus;
+    cpu_t* cpu;
+} diff_machine_t;
+
+static void diff_machine_init(diff_machine_t* machine, cpu_backend backend, const u8* program, u32 program_size) {
+    memset(machine, 0, sizeof(diff_machine_t));
+
+    machine->ram = pci_create_memory("RAM", DIFF_MEMORY_END, FALSE);
+    machine->callback_ram.name = "RAM (callbacks)";
+    machine->callback_ram.data = machine->callback_memory;
+    machine->callback_ram.on_load = bench_on_load;
+    machine->callback_ram.on_store = bench_on_store;
+
+    machine->bus = bus_create();
+    bus_attach_pci(machine->bus, machine->ram, 0x0000, DIFF_MEMORY_END - 1);
+    bus_attach_pci(machine->bus, &machine->callback_ram, DIFF_MEMORY_END, BUS_ADDR_MAX);
+
+    for (u32 i = 0; i < DIFF_MEMORY_END; i++)
+        machine->ram->memory[i] = (u8)(i * 7 + 3);
+    for (u32 i = DIFF_MEMORY_END; i <= BUS_ADDR_MAX; i++)
+        machine->callback_memory[i] = (u8)(i * 13 + 5);
+
+    memcpy(&machine->ram->memory[BENCH_PROGRAM_ADDR], program, program_size);
+    if (program == g_diff_program) {
+        memcpy(&machine->ram->memory[DIFF_SUBROUTINE_ADDR], g_diff_subroutine, sizeof(g_diff_subroutine));
+
+        for (u32 i = 0; i < 0x100; i++)
+            machine->ram->memory[DIFF_TABLE_ADDR + i] = (i == DIFF_MODIFY_INDEX) ? (DIFF_SUBROUTINE_ADDR >> 8) : (DIFF_MEMORY_END >> 8);
+    }
+
+    machine->callback_memory[0xfffc] = BENCH_PROGRAM_ADDR & 0xff;
+    machine->callback_memory[0xfffd] = BENCH_PROGRAM_ADDR >> 8;
+
+    cpu_config_t config = { .backend = backend };
+    machine->cpu = cpu_create_ex(machine->bus, &config);
+    cpu_reset(machine->cpu);
+}
+
+static void diff_machine_free(diff_machine_t* machine) {
+    cpu_free(machine->cpu);
+    bus_free(machine->bus);
+    pci_free(machine->ram);
+}
+
+// Watch loads from a word of RAM and every access to a few bytes of callback RAM
+static void diff_machine_watch(diff_machine_t* machine) {
+    bus_add_watchpoint(machine->bus, DIFF_WATCH_RAM_ADDR, DIFF_WATCH_RAM_ADDR + 1, BUS_WATCH_LOAD);
+    bus_add_watchpoint(machine->bus, DIFF_WATCH_CALLBACK_ADDR, DIFF_WATCH_CALLBACK_ADDR + 0xf, BUS_WATCH_LOAD | BUS_WATCH_STORE);
+}
+
+// Runs a program on both backends in chunks of `chunk_cycles`, comparing state after every chunk
+// @param[in] watched Set watchpoints (see `diff_machine_watch`), which must stop both backends at the same instruction
+// @returns True if both backends agree
+static b8 diff_program(const char* label, const u8* program, u32 program_size, u16 halt_addr, u64 chunk_cycles, b8 watched) {
+    static diff_machine_t interpreter, jit;
+
+    diff_machine_init(&interpreter, CPU_BACKEND_INTERPRETER, program, program_size);
+    diff_machine_init(&jit, CPU_BACKEND_JIT, program, program_size);
+
+    if (watched) {
+        diff_machine_watch(&interpreter);
+        diff_machine_watch(&jit);
+    }
+
+    b8 agree = TRUE;
+    u16 pc = 0;
+    u64 cycles = 0;
+
+    while (agree && pc != halt_addr && cycles < DIFF_MAX_CYCLES) {
+        u8 regs[2][5];
+        u16 pcs[2];
+        u64 all_cycles[2];
+        cpu_stop_t stops[2];
+
+        cpu_run(interpreter.cpu, chunk_cycles);
+        cpu_run(jit.cpu, chunk_cycles);
+
+        cpu_get_state(interpreter.cpu, &regs[0][0], &regs[0][1], &regs[0][2], &regs[0][3], &regs[0][4], &pcs[0], &all_cycles[0]);
+        cpu_get_state(jit.cpu, &regs[1][0], &regs[1][1], &regs[1][2], &regs[1][3], &regs[1][4], &pcs[1], &all_cycles[1]);
+        cpu_get_stop(interpreter.cpu, &stops[0]);
+        cpu_get_stop(jit.cpu, &stops[1]);
+
+        agree = memcmp(regs[0], regs[1], sizeof(regs[0])) == 0 && pcs[0] == pcs[1] && all_cycles[0] == all_cycles[1]
+            && stops[0].reason == stops[1].reason && stops[0].addr == stops[1].addr && stops[0].value == stops[1].value
+            && stops[0].access == stops[1].access;
+        if (!agree) {
+            bench_log("%s (chunk %llu%s): state differs at cycle %llu, PC 0x%04x vs 0x%04x, cycles %llu vs %llu, stop %d vs %d\n",
+                label, chunk_cycles, watched ? ", watched" : "", cycles, pcs[0], pcs[1], all_cycles[0], all_cycles[1],
+                stops[0].reason, stops[1].reason);
+        }
+
+        pc = pcs[0];
+        cycles = all_cycles[0];
+    }
+
+    if (agree && (memcmp(interpreter.ram->memory, jit.ram->memory, DIFF_MEMORY_END) != 0
+        || memcmp(interpreter.callback_memory, jit.callback_memory, sizeof(interpreter.callback_memory)) != 0)) {
+        bench_log("%s (chunk %llu): memory differs\n", label, chunk_cycles);
+        agree = FALSE;
+    }
+
+    diff_machine_free(&interpreter);
+    diff_machine_free(&jit);
+
+    return agree;
+}
+
+// @returns True if the JIT agrees with the interpreter on every program and chunk size, or isn't supported
+static b8 diff_jit() {
+    static const u64 chunks[] = { 1, 2, 7, 100, 1000, 12345 };
+    b8 agree = TRUE;
+
+    bus_t* bus = bus_create();
+    cpu_config_t config = { .backend = CPU_BACKEND_JIT };
+    cpu_t* cpu = cpu_create_ex(bus, &config);
+    b8 supported = cpu_get_backend(cpu) == CPU_BACKEND_JIT;
+    cpu_free(cpu);
+    bus_free(bus);
+
+    if (!supported)
+        return TRUE;
+
+    for (u32 i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        for (u32 j = 0; j < g_bench_num_programs; j++) {
+            const bench_program_t* program = &g_bench_programs[j];
+            agree &= diff_program(program->name, program->code, program->code_size, program->halt_addr, chunks[i], FALSE);
+        }
+
+        agree &= diff_program("mixed program", g_diff_program, sizeof(g_diff_program), DIFF_HALT_ADDR, chunks[i], FALSE);
+        agree &= diff_program("mixed program", g_diff_program, sizeof(g_diff_program), DIFF_HALT_ADDR, chunks[i], TRUE);
+    }
+
+    bench_log("JIT differential check: %s\n", agree ? "passed" : "FAILED");
+    bench_record("jit_differential_check", "passed", agree);
+    return agree;
+}
+
+
+// Machine pool scaling
+
+#define POOL_MACHINES       256
+#define POOL_CYCLES         2000000     // Per machine, enough to run the benchmark program to its halt
+
+// Runs `POOL_MACHINES` copies of the benchmark program on a pool with the given number of threads
+// @returns Aggregate emulated MHz
+static double bench_pool(u32 num_threads) {
+    pci_t* rams[POOL_MACHINES];
+
+    machine_pool_config_t config = { .num_threads = num_threads, .pin_threads = TRUE };
+    machine_pool_t* pool = machine_pool_create(&config);
+
+    for (u32 i = 0; i < POOL_MACHINES; i++) {
+        rams[i] = pci_create_memory("RAM", BUS_ADDR_MAX + 1, FALSE);
+        memcpy(&rams[i]->memory[BENCH_PROGRAM_ADDR], g_bench_program, g_bench_program_size);
+        rams[i]->memory[0xfffc] = BENCH_PROGRAM_ADDR & 0xff;
+        rams[i]->memory[0xfffd] = BENCH_PROGRAM_ADDR >> 8;
+
+        bus_t* bus = bus_create();
+        bus_attach_pci(bus, rams[i], 0x0000, BUS_ADDR_MAX);
+
+        cpu_t* cpu = cpu_create(bus);
+        cpu_reset(cpu);
+
+        machine_pool_add(pool, cpu, bus, POOL_CYCLES, NULL, NULL);
+    }
+
+    double start = bench_now();
+    machine_pool_run(pool);
+    double elapsed = bench_now() - start;
+
+    machine_pool_stats_t stats;
+    machine_pool_get_stats(pool, &stats);
+
+    double mhz = (double)POOL_CYCLES * POOL_MACHINES / elapsed * 1e-6;
+    bench_log("machine pool, %u threads: %.2f emulated MHz (%.3f s), %llu quanta, %llu steals\n",
+        num_threads, mhz, elapsed, stats.quanta, stats.steals);
+
+    char name[64];
+    snprintf(name, sizeof(name), "machine_pool/%u_threads", num_threads);
+    bench_record(name, "emulated_mhz", mhz);
+
+    machine_pool_free(pool);
+    for (u32 i = 0; i < POOL_MACHINES; i++)
+        pci_free(rams[i]);
+
+    return mhz;
+}
+
+// Measures machine pool throughput from one thread up to one per core
+static void bench_pool_scaling() {
+    // The pool picks one thread per online core by default
+    machine_pool_t* pool = machine_pool_create(NULL);
+    u32 max_threads = machine_pool_get_num_threads(pool);
+    machine_pool_free(pool);
+
+    double base = 0.0;
+
+    for (u32 num_threads = 1; ; num_threads *= 2) {
+        if (num_threads > max_threads)
+            num_threads = max_threads;
+
+        double mhz = bench_pool(num_threads);
+        if (num_threads == 1)
+            base = mhz;
+        else
+            bench_log("machine pool, %u threads: %.2fx speedup (%.0f%% of linear)\n", num_threads, mhz / base, mhz / base / num_threads * 100.0);
+
+        if (num_threads == max_threads)
+            break;
+    }
+}
+
+
+// Per-case machine reset cost
+
+#define CASE_COUNT          20000
+#define CASE_CYCLES         200     // A short run, dirtying a few pages
+
+// Creates a machine running the benchmark program, with RAM owned by its bus
+static cpu_t* bench_case_machine(bus_t** bus) {
+    pci_t* ram = pci_create_memory("RAM", BUS_ADDR_MAX + 1, FALSE);
+    memcpy(&ram->memory[BENCH_PROGRAM_ADDR], g_bench_program, g_bench_program_size);
+    ram->memory[0xfffc] = BENCH_PROGRAM_ADDR & 0xff;
+    ram->memory[0xfffd] = BENCH_PROGRAM_ADDR >> 8;
+
+    *bus = bus_create();
+    bus_attach_pci(*bus, ram, 0x0000, BUS_ADDR_MAX);
+    bus_adopt_pci(*bus, ram);
+
+    cpu_t* cpu = cpu_create(*bus);
+    cpu_reset(cpu);
+    return cpu;
+}
+
+// Compares starting each case on a freshly created machine against restoring and forking a snapshot
+static void bench_cases() {
+    bus_t* bus = NULL;
+    cpu_t* cpu = NULL;
+
+    double start = bench_now();
+    for (u32 i = 0; i < CASE_COUNT; i++) {
+        cpu = bench_case_machine(&bus);
+        cpu_run(cpu, CASE_CYCLES);
+        cpu_free(cpu);
+        bus_free(bus);
+    }
+    double recreate = bench_now() - start;
+
+    cpu = bench_case_machine(&bus);
+    snapshot_t* snapshot = snapshot_create(cpu);
+
+    start = bench_now();
+    for (u32 i = 0; i < CASE_COUNT; i++) {
+        snapshot_restore(snapshot, cpu);
+        cpu_run(cpu, CASE_CYCLES);
+    }
+    double restore = bench_now() - start;
+
+    start = bench_now();
+    for (u32 i = 0; i < CASE_COUNT; i++) {
+        bus_t* fork_bus = bus_create();
+        cpu_t* fork = snapshot_fork(snapshot, fork_bus);
+        cpu_run(fork, CASE_CYCLES);
+        cpu_free(fork);
+        bus_free(fork_bus);
+    }
+    double fork = bench_now() - start;
+
+    bench_log("cases of %u cycles: recreate %.2f us, snapshot restore %.2f us, snapshot fork %.2f us per case\n",
+        CASE_CYCLES, recreate / CASE_COUNT * 1e6, restore / CASE_COUNT * 1e6, fork / CASE_COUNT * 1e6);
+
+    bench_record("snapshot_cases", "recreate_us", recreate / CASE_COUNT * 1e6);
+    bench_record("snapshot_cases", "restore_us", restore / CASE_COUNT * 1e6);
+    bench_record("snapshot_cases", "fork_us", fork / CASE_COUNT * 1e6);
+
+    snapshot_free(snapshot);
+    cpu_free(cpu);
+    bus_free(bus);
+}
+
+
+// Device events
+
+#define TIMER_PERIOD        100     // Cycles between timer ticks
+#define TIMER_RUNS          20
+
+// A timer ticking every `TIMER_PERIOD` cycles. It sums the cycles it actually ticked at, 
+// so both ways of driving it can be checked to tick at the same instruction boundaries.
+typedef struct bench_timer_s {
+    cpu_t* cpu;
+    u64 deadline;
+    u64 ticks;
+    u64 tick_cycles;
+} bench_timer_t;
+
+static void bench_timer_tick(bench_timer_t* timer) {
+    u64 cycles = 0;
+    cpu_get_state(timer->cpu, NULL, NULL, NULL, NULL, NULL, NULL, &cycles);
+
+    timer->ticks++;
+    timer->tick_cycles += cycles;
+    timer->deadline += TIMER_PERIOD;
+}
+
+static void bench_timer_on_event(bus_t* bus, void* user, u64 deadline) {
+    bench_timer_t* timer = (bench_timer_t*)user;
+    bench_timer_tick(timer);
+    bus_schedule_event(bus, deadline + TIMER_PERIOD, bench_timer_on_event, timer);
+}
+
+// Runs the benchmark program with a timer, either polled after every instruction or scheduled on the bus
+// @returns Elapsed seconds
+static double bench_timer_run(b8 scheduled, bench_timer_t* timer) {
+    bus_t* bus = NULL;
+    cpu_t* cpu = bench_case_machine(&bus);
+    u64 cycles = 0;
+    cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, NULL, &cycles);
+
+    memset(timer, 0, sizeof(bench_timer_t));
+    timer->cpu = cpu;
+    timer->deadline = cycles + TIMER_PERIOD;
+
+    if (scheduled)
+        bus_schedule_event(bus, timer->deadline, bench_timer_on_event, timer);
+
+    u16 pc = 0;
+    double start = bench_now();
+
+    while (pc != BENCH_HALT_ADDR) {
+        if (scheduled) {
+            cpu_run(cpu, BENCH_CHUNK_CYCLES);
+        }
+        else {
+            // What `cpu_run` does, with the timer checked after every instruction
+            u64 target = cycles + BENCH_CHUNK_CYCLES;
+            while (cycles < target) {
+                cycles += cpu_step(cpu);
+                while (cycles >= timer->deadline)
+                    bench_timer_tick(timer);
+            }
+        }
+
+        cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, &pc, NULL);
+    }
+
+    double elapsed = bench_now() - start;
+
+    cpu_free(cpu);
+    bus_free(bus);
+
+    return elapsed;
+}
+
+// Compares a device polled after every instruction against one driven by scheduled events
+// @returns True if both ticked identically
+static b8 bench_events() {
+    bench_timer_t polled_timer, scheduled_timer;
+    double polled = 0.0,
+        scheduled = 0.0;
+
+    for (u32 i = 0; i < TIMER_RUNS; i++) {
+        polled += bench_timer_run(FALSE, &polled_timer);
+        scheduled += bench_timer_run(TRUE, &scheduled_timer);
+    }
+
+    double instructions = (double)BENCH_INSTRUCTIONS * TIMER_RUNS;
+    bench_log("timer every %u cycles: polled %.2f Minst/s, scheduled %.2f Minst/s, %llu ticks\n",
+        TIMER_PERIOD, instructions / polled * 1e-6, instructions / scheduled * 1e-6, scheduled_timer.ticks);
+
+    bench_record("device_events/timer", "polled_minst_per_s", instructions / polled * 1e-6);
+    bench_record("device_events/timer", "scheduled_minst_per_s", instructions / scheduled * 1e-6);
+
+    b8 agree = polled_timer.ticks == scheduled_timer.ticks && polled_timer.tick_cycles == scheduled_timer.tick_cycles;
+    if (!agree)
+        bench_log("timer ticks differ: polled %llu, scheduled %llu\n", polled_timer.ticks, scheduled_timer.ticks);
+
+    return agree;
+}
+
+
+// Interrupt latency
+
+#define IRQ_PERIOD          1000        // Cycles between interrupts
+#define IRQ_RUN_CYCLES      20000000
+#define IRQ_REPEAT          5           // Best of, host time per interrupt is a small difference
+#define IRQ_DEVICE_ADDR     0xd000      // Device page: stores acknowledge the interrupt
+#define IRQ_HIGH_ADDR       0xd100      // RAM above the device page
+#define IRQ_ENTRY_ADDR      0x0280
+#define IRQ_HANDLER_ADDR    0x0290
+
+static const u8 g_irq_entry[] = {
+    0x58,                   // 0280: CLI
+    0x4c, 0x00, 0x02        // 0281: JMP $0200
+};
+
+// Replaces the benchmark program's halt, so it keeps running the same loops
+static const u8 g_irq_restart[] = {
+    0x4c, 0x00, 0x02        // 021a: JMP $0200
+};
+
+static const u8 g_irq_handler[] = {
+    0x8d, 0x00, 0xd0,       // 0290: STA $d000
+    0x40                    // 0293: RTI
+};
+
+// Raises IRQ line 0 every `IRQ_PERIOD` cycles, and measures how long the handler takes to acknowledge it
+typedef struct bench_irq_device_s {
+    cpu_t* cpu;
+    b8 enabled;
+    u64 asserted_at;
+    u64 count;
+    u64 latency_sum;
+    u64 latency_max;
+} bench_irq_device_t;
+
+static u64 bench_irq_cycles(bench_irq_device_t* device) {
+    u64 cycles = 0;
+    cpu_get_state(device->cpu, NULL, NULL, NULL, NULL, NULL, NULL, &cycles);
+    return cycles;
+}
+
+static void bench_irq_on_event(bus_t* bus, void* user, u64 deadline) {
+    bench_irq_device_t* device = (bench_irq_device_t*)user;
+
+    device->asserted_at = bench_irq_cycles(device);
+    cpu_set_irq(device->cpu, BIT(0), TRUE);
+
+    bus_schedule_event(bus, deadline + IRQ_PERIOD, bench_irq_on_event, device);
+}
+
+static u8 bench_irq_on_load(pci_t* pci, u16 addr) {
+    (void)pci;
+    (void)addr;
+    return 0;
+}
+
+static void bench_irq_on_store(pci_t* pci, u16 addr, u8 value) {
+    bench_irq_device_t* device = (bench_irq_device_t*)pci->data;
+    (void)addr;
+    (void)value;
+
+    // The acknowledging STA was already charged its 4 cycles, the handler was entered before it
+    u64 latency = bench_irq_cycles(device) - 4 - device->asserted_at;
+    device->count++;
+    device->latency_sum += latency;
+    if (latency > device->latency_max)
+        device->latency_max = latency;
+
+    cpu_set_irq(device->cpu, BIT(0), FALSE);
+}
+
+// Runs the benchmark program for `IRQ_RUN_CYCLES`, with or without the interrupting device
+// @returns Elapsed seconds
+static double bench_irq_run(cpu_backend backend, bench_irq_device_t* device) {
+    pci_t* low = pci_create_memory("RAM", IRQ_DEVICE_ADDR, FALSE);
+    pci_t* high = pci_create_memory("RAM (high)", BUS_ADDR_MAX + 1 - IRQ_HIGH_ADDR, FALSE);
+    pci_t io = { .name = "IRQ device", .data = device, .on_load = bench_irq_on_load, .on_store = bench_irq_on_store };
+
+    memcpy(&low->memory[BENCH_PROGRAM_ADDR], g_bench_program, g_bench_program_size);
+    memcpy(&low->memory[BENCH_HALT_ADDR], g_irq_restart, sizeof(g_irq_restart));
+    memcpy(&low->memory[IRQ_ENTRY_ADDR], g_irq_entry, sizeof(g_irq_entry));
+    memcpy(&low->memory[IRQ_HANDLER_ADDR], g_irq_handler, sizeof(g_irq_handler));
+    high->memory[0xfffc - IRQ_HIGH_ADDR] = IRQ_ENTRY_ADDR & 0xff;
+    high->memory[0xfffd - IRQ_HIGH_ADDR] = IRQ_ENTRY_ADDR >> 8;
+    high->memory[0xfffe - IRQ_HIGH_ADDR] = IRQ_HANDLER_ADDR & 0xff;
+    high->memory[0xffff - IRQ_HIGH_ADDR] = IRQ_HANDLER_ADDR >> 8;
+
+    bus_t* bus = bus_create();
+    bus_attach_pci(bus, low, 0x0000, IRQ_DEVICE_ADDR - 1);
+    bus_attach_pci(bus, &io, IRQ_DEVICE_ADDR, IRQ_HIGH_ADDR - 1);
+    bus_attach_pci(bus, high, IRQ_HIGH_ADDR, BUS_ADDR_MAX);
+    bus_adopt_pci(bus, low);
+    bus_adopt_pci(bus, high);
+
+    cpu_config_t config = { .backend = backend };
+    cpu_t* cpu = cpu_create_ex(bus, &config);
+    cpu_reset(cpu);
+    device->cpu = cpu;
+
+    if (device->enabled)
+        bus_schedule_event(bus, bench_irq_cycles(device) + IRQ_PERIOD, bench_irq_on_event, device);
+
+    double start = bench_now();
+    for (u64 cycles = 0; cycles < IRQ_RUN_CYCLES; cycles += BENCH_CHUNK_CYCLES)
+        cpu_run(cpu, BENCH_CHUNK_CYCLES);
+    double elapsed = bench_now() - start;
+
+    cpu_free(cpu);
+    bus_free(bus);
+
+    return elapsed;
+}
+
+// Measures cycles from IRQ assertion to handler entry, and the host time each interrupt adds
+// @param[in] name Recorded benchmark name
+static void bench_interrupts(const char* label, const char* name, cpu_backend backend) {
+    bench_irq_device_t quiet, device;
+    double base = 0.0,
+        elapsed = 0.0;
+
+    for (u32 i = 0; i < IRQ_REPEAT; i++) {
+        memset(&quiet, 0, sizeof(quiet));
+        memset(&device, 0, sizeof(device));
+        device.enabled = TRUE;
+
+        double run = bench_irq_run(backend, &quiet);
+        base = i == 0 || run < base ? run : base;
+
+        run = bench_irq_run(backend, &device);
+        elapsed = i == 0 || run < elapsed ? run : elapsed;
+    }
+
+    if (device.count == 0) {
+        bench_log("%s: no interrupts taken\n", label);
+        return;
+    }
+
+    bench_log("%s: %llu interrupts, latency %.2f cycles avg / %llu max, %.1f ns host time each\n",
+        label, device.count, (double)device.latency_sum / device.count, device.latency_max, 
+        (elapsed - base) / device.count * 1e9);
+
+    bench_record(name, "latency_cycles", (double)device.latency_sum / device.count);
+    bench_record(name, "ns_per_interrupt", (elapsed - base) / device.count * 1e9);
+}
+
+// Instruction tracing overhead
+
+#define TRACE_PATH          "s6502-bench.trace"
+
+// Runs the benchmark program to its halt
+// @param[in] trace (optional) Trace to record into
+// @returns Seconds taken
+static double bench_trace_run(trace_t* trace) {
+    bus_t* bus = NULL;
+    cpu_t* cpu = bench_case_machine(&bus);
+    cpu_set_trace(cpu, trace);
+
+    u16 pc = 0;
+    double start = bench_now();
+
+    do {
+        cpu_run(cpu, BENCH_CHUNK_CYCLES);
+        cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, &pc, NULL);
+    } while (pc != BENCH_HALT_ADDR);
+
+    double elapsed = bench_now() - start;
+
+    cpu_set_trace(cpu, NULL);
+    cpu_free(cpu);
+    bus_free(bus);
+
+    return elapsed;
+}
+
+// Compares running untraced against tracing to a file, and checks the file decodes back to every record
+// @returns True unless the trace read back differs
+static b8 bench_tracing() {
+    double untraced = bench_trace_run(NULL);
+
+    trace_t* trace = trace_create(TRACE_PATH, 0);
+    if (trace == NULL) {
+        bench_log("tracing: can't create %s\n", TRACE_PATH);
+        return FALSE;
+    }
+
+    double start = bench_now();
+    double traced = bench_trace_run(trace);
+    u64 records = trace_get_num_records(trace);
+    u64 bytes = trace_get_num_bytes(trace);
+    trace_free(trace);
+    double drained = bench_now() - start;
+
+    if (records == 0) {
+        bench_log("tracing: not compiled in (S6502_TRACE)\n");
+        remove(TRACE_PATH);
+        return TRUE;
+    }
+
+    u64 read = 0;
+    trace_record_t record;
+    trace_reader_t* reader = trace_reader_open(TRACE_PATH);
+
+    while (reader && trace_reader_next(reader, &record))
+        read++;
+
+    if (reader)
+        trace_reader_free(reader);
+    remove(TRACE_PATH);
+
+    double instructions = (double)records;
+    bench_log("tracing: untraced %.1f Minst/s, traced %.1f Minst/s (%.1f Minst/s including the final drain), %.2f bytes/instruction%s\n",
+        instructions / untraced * 1e-6, instructions / traced * 1e-6, instructions / drained * 1e-6,
+        (double)bytes / records, read == records ? "" : " - TRACE READ BACK DIFFERS");
+
+    bench_record("tracing", "untraced_minst_per_s", instructions / untraced * 1e-6);
+    bench_record("tracing", "traced_minst_per_s", instructions / traced * 1e-6);
+    bench_record("tracing", "bytes_per_instruction", (double)bytes / records);
+
+    return read == records;
+}
+
+
+// Device input record/replay
+
+#define INPUT_LOG_PATH      "s6502-bench.input"
+#define INPUT_DEVICE_ADDR   0xd000
+#define INPUT_HALT_ADDR     0x0212
+
+// Sums 65536 loads from the input device into $10
+static const u8 g_input_program[] = {
+    0xa2, 0x00,             // 0200: LDX #$00
+    0xa0, 0x00,             // 0202: LDY #$00
+    0xad, 0x00, 0xd0,       // 0204: LDA $d000
+    0x18,                   // 0207: CLC
+    0x65, 0x10,             // 0208: ADC $10
+    0x85, 0x10,             // 020a: STA $10
+    0xe8,                   // 020c: INX
+    0xd0, 0xf5,             // 020d: BNE $0204
+    0xc8,                   // 020f: INY
+    0xd0, 0xf2,             // 0210: BNE $0204
+    0x4c, 0x12, 0x02        // 0212: JMP $0212
+};
+
+// Input device reading the host clock, so no two runs see the same values
+static u8 bench_input_on_load(pci_t* pci, u16 addr) {
+    (void)pci;
+    (void)addr;
+
+    return (u8)((u64)(bench_now() * 1e9) >> 4);
+}
+
+// Runs the input program to its halt
+// @param[in] log (optional) Input log to record into or replay
+// @param[out] sum The program's sum of its loads
+// @returns Seconds taken
+static double bench_input_run(input_log_t* log, u8* sum) {
+    pci_t* ram = pci_create_memory("RAM", INPUT_DEVICE_ADDR, FALSE);
+    memcpy(&ram->memory[BENCH_PROGRAM_ADDR], g_input_program, sizeof(g_input_program));
+
+    pci_t* vectors = pci_create_memory("Vectors", 0x100, TRUE);
+    vectors->memory[0xfc] = BENCH_PROGRAM_ADDR & 0xff;
+    vectors->memory[0xfd] = BENCH_PROGRAM_ADDR >> 8;
+
+    pci_t input = {
+        .name = "Input",
+        .on_load = bench_input_on_load,
+        .nondeterministic = TRUE
+    };
+
+    bus_t* bus = bus_create();
+    bus_attach_pci(bus, ram, 0x0000, INPUT_DEVICE_ADDR - 1);
+    bus_attach_pci(bus, &input, INPUT_DEVICE_ADDR, INPUT_DEVICE_ADDR + 0xff);
+    bus_attach_pci(bus, vectors, 0xff00, 0xffff);
+    bus_adopt_pci(bus, ram);
+    bus_adopt_pci(bus, vectors);
+    bus_set_input_log(bus, log);
+
+    cpu_t* cpu = cpu_create(bus);
+    cpu_reset(cpu);
+
+    u16 pc = 0;
+    double start = bench_now();
+
+    while (pc != INPUT_HALT_ADDR) {
+        cpu_run(cpu, BENCH_CHUNK_CYCLES);
+        cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, &pc, NULL);
+    }
+
+    double elapsed = bench_now() - start;
+    *sum = ram->memory[0x10];
+
+    cpu_free(cpu);
+    bus_free(bus);
+
+    return elapsed;
+}
+
+// Compares running with the input device against recording its loads, and replaying them
+// @returns True if the replay reproduced the recorded run without diverging
+static b8 bench_input_replay() {
+    u8 live_sum = 0,
+        recorded_sum = 0,
+        replayed_sum = 0;
+
+    double live = bench_input_run(NULL, &live_sum);
+
+    input_log_t* log = input_log_create(INPUT_LOG_PATH);
+    if (log == NULL) {
+        bench_log("input replay: can't create %s\n", INPUT_LOG_PATH);
+        return FALSE;
+    }
+
+    double recorded = bench_input_run(log, &recorded_sum);
+    u64 records = input_log_get_num_records(log);
+    input_log_free(log);
+
+    FILE* file = fopen(INPUT_LOG_PATH, "rb");
+    long bytes = 0;
+    if (file) {
+        fseek(file, 0, SEEK_END);
+        bytes = ftell(file);
+        fclose(file);
+    }
+
+    log = input_log_open(INPUT_LOG_PATH);
+    double replayed = log ? bench_input_run(log, &replayed_sum) : 0.0;
+    b8 agree = log && !input_log_get_divergence(log, NULL, NULL)
+        && input_log_get_num_records(log) == records && replayed_sum == recorded_sum;
+
+    if (log)
+        input_log_free(log);
+    remove(INPUT_LOG_PATH);
+
+    bench_log("input replay: live %.3f ms, recording %.3f ms, replaying %.3f ms, %u loads at %.2f bytes each%s\n",
+        live * 1e3, recorded * 1e3, replayed * 1e3, (u32)records, records ? (double)bytes / records : 0.0,
+        agree ? "" : " - REPLAY DIVERGED");
+
+    bench_record("input_replay", "live_ms", live * 1e3);
+    bench_record("input_replay", "recording_ms", recorded * 1e3);
+    bench_record("input_replay", "replaying_ms", replayed * 1e3);
+
+    return agree;
+}
+
+
+// Breakpoint and watchpoint overhead
+
+#define DEBUG_POINTS        4
+
+typedef enum {
+    DEBUG_NONE,
+    DEBUG_BREAKPOINTS,      // On pages the program doesn't run on
+    DEBUG_WATCHPOINTS,      // On pages the program doesn't access
+    DEBUG_WATCHED_PAGE,     // On the page the program stores to, next to the address it stores to
+    DEBUG_NUM_SETUPS
+} bench_debug_setup;
+
+// Runs the benchmark program to its halt
+// @returns Seconds taken, negative if a breakpoint or watchpoint stopped it
+static double bench_debug_run(cpu_backend backend, bench_debug_setup setup) {
+    bus_t* bus = NULL;
+    cpu_free(bench_case_machine(&bus));
+
+    cpu_config_t config = { .backend = backend };
+    cpu_t* cpu = cpu_create_ex(bus, &config);
+    cpu_reset(cpu);
+
+    for (u32 i = 0; i < DEBUG_POINTS; i++) {
+        if (setup == DEBUG_BREAKPOINTS)
+            cpu_add_breakpoint(cpu, (u16)(0x8000 + i * 0x1000));
+        else if (setup == DEBUG_WATCHPOINTS)
+            bus_add_watchpoint(bus, (u16)(0x4000 + i * 0x1000), (u16)(0x4000 + i * 0x1000 + 0xff), BUS_WATCH_LOAD | BUS_WATCH_STORE);
+        else if (setup == DEBUG_WATCHED_PAGE)
+            bus_add_watchpoint(bus, (u16)(0x0301 + i), (u16)(0x0301 + i), BUS_WATCH_STORE);
+    }
+
+    u16 pc = 0;
+    cpu_stop_t stop;
+    double start = bench_now();
+
+    do {
+        cpu_run(cpu, BENCH_CHUNK_CYCLES);
+        cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, &pc, NULL);
+        cpu_get_stop(cpu, &stop);
+    } while (pc != BENCH_HALT_ADDR && stop.reason == CPU_STOP_NONE);
+
+    double elapsed = bench_now() - start;
+
+    cpu_free(cpu);
+    bus_free(bus);
+
+    return stop.reason == CPU_STOP_NONE ? elapsed : -1;
+}
+
+// Compares running without breakpoints or watchpoints against a few set away from the program,
+// and a few on a page it stores to
+// @returns True unless one of them stopped the program
+static b8 bench_debugging(const char* label, const char* name, cpu_backend backend) {
+    static const char* const setup_names[DEBUG_NUM_SETUPS] = { "none", "breakpoints", "watchpoints", "watched_page" };
+    double minst[DEBUG_NUM_SETUPS];
+    b8 agree = TRUE;
+
+    for (u32 setup = 0; setup < DEBUG_NUM_SETUPS; setup++) {
+        double elapsed = bench_debug_run(backend, (bench_debug_setup)setup);
+        agree = agree && elapsed >= 0;
+        minst[setup] = BENCH_INSTRUCTIONS / elapsed * 1e-6;
+
+        char metric_name[64];
+        snprintf(metric_name, sizeof(metric_name), "%s/%s", name, setup_names[setup]);
+        bench_record(metric_name, "minst_per_s", minst[setup]);
+    }
+
+    bench_log("%s: %.1f Minst/s, %u breakpoints elsewhere %.1f Minst/s, %u watchpoints elsewhere %.1f Minst/s, "
+        "watchpoints on a page stored to %.1f Minst/s%s\n",
+        label, minst[DEBUG_NONE], DEBUG_POINTS, minst[DEBUG_BREAKPOINTS], DEBUG_POINTS, minst[DEBUG_WATCHPOINTS],
+        minst[DEBUG_WATCHED_PAGE], agree ? "" : " - STOPPED");
+
+    return agree;
+}
+
+
+// ROM images shared across machines
+
+#define ROM_PATH            "s6502-bench.rom"
+#define ROM_SIZE            0x8000      // Mapped at $8000-$ffff, with 2 KiB of RAM at $0000
+#define ROM_MACHINES        1000
+#define ROM_CYCLES          100
+
+// @returns Resident memory of the process in KiB, 0 where unknown
+static double bench_resident_kib() {
+#if defined(__linux__)
+    unsigned long long size = 0,
+        resident = 0;
+
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file) {
+        if (fscanf(file, "%llu %llu", &size, &resident) != 2)
+            resident = 0;
+        fclose(file);
+    }
+
+    return (double)resident * (double)sysconf(_SC_PAGESIZE) / 1024;
+#else
+    return 0.0;
+#endif
+}
+
+// Sets up machines with the ROM either read into a buffer of their own, or mapped from the image file,
+// and runs each briefly
+// @param[in] mapped
+// @param[out] us Setup and run time per machine
+// @param[out] kib Resident memory growth per machine
+static void bench_rom_machines(b8 mapped, double* us, double* kib) {
+    static bus_t* buses[ROM_MACHINES];
+    static cpu_t* cpus[ROM_MACHINES];
+
+    double resident = bench_resident_kib();
+    double start = bench_now();
+
+    for (u32 i = 0; i < ROM_MACHINES; i++) {
+        pci_t* rom = NULL;
+
+        if (mapped) {
+            rom = pci_create_rom_file("ROM", ROM_PATH);
+        }
+        else {
+            rom = pci_create_memory("ROM", ROM_SIZE, TRUE);
+            FILE* file = fopen(ROM_PATH, "rb");
+            if (fread(rom->memory, 1, ROM_SIZE, file) != ROM_SIZE)
+                bench_log("ROM images: short read\n");
+            fclose(file);
+        }
+
+        pci_t* ram = pci_create_memory("RAM", 0x0800, FALSE);
+
+        buses[i] = bus_create();
+        bus_attach_pci(buses[i], ram, 0x0000, 0x07ff);
+        bus_attach_pci(buses[i], rom, 0x8000, BUS_ADDR_MAX);
+        bus_adopt_pci(buses[i], ram);
+        bus_adopt_pci(buses[i], rom);
+
+        cpus[i] = cpu_create(buses[i]);
+        cpu_reset(cpus[i]);
+        cpu_run(cpus[i], ROM_CYCLES);
+    }
+
+    *us = (bench_now() - start) / ROM_MACHINES * 1e6;
+    *kib = (bench_resident_kib() - resident) / ROM_MACHINES;
+
+    for (u32 i = 0; i < ROM_MACHINES; i++) {
+        cpu_free(cpus[i]);
+        bus_free(buses[i]);
+    }
+}
+
+// Compares machines copying a ROM image against sharing its mapping
+static void bench_rom_images() {
+    // A loop at $8000, the reset vector pointing to it
+    static u8 image[ROM_SIZE];
+    image[0x0000] = 0x4c;
+    image[0x0001] = 0x00;
+    image[0x0002] = 0x80;
+    image[0x7ffc] = 0x00;
+    image[0x7ffd] = 0x80;
+
+    FILE* file = fopen(ROM_PATH, "wb");
+    if (file == NULL || fwrite(image, 1, ROM_SIZE, file) != ROM_SIZE) {
+        bench_log("ROM images: can't write %s\n", ROM_PATH);
+        if (file)
+            fclose(file);
+        return;
+    }
+    fclose(file);
+
+    double mapped_us, mapped_kib, copied_us, copied_kib;
+    bench_rom_machines(TRUE, &mapped_us, &mapped_kib);
+    bench_rom_machines(FALSE, &copied_us, &copied_kib);
+    remove(ROM_PATH);
+
+    bench_log("%u machines with a %u KiB ROM: copied %.2f us and %.1f KiB resident, mapped %.2f us and %.1f KiB resident per machine\n",
+        ROM_MACHINES, ROM_SIZE / 1024, copied_us, copied_kib, mapped_us, mapped_kib);
+
+    bench_record("rom_images/copied", "setup_us", copied_us);
+    bench_record("rom_images/copied", "resident_kib", copied_kib);
+    bench_record("rom_images/mapped", "setup_us", mapped_us);
+    bench_record("rom_images/mapped", "resident_kib", mapped_kib);
+}
+
+
+// Bank switching
+
+#define BANK_SIZE           0x4000      // Switched at $8000-$bfff, with RAM below and a fixed bank at $c000-$ffff
+#define BANK_COUNT          8
+#define BANK_PRG_INDEX      1           // Attachment index of the switched ROM
+#define BANK_CALLS          1000000
+#define BANK_CYCLES         4000000
+
+// Fixed bank at $c000: calls $8000 in every bank in turn, keeping what each returns at $0300,X
+static const u8 g_bank_program[] = {
+    0xa2, 0x00,             // c000: LDX #$00
+    0x8a,                   // c002: TXA
+    0x8d, 0x00, 0x50,       //       STA $5000 (mapper)
+    0x20, 0x00, 0x80,       //       JSR $8000
+    0x9d, 0x00, 0x03,       //       STA $0300,X
+    0xe8,                   //       INX
+    0xe0, BANK_COUNT,       //       CPX #BANK_COUNT
+    0xd0, 0xf1,             //       BNE $c002
+    0x4c, 0x00, 0xc0,       //       JMP $c000
+};
+
+// Switched banks at $8000: a short loop, then the bank number
+static const u8 g_bank_subroutine[] = {
+    0xa0, 0x10,             // 8000: LDY #$10
+    0x88,                   // 8002: DEY
+    0xd0, 0xfd,             //       BNE $8002
+    0xa9, 0x00,             //       LDA #bank (patched)
+    0x60,                   //       RTS
+};
+
+typedef struct bench_mapper_s {
+    bus_t* bus;
+    u64 switches;
+} bench_mapper_t;
+
+// Mapper register: the bank number stored selects the bank at $8000
+static void bench_mapper_on_store(pci_t* pci, u16 addr, u8 value) {
+    (void)addr;
+    bench_mapper_t* mapper = (bench_mapper_t*)pci->data;
+    bus_switch_bank(mapper->bus, BANK_PRG_INDEX, (value % BANK_COUNT) * BANK_SIZE);
+    mapper->switches++;
+}
+
+// Runs the bank switching program
+// @param[in] backend
+// @param[out] switches Banks switched
+// @returns Elapsed seconds, negative if a bank's subroutine returned the wrong number
+static double bench_bank_run(cpu_backend backend, u64* switches) {
+    bus_t* bus = bus_create();
+    pci_t* ram = pci_create_memory("RAM", 0x5000, FALSE);
+    pci_t* prg = pci_create_memory("PRG", BANK_SIZE * BANK_COUNT, TRUE);
+    pci_t* fixed = pci_create_memory("FIXED", BANK_SIZE, TRUE);
+    bench_mapper_t state = { .bus = bus };
+    pci_t mapper = { .name = "MAPPER", .on_store = bench_mapper_on_store, .data = &state };
+
+    for (u32 bank = 0; bank < BANK_COUNT; bank++) {
+        memcpy(&prg->memory[bank * BANK_SIZE], g_bank_subroutine, sizeof(g_bank_subroutine));
+        prg->memory[bank * BANK_SIZE + 6] = (u8)bank;
+    }
+
+    memcpy(fixed->memory, g_bank_program, sizeof(g_bank_program));
+    fixed->memory[0x3ffc] = 0x00;
+    fixed->memory[0x3ffd] = 0xc0;
+
+    bus_attach_pci(bus, ram, 0x0000, 0x4fff);
+    bus_attach_pci(bus, prg, 0x8000, 0xbfff);
+    bus_attach_pci(bus, &mapper, 0x5000, 0x5000);
+    bus_attach_pci(bus, fixed, 0xc000, BUS_ADDR_MAX);
+    bus_adopt_pci(bus, ram);
+    bus_adopt_pci(bus, prg);
+    bus_adopt_pci(bus, fixed);
+    bus_seal(bus);
+
+    cpu_config_t config = { .backend = backend };
+    cpu_t* cpu = cpu_create_ex(bus, &config);
+    cpu_reset(cpu);
+
+    double start = bench_now();
+    for (u32 i = 0; i < BANK_CYCLES / BENCH_CHUNK_CYCLES; i++)
+        cpu_run(cpu, BENCH_CHUNK_CYCLES);
+    double elapsed = bench_now() - start;
+
+    // Every bank's subroutine ran at least once
+    for (u32 bank = 0; bank < BANK_COUNT; bank++) {
+        if (ram->memory[0x0300 + bank] != bank)
+            elapsed = -1;
+    }
+
+    *switches = state.switches;
+
+    cpu_free(cpu);
+    bus_free(bus);
+
+    return elapsed;
+}
+
+// Times `bus_switch_bank` on its own, then programs switching banks as they run
+// @returns True unless a program saw the wrong bank
+static b8 bench_bank_switching() {
+    bus_t* bus = bus_create();
+    pci_t* prg = pci_create_memory("PRG", BANK_SIZE * BANK_COUNT, TRUE);
+    bus_attach_pci(bus, prg, 0x8000, 0xbfff);
+    bus_adopt_pci(bus, prg);
+
+    double start = bench_now();
+    for (u32 i = 0; i < BANK_CALLS; i++)
+        bus_switch_bank(bus, 0, (i % BANK_COUNT) * BANK_SIZE);
+    double direct = (bench_now() - start) / BANK_CALLS;
+
+    bus_free(bus);
+
+    u64 interpreter_switches = 0,
+        jit_switches = 0;
+    double interpreter = bench_bank_run(CPU_BACKEND_INTERPRETER, &interpreter_switches);
+    double jit = bench_bank_run(CPU_BACKEND_JIT, &jit_switches);
+    b8 agree = interpreter >= 0 && jit >= 0;
+
+    bench_log("bank switching (%u KiB window): %.1f ns per switch; programs switching every ~%llu cycles run at "
+        "%.1f MHz interpreted, %.1f MHz with the JIT%s\n",
+        BANK_SIZE / 1024, direct * 1e9, interpreter_switches ? (u64)BANK_CYCLES / interpreter_switches : 0,
+        BANK_CYCLES / interpreter * 1e-6, BANK_CYCLES / jit * 1e-6, agree ? "" : " - WRONG BANK SEEN");
+
+    bench_record("bank_switching", "ns_per_switch", direct * 1e9);
+    bench_record("bank_switching/interpreter", "mhz", BANK_CYCLES / interpreter * 1e-6);
+    bench_record("bank_switching/jit", "mhz", BANK_CYCLES / jit * 1e-6);
+
+    return agree;
+}
+
+
+// Cycle-accurate timing
+
+// Runs the benchmark program to its halt on the interpreter
+// @param[in] timing
+// @param[out] cycles Cycles taken
+// @param[out] state A, X, Y, SP and P at the halt
+// @returns Seconds taken
+static double bench_timing_run(cpu_timing timing, u64* cycles, u8 state[5]) {
+    pci_t* ram = pci_create_memory("RAM", BUS_ADDR_MAX + 1, FALSE);
+    memcpy(&ram->memory[BENCH_PROGRAM_ADDR], g_bench_program, g_bench_program_size);
+    ram->memory[0xfffc] = BENCH_PROGRAM_ADDR & 0xff;
+    ram->memory[0xfffd] = BENCH_PROGRAM_ADDR >> 8;
+
+    bus_t* bus = bus_create();
+    bus_attach_pci(bus, ram, 0x0000, BUS_ADDR_MAX);
+    bus_adopt_pci(bus, ram);
+
+    cpu_config_t config = {
+        .backend = CPU_BACKEND_INTERPRETER,
+        .timing = timing
+    };
+    cpu_t* cpu = cpu_create_ex(bus, &config);
+    cpu_reset(cpu);
+
+    u16 pc = 0;
+    double start = bench_now();
+
+    do {
+        cpu_run(cpu, BENCH_CHUNK_CYCLES);
+        cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, &pc, NULL);
+    } while (pc != BENCH_HALT_ADDR);
+
+    double elapsed = bench_now() - start;
+    cpu_get_state(cpu, &state[0], &state[1], &state[2], &state[3], &state[4], NULL, cycles);
+
+    cpu_free(cpu);
+    bus_free(bus);
+
+    return elapsed;
+}
+
+// Compares the fast interpreter against issuing every bus access on its own cycle
+// @returns True if both reach the halt with the same state and cycle count
+static b8 bench_timing() {
+    u64 fast_cycles = 0,
+        accurate_cycles = 0;
+    u8 fast_state[5],
+        accurate_state[5];
+
+    double fast = bench_timing_run(CPU_TIMING_FAST, &fast_cycles, fast_state);
+    double accurate = bench_timing_run(CPU_TIMING_CYCLE_ACCURATE, &accurate_cycles, accurate_state);
+    b8 agree = fast_cycles == accurate_cycles && memcmp(fast_state, accurate_state, sizeof(fast_state)) == 0;
+
+    bench_log("cycle-accurate timing: %.1f MHz fast, %.1f MHz cycle-accurate (%.2fx)%s\n",
+        fast_cycles / fast * 1e-6, accurate_cycles / accurate * 1e-6, accurate / fast,
+        agree ? "" : " - STATE OR CYCLES DIFFER");
+
+    bench_record("timing/fast", "mhz", fast_cycles / fast * 1e-6);
+    bench_record("timing/cycle_accurate", "mhz", accurate_cycles / accurate * 1e-6);
+
+    return agree;
+}
+
+
+// DMA block transfers
+
+#define DMA_SIZE            256         // A page, like sprite DMA
+#define DMA_TRANSFERS       200000
+#define DMA_SOURCE_ADDR     0x0200
+#define DMA_RAM_ADDR        0x0300
+#define DMA_DEVICE_ADDR     0x2000
+
+// Sprite memory-style device, taking stores into a buffer of its own
+typedef struct bench_dma_device_s {
+    u8 memory[DMA_SIZE];
+} bench_dma_device_t;
+
+static void bench_dma_on_store(pci_t* pci, u16 addr, u8 value) {
+    ((bench_dma_device_t*)pci->data)->memory[(addr - DMA_DEVICE_ADDR) & (DMA_SIZE - 1)] = value;
+}
+
+static void bench_dma_on_store_block(pci_t* pci, u16 addr, const u8* buffer, u32 size) {
+    memcpy(&((bench_dma_device_t*)pci->data)->memory[(addr - DMA_DEVICE_ADDR) & (DMA_SIZE - 1)], buffer, size);
+}
+
+// Copies the source page to an address `DMA_TRANSFERS` times
+// @param[in] block Through `bus_load_block`/`bus_store_block`, rather than byte by byte
+// @returns Nanoseconds per transfer
+static double bench_dma_run(bus_t* bus, u16 dest_addr, b8 block) {
+    u8 buffer[DMA_SIZE];
+    double start = bench_now();
+
+    for (u32 i = 0; i < DMA_TRANSFERS; i++) {
+        if (block) {
+            bus_load_block(bus, DMA_SOURCE_ADDR, buffer, DMA_SIZE);
+            bus_store_block(bus, dest_addr, buffer, DMA_SIZE);
+        }
+        else {
+            for (u32 j = 0; j < DMA_SIZE; j++) {
+                bus_load(bus, (u16)(DMA_SOURCE_ADDR + j), &buffer[j]);
+                bus_store(bus, (u16)(dest_addr + j), buffer[j]);
+            }
+        }
+    }
+
+    return (bench_now() - start) / DMA_TRANSFERS * 1e9;
+}
+
+// Compares copying a page byte by byte against block transfers, into RAM and into a device
+// with and without a block callback
+// @returns True if every copy arrived intact
+static b8 bench_dma() {
+    pci_t* ram = pci_create_memory("RAM", DMA_DEVICE_ADDR, FALSE);
+    for (u32 i = 0; i < DMA_SIZE; i++)
+        ram->memory[DMA_SOURCE_ADDR + i] = (u8)(i * 7 + 3);
+
+    bench_dma_device_t state;
+    pci_t device = { .name = "OAM", .data = &state, .on_store = bench_dma_on_store };
+
+    bus_t* bus = bus_create();
+    bus_attach_pci(bus, ram, 0x0000, DMA_DEVICE_ADDR - 1);
+    bus_attach_pci(bus, &device, DMA_DEVICE_ADDR, DMA_DEVICE_ADDR + DMA_SIZE - 1);
+    bus_adopt_pci(bus, ram);
+
+    const u8* source = &ram->memory[DMA_SOURCE_ADDR];
+    b8 agree = TRUE;
+
+    memset(&ram->memory[DMA_RAM_ADDR], 0, DMA_SIZE);
+    double ram_bytes = bench_dma_run(bus, DMA_RAM_ADDR, FALSE);
+    agree &= memcmp(&ram->memory[DMA_RAM_ADDR], source, DMA_SIZE) == 0;
+
+    memset(&ram->memory[DMA_RAM_ADDR], 0, DMA_SIZE);
+    double ram_block = bench_dma_run(bus, DMA_RAM_ADDR, TRUE);
+    agree &= memcmp(&ram->memory[DMA_RAM_ADDR], source, DMA_SIZE) == 0;
+
+    memset(state.memory, 0, DMA_SIZE);
+    double device_bytes = bench_dma_run(bus, DMA_DEVICE_ADDR, FALSE);
+    agree &= memcmp(state.memory, source, DMA_SIZE) == 0;
+
+    memset(state.memory, 0, DMA_SIZE);
+    double device_block_fallback = bench_dma_run(bus, DMA_DEVICE_ADDR, TRUE);
+    agree &= memcmp(state.memory, source, DMA_SIZE) == 0;
+
+    device.on_store_block = bench_dma_on_store_block;
+    memset(state.memory, 0, DMA_SIZE);
+    double device_block = bench_dma_run(bus, DMA_DEVICE_ADDR, TRUE);
+    agree &= memcmp(state.memory, source, DMA_SIZE) == 0;
+
+    bus_free(bus);
+
+    bench_log("DMA of %u bytes: to RAM %.0f ns byte by byte, %.0f ns as a block; to a device %.0f ns byte by byte, "
+        "%.0f ns as a block through on_store, %.0f ns through on_store_block%s\n",
+        DMA_SIZE, ram_bytes, ram_block, device_bytes, device_block_fallback, device_block,
+        agree ? "" : " - COPY DIFFERS");
+
+    bench_record("dma/ram_bytes", "ns_per_transfer", ram_bytes);
+    bench_record("dma/ram_block", "ns_per_transfer", ram_block);
+    bench_record("dma/device_bytes", "ns_per_transfer", device_bytes);
+    bench_record("dma/device_block_fallback", "ns_per_transfer", device_block_fallback);
+    bench_record("dma/device_block", "ns_per_transfer", device_block);
+
+    return agree;
+}
+
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            bench_set_json(TRUE);
+        }
+        else {
+            fprintf(stderr, "usage: %s [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    bench_programs();
+    bench_bus_lookup();
+    bench_pool_scaling();
+    bench_cases();
+    bench_rom_images();
+    b8 bank_agree = bench_bank_switching();
+    b8 timing_agree = bench_timing();
+    b8 dma_agree = bench_dma();
+    b8 events_agree = bench_events();
+    b8 trace_agree = bench_tracing();
+    b8 replay_agree = bench_input_replay();
+    b8 debug_agree = bench_debugging("debugging, interpreter", "debugging/interpreter", CPU_BACKEND_INTERPRETER)
+        && bench_debugging("debugging, JIT", "debugging/jit", CPU_BACKEND_JIT);
+
+    bench_interrupts("IRQ every 1000 cycles, interpreter", "interrupts/interpreter", CPU_BACKEND_INTERPRETER);
+    bench_interrupts("IRQ every 1000 cycles, JIT", "interrupts/jit", CPU_BACKEND_JIT);
+
+    b8 agree = diff_jit() && bank_agree && events_agree && trace_agree && replay_agree && debug_agree && timing_agree && dma_agree;
+    bench_finish();
+
+    return agree ? 0 : 1;
+}
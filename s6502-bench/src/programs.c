@@ -0,0 +1,375 @@
+#include "bench.h"
+
+#include <stdio.h>
+
+// Synthetic program suite, each run to completion on every backend
+
+#define PROGRAM_TARGET_INSTRUCTIONS 20000000    // Programs are repeated until they executed about this many
+#define PROGRAM_ROUNDS              3           // Best of, for stable results on noisy hosts
+
+// Nested 256x256 loop over a zeropage counter pair, halting on a branch to itself.
+// Only uses instructions with fixed cycle costs (no page crossings).
+const u8 g_bench_program[] = {
+    0xa9, 0x00,             // 0200: LDA #$00
+    0x85, 0x11,             // 0202: STA $11
+    0xa9, 0x00,             // 0204: LDA #$00
+    0x85, 0x10,             // 0206: STA $10
+    0xa5, 0x10,             // 0208: LDA $10
+    0x29, 0x0f,             // 020a: AND #$0f
+    0xaa,                   // 020c: TAX
+    0x8d, 0x00, 0x03,       // 020d: STA $0300
+    0xc9, 0x07,             // 0210: CMP #$07
+    0xc6, 0x10,             // 0212: DEC $10
+    0xd0, 0xf2,             // 0214: BNE $0208
+    0xc6, 0x11,             // 0216: DEC $11
+    0xd0, 0xea,             // 0218: BNE $0204
+    0xf0, 0xfe              // 021a: BEQ $021a
+};
+
+const u32 g_bench_program_size = sizeof(g_bench_program);
+
+// Logic and shift operations on the accumulator, 256x256 times
+static const u8 g_alu_program[] = {
+    0xa2, 0x00,             // 0200: LDX #$00
+    0xa0, 0x00,             // 0202: LDY #$00
+    0x8a,                   // 0204: TXA
+    0x49, 0x5a,             // 0205: EOR #$5a
+    0x0a,                   // 0207: ASL A
+    0x09, 0x01,             // 0208: ORA #$01
+    0x29, 0x7f,             // 020a: AND #$7f
+    0x4a,                   // 020c: LSR A
+    0x2a,                   // 020d: ROL A
+    0xc9, 0x40,             // 020e: CMP #$40
+    0x6a,                   // 0210: ROR A
+    0xe8,                   // 0211: INX
+    0xd0, 0xf0,             // 0212: BNE $0204
+    0x88,                   // 0214: DEY
+    0xd0, 0xed,             // 0215: BNE $0204
+    0x4c, 0x17, 0x02        // 0217: JMP $0217
+};
+
+// Copies 4 KiB from $1000 to $2000 through two zeropage pointers, 16 times
+static const u8 g_memcpy_program[] = {
+    0xa2, 0x10,             // 0200: LDX #$10
+    0xa9, 0x00,             // 0202: LDA #$00
+    0x85, 0x20,             // 0204: STA $20
+    0x85, 0x22,             // 0206: STA $22
+    0xa9, 0x10,             // 0208: LDA #$10
+    0x85, 0x21,             // 020a: STA $21
+    0xa9, 0x20,             // 020c: LDA #$20
+    0x85, 0x23,             // 020e: STA $23
+    0xa0, 0x00,             // 0210: LDY #$00
+    0xb1, 0x20,             // 0212: LDA ($20),Y
+    0x91, 0x22,             // 0214: STA ($22),Y
+    0xc8,                   // 0216: INY
+    0xd0, 0xf9,             // 0217: BNE $0212
+    0xe6, 0x21,             // 0219: INC $21
+    0xe6, 0x23,             // 021b: INC $23
+    0xa5, 0x21,             // 021d: LDA $21
+    0xc9, 0x20,             // 021f: CMP #$20
+    0xd0, 0xef,             // 0221: BNE $0212
+    0xca,                   // 0223: DEX
+    0xd0, 0xdc,             // 0224: BNE $0202
+    0x4c, 0x26, 0x02        // 0226: JMP $0226
+};
+
+// Walks a table of 128 record pointers at $0400, folding each 8 byte record with EOR ($30),Y, 64 times
+static const u8 g_table_walk_program[] = {
+    0xa9, 0x40,             // 0200: LDA #$40
+    0x85, 0x10,             // 0202: STA $10
+    0xa2, 0x00,             // 0204: LDX #$00
+    0xbd, 0x00, 0x04,       // 0206: LDA $0400,X
+    0x85, 0x30,             // 0209: STA $30
+    0xbd, 0x01, 0x04,       // 020b: LDA $0401,X
+    0x85, 0x31,             // 020e: STA $31
+    0xa0, 0x07,             // 0210: LDY #$07
+    0xa9, 0x00,             // 0212: LDA #$00
+    0x51, 0x30,             // 0214: EOR ($30),Y
+    0x88,                   // 0216: DEY
+    0x10, 0xfb,             // 0217: BPL $0214
+    0x9d, 0x00, 0x05,       // 0219: STA $0500,X
+    0xe8,                   // 021c: INX
+    0xe8,                   // 021d: INX
+    0xd0, 0xe6,             // 021e: BNE $0206
+    0xc6, 0x10,             // 0220: DEC $10
+    0xd0, 0xe0,             // 0222: BNE $0204
+    0x4c, 0x24, 0x02        // 0224: JMP $0224
+};
+
+// Branches on the bits of an 8-bit LFSR, 256x256 times
+static const u8 g_branch_program[] = {
+    0xa9, 0x01,             // 0200: LDA #$01
+    0x85, 0x10,             // 0202: STA $10
+    0xa2, 0x00,             // 0204: LDX #$00
+    0xa0, 0x00,             // 0206: LDY #$00
+    0xa5, 0x10,             // 0208: LDA $10
+    0x4a,                   // 020a: LSR A
+    0x90, 0x02,             // 020b: BCC $020f
+    0x49, 0xb8,             // 020d: EOR #$b8
+    0x85, 0x10,             // 020f: STA $10
+    0x24, 0x10,             // 0211: BIT $10
+    0x30, 0x04,             // 0213: BMI $0219
+    0x70, 0x04,             // 0215: BVS $021b
+    0xe6, 0x11,             // 0217: INC $11
+    0xe6, 0x12,             // 0219: INC $12
+    0xca,                   // 021b: DEX
+    0xd0, 0xea,             // 021c: BNE $0208
+    0x88,                   // 021e: DEY
+    0xd0, 0xe7,             // 021f: BNE $0208
+    0x4c, 0x21, 0x02        // 0221: JMP $0221
+};
+
+// Calls three nested subroutines saving registers on the stack, 256x256 times
+static const u8 g_stack_program[] = {
+    0xa0, 0x00,             // 0200: LDY #$00
+    0xa9, 0x00,             // 0202: LDA #$00
+    0x85, 0x10,             // 0204: STA $10
+    0x20, 0x40, 0x02,       // 0206: JSR $0240
+    0x88,                   // 0209: DEY
+    0xd0, 0xfa,             // 020a: BNE $0206
+    0xc6, 0x10,             // 020c: DEC $10
+    0xd0, 0xf6,             // 020e: BNE $0206
+    0x4c, 0x10, 0x02,       // 0210: JMP $0210
+
+    [0x40] =
+    0x48,                   // 0240: PHA
+    0x20, 0x50, 0x02,       // 0241: JSR $0250
+    0x68,                   // 0244: PLA
+    0x60,                   // 0245: RTS
+
+    [0x50] =
+    0x08,                   // 0250: PHP
+    0x48,                   // 0251: PHA
+    0x20, 0x60, 0x02,       // 0252: JSR $0260
+    0x68,                   // 0255: PLA
+    0x28,                   // 0256: PLP
+    0x60,                   // 0257: RTS
+
+    [0x60] =
+    0xba,                   // 0260: TSX
+    0x48,                   // 0261: PHA
+    0x68,                   // 0262: PLA
+    0x60                    // 0263: RTS
+};
+
+// Adds a 24-bit number to a running total and subtracts it from a 16-bit one, 256x256 times.
+// Runs in binary mode as is, `bench_decimal_setup` turns the CLD into a SED.
+static const u8 g_arith_program[] = {
+    0xd8,                   // 0200: CLD
+    0xa0, 0x00,             // 0201: LDY #$00
+    0xa2, 0x00,             // 0203: LDX #$00
+    0x18,                   // 0205: CLC
+    0xa5, 0x10,             // 0206: LDA $10
+    0x65, 0x20,             // 0208: ADC $20
+    0x85, 0x10,             // 020a: STA $10
+    0xa5, 0x11,             // 020c: LDA $11
+    0x65, 0x21,             // 020e: ADC $21
+    0x85, 0x11,             // 0210: STA $11
+    0xa5, 0x12,             // 0212: LDA $12
+    0x65, 0x22,             // 0214: ADC $22
+    0x85, 0x12,             // 0216: STA $12
+    0x38,                   // 0218: SEC
+    0xa5, 0x14,             // 0219: LDA $14
+    0xe5, 0x20,             // 021b: SBC $20
+    0x85, 0x14,             // 021d: STA $14
+    0xa5, 0x15,             // 021f: LDA $15
+    0xe5, 0x21,             // 0221: SBC $21
+    0x85, 0x15,             // 0223: STA $15
+    0xca,                   // 0225: DEX
+    0xd0, 0xdd,             // 0226: BNE $0205
+    0x88,                   // 0228: DEY
+    0xd0, 0xda,             // 0229: BNE $0205
+    0x4c, 0x2b, 0x02        // 022b: JMP $022b
+};
+
+// The number to add, with valid BCD digits
+static void bench_arith_setup(u8* memory) {
+    memory[0x20] = 0x37;
+    memory[0x21] = 0x15;
+    memory[0x22] = 0x02;
+}
+
+static void bench_decimal_setup(u8* memory) {
+    bench_arith_setup(memory);
+    memory[BENCH_PROGRAM_ADDR] = 0xf8;  // SED
+}
+
+// Source data for the copy
+static void bench_memcpy_setup(u8* memory) {
+    for (u32 i = 0; i < 0x1000; i++)
+        memory[0x1000 + i] = (u8)(i * 7 + 1);
+}
+
+// Pointers to records scattered over $1000-$4fff, some crossing pages
+static void bench_table_walk_setup(u8* memory) {
+    for (u32 i = 0; i < 128; i++) {
+        u32 record = 0x1000 + ((i * 0x01a7) & 0x3fff);
+        memory[0x0400 + i * 2] = (u8)record;
+        memory[0x0401 + i * 2] = (u8)(record >> 8);
+    }
+
+    u32 seed = 1;
+    for (u32 i = 0x1000; i < 0x5008; i++) {
+        seed = seed * 1103515245 + 12345;
+        memory[i] = (u8)(seed >> 16);
+    }
+}
+
+const bench_program_t g_bench_programs[] = {
+    { "nested_loop", g_bench_program, sizeof(g_bench_program), BENCH_HALT_ADDR, NULL },
+    { "alu", g_alu_program, sizeof(g_alu_program), 0x0217, NULL },
+    { "memcpy", g_memcpy_program, sizeof(g_memcpy_program), 0x0226, bench_memcpy_setup },
+    { "table_walk", g_table_walk_program, sizeof(g_table_walk_program), 0x0224, bench_table_walk_setup },
+    { "branch", g_branch_program, sizeof(g_branch_program), 0x0221, NULL },
+    { "stack", g_stack_program, sizeof(g_stack_program), 0x0210, NULL },
+    { "arith_binary", g_arith_program, sizeof(g_arith_program), 0x022b, bench_arith_setup },
+    { "arith_decimal", g_arith_program, sizeof(g_arith_program), 0x022b, bench_decimal_setup }
+};
+
+const u32 g_bench_num_programs = sizeof(g_bench_programs) / sizeof(g_bench_programs[0]);
+
+// Load a program into a 64 KiB memory image, with the reset vector pointing at it
+static void bench_program_load(const bench_program_t* program, u8* memory) {
+    memset(memory, 0, BUS_ADDR_MAX + 1);
+    memcpy(&memory[BENCH_PROGRAM_ADDR], program->code, program->code_size);
+
+    if (program->setup)
+        program->setup(memory);
+
+    memory[0xfffc] = BENCH_PROGRAM_ADDR & 0xff;
+    memory[0xfffd] = BENCH_PROGRAM_ADDR >> 8;
+}
+
+// @param[in] variant CPU variant to run the program on
+// @returns Number of instructions a program executes up to its halt
+static u64 bench_program_count(const bench_program_t* program, cpu_variant variant) {
+    pci_t* ram = pci_create_memory("RAM", BUS_ADDR_MAX + 1, FALSE);
+    bench_program_load(program, ram->memory);
+
+    bus_t* bus = bus_create();
+    bus_attach_pci(bus, ram, 0x0000, BUS_ADDR_MAX);
+    bus_adopt_pci(bus, ram);
+
+    cpu_config_t config = { .variant = variant };
+    cpu_t* cpu = cpu_create_ex(bus, &config);
+    cpu_reset(cpu);
+
+    u64 count = 0;
+    u16 pc = BENCH_PROGRAM_ADDR;
+
+    for (; pc != program->halt_addr; count++) {
+        cpu_step(cpu);
+        cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, &pc, NULL);
+    }
+
+    cpu_free(cpu);
+    bus_free(bus);
+
+    return count;
+}
+
+// Runs a program to completion repeatedly, for about `PROGRAM_TARGET_INSTRUCTIONS` in total, best of `PROGRAM_ROUNDS`
+// @param[in] variant Printed and recorded name of the machine configuration
+// @param[in] config CPU backend and variant
+// @param[in] ram PCI unit to map over the whole address space
+// @param[in] memory Host memory backing `ram`
+// @param[in] instructions Instructions per run, see `bench_program_count`
+static void bench_program_run(const bench_program_t* program, const char* variant, const cpu_config_t* config, pci_t* ram, u8* memory, u64 instructions) {
+    bench_program_load(program, memory);
+
+    bus_t* bus = bus_create();
+    bus_attach_pci(bus, ram, 0x0000, BUS_ADDR_MAX);
+
+    cpu_t* cpu = cpu_create_ex(bus, config);
+
+    if (cpu_get_backend(cpu) != config->backend) {
+        bench_log("%s, %s: backend not supported on this host\n", program->name, variant);
+        cpu_free(cpu);
+        bus_free(bus);
+        return;
+    }
+
+    u32 repeat = instructions < PROGRAM_TARGET_INSTRUCTIONS ? (u32)(PROGRAM_TARGET_INSTRUCTIONS / instructions) : 1;
+    u64 cycles = 0;
+    double elapsed = 0.0;
+
+    for (u32 round = 0; round < PROGRAM_ROUNDS; round++) {
+        // Programs are deterministic, every round runs the same cycles
+        cycles = 0;
+        double start = bench_now();
+
+        for (u32 i = 0; i < repeat; i++) {
+            u16 pc = 0;
+            u64 run_start = 0,
+                run_end = 0;
+
+            cpu_reset(cpu);
+            cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, &pc, &run_start);
+
+            while (pc != program->halt_addr) {
+                cpu_run(cpu, BENCH_CHUNK_CYCLES);
+                cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, &pc, NULL);
+            }
+
+            cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, NULL, &run_end);
+            cycles += run_end - run_start;
+        }
+
+        double round_elapsed = bench_now() - start;
+        if (round == 0 || round_elapsed < elapsed)
+            elapsed = round_elapsed;
+    }
+
+    double minst = (double)instructions * repeat / elapsed * 1e-6;
+    double mhz = (double)cycles / elapsed * 1e-6;
+
+    cpu_decode_cache_stats_t stats;
+    cpu_get_decode_cache_stats(cpu, &stats);
+
+    bench_log("%s, %s: %.2f Minst/s, %.2f emulated MHz (%.3f s), predecode hits %llu / misses %llu\n",
+        program->name, variant, minst, mhz, elapsed, stats.hits, stats.misses);
+
+    char name[64];
+    snprintf(name, sizeof(name), "program/%s/%s", program->name, variant);
+    bench_record(name, "minst_per_s", minst);
+    bench_record(name, "emulated_mhz", mhz);
+
+    cpu_free(cpu);
+    bus_free(bus);
+}
+
+
+void bench_programs() {
+    static u8 callback_memory[BUS_ADDR_MAX + 1];
+    pci_t callback_ram = {
+        .name = "RAM (callbacks)",
+        .data = callback_memory,
+        .on_load = bench_on_load,
+        .on_store = bench_on_store
+    };
+
+    cpu_config_t interpreter = { .backend = CPU_BACKEND_INTERPRETER };
+    cpu_config_t jit = { .backend = CPU_BACKEND_JIT };
+    cpu_config_t interpreter_65c02 = { .backend = CPU_BACKEND_INTERPRETER, .variant = CPU_VARIANT_65C02 };
+    cpu_config_t interpreter_2a03 = { .backend = CPU_BACKEND_INTERPRETER, .variant = CPU_VARIANT_2A03 };
+
+    pci_t* ram = pci_create_memory("RAM", BUS_ADDR_MAX + 1, FALSE);
+
+    for (u32 i = 0; i < g_bench_num_programs; i++) {
+        const bench_program_t* program = &g_bench_programs[i];
+        u64 instructions = bench_program_count(program, CPU_VARIANT_NMOS);
+
+        // Callback RAM is only worth comparing once
+        if (i == 0)
+            bench_program_run(program, "interpreter_callback_ram", &interpreter, &callback_ram, callback_memory, instructions);
+
+        bench_program_run(program, "interpreter", &interpreter, ram, ram->memory, instructions);
+        bench_program_run(program, "jit", &jit, ram, ram->memory, instructions);
+
+        // The same programs on the other variants, which specialize away each other's quirks
+        bench_program_run(program, "interpreter_65c02", &interpreter_65c02, ram, ram->memory, bench_program_count(program, CPU_VARIANT_65C02));
+        bench_program_run(program, "interpreter_2a03", &interpreter_2a03, ram, ram->memory, bench_program_count(program, CPU_VARIANT_2A03));
+    }
+
+    pci_free(ram);
+}
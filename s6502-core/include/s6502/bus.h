@@ -1,12 +1,60 @@
 #pragma once
+#include "s6502/input_log.h"
 #include "s6502/pci.h"
 
+#include <stdio.h>
+
 // Maximum length of addressable memory
 #define BUS_ADDR_MAX 0xffff
 
+// Granularity of the bus page table, as a power of two. Pages entirely covered by a single PCI unit 
+// are dispatched with one table lookup, anything else falls back to searching the attached ranges.
+#ifndef BUS_PAGE_BITS
+#define BUS_PAGE_BITS 8
+#endif
+
+#define BUS_PAGE_SIZE (1 << BUS_PAGE_BITS)
+#define BUS_PAGE_COUNT ((BUS_ADDR_MAX + 1) >> BUS_PAGE_BITS)
+#define BUS_PAGE_MASK (BUS_PAGE_SIZE - 1)
+
 // 6502 Address Bus
 typedef struct bus_s bus_t;
 
+// Invoked before a page marked with `bus_mark_code_page` is modified
+// @param[in] user User pointer given to `bus_set_invalidate_callback`
+// @param[in] page Index of the page being modified
+typedef void (*bus_on_invalidate_fn)(void* user, u32 page);
+
+// Access kinds a watchpoint covers, see `bus_add_watchpoint`
+#define BUS_WATCH_LOAD BIT(0)
+#define BUS_WATCH_STORE BIT(1)
+
+// Invoked after a load or store through the bus to an address covered by a watchpoint
+// @param[in] user User pointer given to `bus_set_watch_callback`
+// @param[in] addr Address accessed
+// @param[in] value Value loaded or stored
+// @param[in] access `BUS_WATCH_LOAD` or `BUS_WATCH_STORE`
+typedef void (*bus_on_watch_fn)(void* user, u16 addr, u8 value, u32 access);
+
+// Invoked once the CPU's cycle counter reaches an event's deadline, see `bus_schedule_event`
+// @param[in] bus The address bus the event was scheduled on
+// @param[in] user User pointer given to `bus_schedule_event`
+// @param[in] deadline The cycle the event was scheduled for
+typedef void (*bus_on_event_fn)(bus_t* bus, void* user, u64 deadline);
+
+// Load and store counters
+typedef struct bus_access_counts_s {
+    u64 loads;
+    u64 stores;
+} bus_access_counts_t;
+
+// How profiled accesses were dispatched
+typedef struct bus_profile_stats_s {
+    u64 page_hits;      // Resolved through the page table
+    u64 range_searches; // Searched the attached ranges, on pages shared by several PCI units or unmapped
+    u64 unmapped;       // No PCI unit is attached at the address
+} bus_profile_stats_t;
+
 // @returns New address bus instance
 bus_t* bus_create();
 
@@ -15,13 +63,84 @@ bus_t* bus_create();
 void bus_free(bus_t* bus);
 
 // Attaches a PCI unit to the address bus. Attached PCI units must have discrete address mappings. 
+// Memory-backed PCI units must be large enough to cover the whole address range.
 // @param[in] bus The address bus to attach the PCI to
 // @param[in] pci The PCI unit to attach
 // @param[in] addr_start The PCI unit's start address
 // @param[in] addr_end The PCI unit's end address
-// @returns True on success, false on failure (address range overlap)
+// @returns True on success, false on failure (address range overlap, or memory too small)
 b8 bus_attach_pci(bus_t* bus, pci_t* pci, u16 addr_start, u16 addr_end);
 
+// Attaches a PCI unit decoding only the low address bits, so its first `mirror_size` bytes repeat throughout
+// the address range (e.g. 2 KiB of RAM at $0000-$1fff, or 8 bytes of device registers at $2000-$3fff).
+// Device callbacks get the address within the first mirror, and memory-backed PCI units only need to
+// cover the first mirror. Mirrors of whole pages of memory are dispatched directly like any other page.
+// @param[in] bus The address bus to attach the PCI to
+// @param[in] pci The PCI unit to attach
+// @param[in] addr_start The PCI unit's start address
+// @param[in] addr_end The PCI unit's end address
+// @param[in] mirror_size Size of the repeating window, a power of two up to `BUS_ADDR_MAX + 1` (no mirroring)
+// @returns True on success, false on failure (address range overlap, or memory too small)
+b8 bus_attach_pci_mirrored(bus_t* bus, pci_t* pci, u16 addr_start, u16 addr_end, u32 mirror_size);
+
+// Compile the attached address ranges into a lookup per page, so accesses to pages shared by several
+// PCI units only scan the few ranges overlapping the page, rather than binary searching all of them.
+// Meant to be called once the machine is set up. Attaching another PCI unit unseals the bus.
+// @param[in] bus Address bus instance
+void bus_seal(bus_t* bus);
+
+// @param[in] bus Address bus instance
+// @returns True if the bus is sealed, see `bus_seal`
+b8 bus_is_sealed(bus_t* bus);
+
+// Find the PCI units attached within an address range, in address order
+// @param[in] bus Address bus instance
+// @param[in] addr_start Start of the range
+// @param[in] addr_end End of the range (inclusive)
+// @param[out] pci (optional) The first `max_pci` PCI units overlapping the range
+// @param[out] pci_start (optional) The addresses they're attached at
+// @param[in] max_pci Capacity of `pci` and `pci_start`
+// @returns Number of PCI units overlapping the range, which may exceed `max_pci`
+u32 bus_query_pci(bus_t* bus, u16 addr_start, u16 addr_end, pci_t** pci, u16* pci_start, u32 max_pci);
+
+// Transfers ownership of a PCI unit to the address bus, which frees it along with itself
+// @param[in] bus Address bus instance
+// @param[in] pci PCI unit created by one of the `pci_create_*` functions
+void bus_adopt_pci(bus_t* bus, pci_t* pci);
+
+// @param[in] bus Address bus instance
+// @returns Number of attached PCI units
+u32 bus_get_num_pci(bus_t* bus);
+
+// Get an attached PCI unit, in attachment order
+// @param[in] bus Address bus instance
+// @param[in] index Attachment index, below `bus_get_num_pci`
+// @param[out] addr_start (optional) The PCI unit's start address
+// @param[out] addr_end (optional) The PCI unit's end address
+// @returns The PCI unit, or NULL if the index is out of range
+pci_t* bus_get_pci(bus_t* bus, u32 index, u16* addr_start, u16* addr_end);
+
+// @param[in] bus Address bus instance
+// @param[in] index Attachment index, see `bus_get_pci`
+// @returns Mirror size the PCI unit was attached with, `BUS_ADDR_MAX + 1` if it isn't mirrored
+u32 bus_get_pci_mirror_size(bus_t* bus, u32 index);
+
+// Switch the bank a memory PCI unit's attachment shows, as cartridge mappers do: remap the attached range
+// to start at another offset of the unit's backing buffer (which may be any size the range fits in).
+// Costs a pointer update per page of the range, and invalidates code decoded from those pages.
+// Mirrors of a mirrored attachment all switch together. Code decoded through one attachment isn't 
+// invalidated by stores through another attachment showing the same bank.
+// @param[in] bus Address bus instance
+// @param[in] index Attachment index, see `bus_get_pci`
+// @param[in] offset Offset into the backing buffer of the range's first byte
+// @returns True on success, false if the PCI unit isn't memory-backed or the range doesn't fit at the offset
+b8 bus_switch_bank(bus_t* bus, u32 index, u32 offset);
+
+// @param[in] bus Address bus instance
+// @param[in] index Attachment index, see `bus_get_pci`
+// @returns The attachment's offset into its backing buffer, see `bus_switch_bank`
+u32 bus_get_bank(bus_t* bus, u32 index);
+
 // Attempts to load an 8-bit unsigned value from the address bus
 // @param[in] bus Address bus instance
 // @param[in] addr Where to load the value from on the bus
@@ -34,4 +153,200 @@ b8 bus_load(bus_t* bus, u16 addr, u8* load);
 // @param[in] addr Where to store the value on the bus
 // @param[in] value The value to store
 // @returns True on success, false on failure
-b8 bus_store(bus_t* bus, u16 addr, u8 value);
\ No newline at end of file
+b8 bus_store(bus_t* bus, u16 addr, u8 value);
+
+// Loads a block from consecutive addresses, as DMA devices do. Each page is resolved once: memory is copied 
+// directly, devices with an `on_load_block` callback get whole runs, and anything else (other devices, 
+// watched or profiled pages, pages shared by several PCI units) goes through `bus_load` byte by byte.
+// Every byte is loaded at the current cycle. Addresses wrap around past `BUS_ADDR_MAX`.
+// @param[in] bus Address bus instance
+// @param[in] addr First address to load from
+// @param[out] buffer Where to load `size` bytes
+// @param[in] size Number of bytes, at most `BUS_ADDR_MAX + 1`
+// @returns True on success, false if any byte failed to load (see `bus_load`)
+b8 bus_load_block(bus_t* bus, u16 addr, u8* buffer, u32 size);
+
+// Stores a block to consecutive addresses, see `bus_load_block`. Stores to memory invalidate decoded 
+// instructions and mark pages dirty like `bus_store` does, and stores to read-only memory are dropped.
+// @param[in] bus Address bus instance
+// @param[in] addr First address to store to
+// @param[in] buffer `size` bytes to store
+// @param[in] size Number of bytes, at most `BUS_ADDR_MAX + 1`
+// @returns True on success, false if any byte failed to store (see `bus_store`)
+b8 bus_store_block(bus_t* bus, u16 addr, const u8* buffer, u32 size);
+
+// Get the direct host memory table for loads. Each entry points to the first byte of a bus page
+// backed by a memory PCI unit, or is NULL where a load must go through `bus_load`.
+// The table lives as long as the bus does, and reflects later attachments.
+// @param[in] bus Address bus instance
+// @returns Table of `BUS_PAGE_COUNT` page pointers
+u8* const* bus_get_load_pages(bus_t* bus);
+
+// Get the direct host memory table for stores, see `bus_get_load_pages`. Read-only pages are NULL.
+// @param[in] bus Address bus instance
+// @returns Table of `BUS_PAGE_COUNT` page pointers
+u8* const* bus_get_store_pages(bus_t* bus);
+
+// Sets the listener notified when a page holding decoded instructions is modified. 
+// A bus has a single listener, normally the CPU attached to it.
+// @param[in] bus Address bus instance
+// @param[in] on_invalidate (optional) Callback, NULL to remove
+// @param[in] user (optional) Passed back to the callback
+void bus_set_invalidate_callback(bus_t* bus, bus_on_invalidate_fn on_invalidate, void* user);
+
+// Watches an address range for loads and/or stores through the bus, notifying the watch listener after each.
+// Only the pages a watchpoint overlaps lose their direct host memory pointers, so accesses anywhere else cost
+// nothing extra. Watchpoints match bus addresses, so a store to one mirror doesn't match a watchpoint on another.
+// @param[in] bus Address bus instance
+// @param[in] addr_start First address watched
+// @param[in] addr_end Last address watched
+// @param[in] access `BUS_WATCH_LOAD`, `BUS_WATCH_STORE` or both
+// @returns Watchpoint ID for `bus_remove_watchpoint`, never 0
+u32 bus_add_watchpoint(bus_t* bus, u16 addr_start, u16 addr_end, u32 access);
+
+// Removes a watchpoint, giving its pages their direct host memory pointers back if no other watchpoint is left on them
+// @param[in] bus Address bus instance
+// @param[in] watchpoint Watchpoint ID returned by `bus_add_watchpoint`
+// @returns True if the watchpoint was still set
+b8 bus_remove_watchpoint(bus_t* bus, u32 watchpoint);
+
+// Sets the listener notified of accesses covered by watchpoints. A bus has a single listener,
+// normally the CPU attached to it, which then stops running (see `cpu_get_stop`).
+// @param[in] bus Address bus instance
+// @param[in] on_watch (optional) Callback, NULL to remove
+// @param[in] user (optional) Passed back to the callback
+void bus_set_watch_callback(bus_t* bus, bus_on_watch_fn on_watch, void* user);
+
+// Marks a page as holding decoded instructions. Its store pointer is withdrawn, so the next store 
+// to the page goes through `bus_store`, which invokes the invalidate callback and clears the mark.
+// @param[in] bus Address bus instance
+// @param[in] page Index of the page
+void bus_mark_code_page(bus_t* bus, u32 page);
+
+// Starts tracking which pages of writable memory get stored to. Store pointers are withdrawn, 
+// so the first store to each page goes through `bus_store` and marks it dirty. 
+// Writes straight to a memory PCI unit's buffer aren't tracked.
+// @param[in] bus Address bus instance
+// @returns New tracking generation, identifying this call
+u32 bus_track_dirty_pages(bus_t* bus);
+
+// @param[in] bus Address bus instance
+// @returns Generation returned by the last `bus_track_dirty_pages` call
+u32 bus_get_dirty_generation(bus_t* bus);
+
+// @param[in] bus Address bus instance
+// @param[in] page Index of the page
+// @returns True if the page was stored to since `bus_track_dirty_pages`
+b8 bus_test_dirty_page(bus_t* bus, u32 page);
+
+// Overwrites a whole page of memory, regardless of it being read-only, and invalidates decoded 
+// instructions on it. Ends sharing of the page. Pages of ROM images (`pci_create_rom_file`) are left 
+// as they are.
+// @param[in] bus Address bus instance
+// @param[in] page Index of a page backed by a memory PCI unit
+// @param[in] source `BUS_PAGE_SIZE` bytes to copy
+void bus_write_page(bus_t* bus, u32 page, const u8* source);
+
+// Get the current contents of a page of memory. Unlike `bus_get_load_pages`, this also covers 
+// pages without a load pointer while profiling.
+// @param[in] bus Address bus instance
+// @param[in] page Index of the page
+// @returns `BUS_PAGE_SIZE` bytes, or NULL if the page isn't backed by a memory PCI unit
+const u8* bus_get_page_memory(bus_t* bus, u32 page);
+
+// Shares a page of memory copy-on-write: loads read from `source` until the first store to the page, 
+// which copies `source` into the memory PCI unit's buffer first. Until then the buffer's page is stale.
+// @param[in] bus Address bus instance
+// @param[in] page Index of a page backed by a memory PCI unit
+// @param[in] source `BUS_PAGE_SIZE` bytes, which must stay unchanged and alive while shared
+void bus_share_page(bus_t* bus, u32 page, const u8* source);
+
+// Schedules a callback at an absolute CPU cycle. The CPU runs uninterrupted up to the earliest deadline,
+// and invokes callbacks at the first instruction boundary at or past it, in deadline order (ties in
+// scheduling order). Callbacks may schedule and cancel events, including ones due right away.
+// @param[in] bus Address bus instance
+// @param[in] deadline CPU cycle to invoke the callback at
+// @param[in] on_event Callback
+// @param[in] user (optional) Passed back to the callback
+// @returns Event ID for `bus_cancel_event`, never 0
+u32 bus_schedule_event(bus_t* bus, u64 deadline, bus_on_event_fn on_event, void* user);
+
+// Cancels a scheduled event
+// @param[in] bus Address bus instance
+// @param[in] event Event ID returned by `bus_schedule_event`
+// @returns True if the event was still pending
+b8 bus_cancel_event(bus_t* bus, u32 event);
+
+// Get the deadline of the earliest scheduled event. It lives as long as the bus does, and is kept 
+// current as events are scheduled, so a run loop can watch it without calling into the bus.
+// @param[in] bus Address bus instance
+// @returns Pointer to the earliest deadline, `U64_MAX` when no event is scheduled
+const u64* bus_get_next_deadline(bus_t* bus);
+
+// Invokes the callbacks of all events due at a cycle, and removes them. Called by the CPU.
+// @param[in] bus Address bus instance
+// @param[in] cycle Current CPU cycle
+void bus_dispatch_events(bus_t* bus, u64 cycle);
+
+// Sets the cycle counter accesses are timed by, normally the attached CPU's
+// @param[in] bus Address bus instance
+// @param[in] cycles (optional) Cycle counter, which must outlive its use here, NULL to remove
+void bus_set_cycle_counter(bus_t* bus, const u64* cycles);
+
+// Get the cycle of the access in progress, for devices to time their side effects by. With fast CPU timing,
+// accesses are at the cycle after their instruction's base cost, with cycle-accurate timing at their own cycle.
+// @param[in] bus Address bus instance
+// @returns Cycle count, 0 without a cycle counter
+u64 bus_get_cycle(bus_t* bus);
+
+// Records or replays loads from device PCI units flagged `nondeterministic` (see `s6502/input_log.h`).
+// Replayed loads don't invoke the device, until the replay diverges from the log. Loads from other
+// PCI units cost nothing extra. The log must outlive its use here: detach it before `input_log_free`.
+// @param[in] bus Address bus instance
+// @param[in] log (optional) Input log to record into or replay, NULL to detach
+void bus_set_input_log(bus_t* bus, input_log_t* log);
+
+// Starts counting accesses per PCI unit and page, and optionally per address. All direct host memory 
+// pointers are withdrawn meanwhile, so every access (including instruction fetches) goes through 
+// `bus_load`/`bus_store`, and decoded or translated code on the bus is discarded.
+// Profiling is only compiled in with the `S6502_BUS_PROFILE` CMake option, it costs nothing otherwise.
+// @param[in] bus Address bus instance
+// @param[in] per_address Also count accesses per address
+// @returns True on success, false if profiling isn't compiled in
+b8 bus_enable_profiling(bus_t* bus, b8 per_address);
+
+// Stops profiling and discards the counters, restoring direct host memory pointers
+// @param[in] bus Address bus instance
+void bus_disable_profiling(bus_t* bus);
+
+// Zero all profiling counters
+// @param[in] bus Address bus instance
+void bus_reset_profile(bus_t* bus);
+
+// Get the dispatch counters. Zero unless profiling.
+// @param[in] bus Address bus instance
+// @param[out] stats
+void bus_get_profile_stats(bus_t* bus, bus_profile_stats_t* stats);
+
+// Get the access counters of an attached PCI unit. Zero unless profiling.
+// @param[in] bus Address bus instance
+// @param[in] index Attachment index, see `bus_get_pci`
+// @param[out] counts
+void bus_get_pci_profile(bus_t* bus, u32 index, bus_access_counts_t* counts);
+
+// Get the access counters of a page. Zero unless profiling.
+// @param[in] bus Address bus instance
+// @param[in] page Index of the page
+// @param[out] counts
+void bus_get_page_profile(bus_t* bus, u32 page, bus_access_counts_t* counts);
+
+// Get the access counters of an address. Zero unless profiling per address.
+// @param[in] bus Address bus instance
+// @param[in] addr
+// @param[out] counts
+void bus_get_addr_profile(bus_t* bus, u16 addr, bus_access_counts_t* counts);
+
+// Print the profiling counters: dispatch, every accessed PCI unit and page, and the hottest addresses
+// @param[in] bus Address bus instance
+// @param[in] file Output stream, e.g. stdout
+void bus_dump_profile(bus_t* bus, FILE* file);
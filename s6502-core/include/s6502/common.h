@@ -17,8 +17,10 @@
 
 #define U8_MAX  0xff
 #define U16_MAX 0xffff
+#define U32_MAX 0xffffffffu
+#define U64_MAX 0xffffffffffffffffull
 
-typedef char i8;
+typedef signed char i8;
 typedef short i16;
 typedef int i32;
 typedef long long i64;
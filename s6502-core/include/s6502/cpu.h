@@ -1,29 +1,32 @@
 #pragma once
 #include "s6502/bus.h"
+#include "s6502/trace.h"
 
 // 6502 CPU state
 typedef struct cpu_s cpu_t;
 
-// 6502 CPU status bitflag indices
+// 6502 CPU status bitflag indices (hardware `P` register layout)
 typedef enum {
-    CPU_STATUS_NEGATIVE_INDEX = 0,
-    CPU_STATUS_OVERFLOW_INDEX,
-    CPU_STATUS_BREAK_INDEX,
-    CPU_STATUS_DECIMAL_INDEX,
-    CPU_STATUS_INTERRUPT_DISABLED_INDEX,
+    CPU_STATUS_CARRY_INDEX = 0,
     CPU_STATUS_ZERO_INDEX,
-    CPU_STATUS_CARRY_INDEX 
+    CPU_STATUS_INTERRUPT_DISABLED_INDEX,
+    CPU_STATUS_DECIMAL_INDEX,
+    CPU_STATUS_BREAK_INDEX,
+    CPU_STATUS_UNUSED_INDEX,
+    CPU_STATUS_OVERFLOW_INDEX,
+    CPU_STATUS_NEGATIVE_INDEX
 } cpu_status_indices;
 
 // 6502 CPU status bitflags
 typedef enum {
-    CPU_STATUS_FLAG_NEGATIVE_BIT            = BIT(CPU_STATUS_NEGATIVE_INDEX),
-    CPU_STATUS_FLAG_OVERFLOW_BIT            = BIT(CPU_STATUS_OVERFLOW_INDEX),
-    CPU_STATUS_FLAG_BREAK_BIT               = BIT(CPU_STATUS_BREAK_INDEX),
-    CPU_STATUS_FLAG_DECIMAL_BIT             = BIT(CPU_STATUS_DECIMAL_INDEX),
-    CPU_STATUS_FLAG_INTERRUPT_DISABLED_BIT  = BIT(CPU_STATUS_INTERRUPT_DISABLED_INDEX),
+    CPU_STATUS_FLAG_CARRY_BIT               = BIT(CPU_STATUS_CARRY_INDEX),
     CPU_STATUS_FLAG_ZERO_BIT                = BIT(CPU_STATUS_ZERO_INDEX),
-    CPU_STATUS_FLAG_CARRY_BIT               = BIT(CPU_STATUS_CARRY_INDEX)
+    CPU_STATUS_FLAG_INTERRUPT_DISABLED_BIT  = BIT(CPU_STATUS_INTERRUPT_DISABLED_INDEX),
+    CPU_STATUS_FLAG_DECIMAL_BIT             = BIT(CPU_STATUS_DECIMAL_INDEX),
+    CPU_STATUS_FLAG_BREAK_BIT               = BIT(CPU_STATUS_BREAK_INDEX),
+    CPU_STATUS_FLAG_UNUSED_BIT              = BIT(CPU_STATUS_UNUSED_INDEX),
+    CPU_STATUS_FLAG_OVERFLOW_BIT            = BIT(CPU_STATUS_OVERFLOW_INDEX),
+    CPU_STATUS_FLAG_NEGATIVE_BIT            = BIT(CPU_STATUS_NEGATIVE_INDEX)
 } cpu_status_flags;
 
 // 6502 CPU instruction opcodes
@@ -85,6 +88,16 @@ typedef enum {
     CPU_OPCODE_TXA,         // Transfer X to accumulator
     CPU_OPCODE_TXS,         // Transfer X to stack pointer
     CPU_OPCODE_TYA,         // Transfer Y to accumulator
+
+    // 65C02 only
+    CPU_OPCODE_BRA,         // Branch always
+    CPU_OPCODE_PHX,         // Push X
+    CPU_OPCODE_PHY,         // Push Y
+    CPU_OPCODE_PLX,         // Pull X
+    CPU_OPCODE_PLY,         // Pull Y
+    CPU_OPCODE_STZ,         // Store zero
+    CPU_OPCODE_TRB,         // Test and reset bits
+    CPU_OPCODE_TSB,         // Test and set bits
     CPU_OPCODE_ENUM_MAX = U8_MAX
 } cpu_opcode;
 
@@ -105,6 +118,8 @@ typedef enum {
     CPU_ADDRESS_MODE_INDIRECT_Y,
     CPU_ADDRESS_MODE_IMPLIED,
     CPU_ADDRESS_MODE_RELATIVE,
+    CPU_ADDRESS_MODE_INDIRECT_ZEROPAGE,     // ($nn), 65C02 only
+    CPU_ADDRESS_MODE_INDIRECT_ABSOLUTE_X,   // ($nnnn,X), 65C02 only
     CPU_ADDRESS_MODE_ENUM_MAX = U8_MAX
 } cpu_address_mode;
 
@@ -114,8 +129,61 @@ typedef struct cpu_instruction_info_s {
     cpu_opcode opcode;
     cpu_address_mode address_mode;
     u8 size;
+    u8 cycles;      // Base cycle cost, before page-crossing and branch penalties
 } cpu_instruction_info_t;
 
+// 6502 CPU execution backends
+typedef enum {
+    CPU_BACKEND_INTERPRETER = 0,
+    CPU_BACKEND_JIT             // Translates hot code to native x86-64, interpreting everything else
+} cpu_backend;
+
+// 6502 CPU variants. Each is built as its own specialized interpreter from one source, so the
+// extra opcodes, decimal mode handling and quirks of one variant cost nothing on the others.
+typedef enum {
+    CPU_VARIANT_NMOS = 0,   // NMOS 6502
+    CPU_VARIANT_65C02,      // CMOS 65C02: extra opcodes and address modes, fixed JMP ($xxff), valid N and Z in decimal mode
+    CPU_VARIANT_2A03,       // Ricoh 2A03 (NES): an NMOS 6502 whose ADC and SBC ignore the decimal flag
+    CPU_VARIANT_COUNT
+} cpu_variant;
+
+// When instructions access the bus. Like variants, each is its own specialized interpreter, chosen at creation.
+typedef enum {
+    CPU_TIMING_FAST = 0,        // Only the accesses an instruction needs, timed at the cycle after its base cost
+    CPU_TIMING_CYCLE_ACCURATE,  // Every access of every cycle, including the dummy reads and writes (e.g. a
+                                // read-modify-write's double write, or the read of an index's uncarried address),
+                                // each timed at its own cycle. Always interpreted, see `cpu_get_backend`.
+    CPU_TIMING_COUNT
+} cpu_timing;
+
+// 6502 CPU creation options
+typedef struct cpu_config_s {
+    cpu_backend backend;
+    cpu_variant variant;
+    cpu_timing timing;
+} cpu_config_t;
+
+// Predecode cache counters
+typedef struct cpu_decode_cache_stats_s {
+    u64 hits;           // Instructions executed from the cache
+    u64 misses;         // Instructions decoded from memory
+    u64 invalidations;  // Cached pages discarded because their memory changed
+} cpu_decode_cache_stats_t;
+
+// Why `cpu_run` returned
+typedef enum {
+    CPU_STOP_NONE = 0,          // Ran for the whole cycle budget
+    CPU_STOP_BREAKPOINT,        // Reached a breakpoint, see `cpu_add_breakpoint`
+    CPU_STOP_WATCHPOINT         // Accessed an address covered by a watchpoint, see `bus_add_watchpoint`
+} cpu_stop_reason;
+
+typedef struct cpu_stop_s {
+    cpu_stop_reason reason;
+    u16 addr;       // Address of the breakpoint, or of the access
+    u8 value;       // Watchpoints: value loaded or stored
+    u32 access;     // Watchpoints: `BUS_WATCH_LOAD` or `BUS_WATCH_STORE`
+} cpu_stop_t;
+
 typedef struct cpu_instruction_s {
     cpu_instruction_info_t info;
     u16 operand;
@@ -127,16 +195,117 @@ typedef struct cpu_instruction_s {
 // @returns 6502 CPU instance pointer
 cpu_t* cpu_create(bus_t* bus);
 
+// Create a 6502 CPU instance with the given options
+// @param[in] bus Address bus the CPU operates on
+// @param[in] config (optional) Creation options, NULL for defaults
+// @returns 6502 CPU instance pointer
+cpu_t* cpu_create_ex(bus_t* bus, const cpu_config_t* config);
+
+// Get the backend a 6502 CPU instance actually executes with. `CPU_BACKEND_JIT` falls back 
+// to the interpreter on hosts without JIT support, and with cycle-accurate timing.
+// @param[in] cpu
+// @returns Execution backend
+cpu_backend cpu_get_backend(cpu_t* cpu);
+
+// Get the variant a 6502 CPU instance emulates
+// @param[in] cpu
+// @returns CPU variant
+cpu_variant cpu_get_variant(cpu_t* cpu);
+
+// Get the bus access timing of a 6502 CPU instance
+// @param[in] cpu
+// @returns Timing
+cpu_timing cpu_get_timing(cpu_t* cpu);
+
 // Free a 6502 CPU instance
 // @param[in] cpu The CPU instance to destroy
 void cpu_free(cpu_t* cpu);
 
+// Reset a 6502 CPU instance, loading the program counter from the reset vector (0xfffc)
+// @param[in] cpu
+void cpu_reset(cpu_t* cpu);
+
+// Fetch, decode and execute a single instruction at the program counter, or take a pending interrupt instead
+// @param[in] cpu
+// @returns Number of cycles the instruction or interrupt took
+u32 cpu_step(cpu_t* cpu);
+
+// Run instructions until the given cycle budget is exhausted. Instructions are never split, 
+// so the last instruction may overshoot the budget. Breakpoints and watchpoints stop the run early,
+// see `cpu_get_stop`.
+// @param[in] cpu
+// @param[in] cycles Cycle budget to run for
+// @returns Number of cycles the budget was overshot by, 0 if stopped early
+u64 cpu_run(cpu_t* cpu, u64 cycles);
+
+// Set a breakpoint: `cpu_run` stops before executing the instruction at the address, and resumes by
+// executing it. Only pages holding breakpoints lose their predecoded instructions and translated code,
+// so running anywhere else costs nothing extra. `cpu_step` ignores breakpoints.
+// @param[in] cpu
+// @param[in] addr Instruction address
+// @returns False if there's already a breakpoint at the address
+b8 cpu_add_breakpoint(cpu_t* cpu, u16 addr);
+
+// Remove a breakpoint
+// @param[in] cpu
+// @param[in] addr Instruction address
+// @returns False if there's no breakpoint at the address
+b8 cpu_remove_breakpoint(cpu_t* cpu, u16 addr);
+
+// Get why the last `cpu_run` or `cpu_step` stopped. A watchpoint stops the run once the accessing
+// instruction completes, on either backend.
+// Instruction fetches don't match watchpoints.
+// @param[in] cpu
+// @param[out] stop Stop reason, `CPU_STOP_NONE` if the whole budget ran
+void cpu_get_stop(cpu_t* cpu, cpu_stop_t* stop);
+
+// Assert or release IRQ lines. The CPU's IRQ input is the OR of all lines, so each device can own a line bit.
+// While it's asserted and interrupts aren't disabled, an interrupt is taken before the next instruction.
+// @param[in] cpu
+// @param[in] lines Mask of the lines to change
+// @param[in] asserted True to assert the lines, false to release them
+void cpu_set_irq(cpu_t* cpu, u32 lines, b8 asserted);
+
+// Trigger a non-maskable interrupt, taken before the next instruction
+// @param[in] cpu
+void cpu_trigger_nmi(cpu_t* cpu);
+
+// Record every instruction executed into a trace, or stop tracing. While tracing, `cpu_run` interprets
+// with either backend. Can be called from device callbacks, taking effect from the next instruction.
+// The trace must outlive its use here: stop tracing before `trace_free`.
+// @param[in] cpu
+// @param[in] trace (optional) Trace to record into, NULL to stop tracing
+// @returns False if tracing is compiled out (S6502_TRACE=OFF)
+b8 cpu_set_trace(cpu_t* cpu, trace_t* trace);
+
 // Decode 4 byte chunk into 6502 CPU instruction
 // @param[in] cpu
 // @param[in] word Chunk to decode
 // @returns Decoded instruction
 cpu_instruction_t cpu_decode(cpu_t* cpu, u32 word);
 
+// Get the static description of an NMOS 6502 opcode byte
+// @param[in] byte Opcode byte
+// @returns Opcode, address mode, size and base cycle cost. Unknown opcodes have size 0, and execute as single byte NOPs.
+cpu_instruction_info_t cpu_get_instruction_info(u8 byte);
+
+// Get the static description of an opcode byte on a given CPU variant
+// @param[in] variant
+// @param[in] byte Opcode byte
+// @returns Opcode, address mode, size and base cycle cost, see `cpu_get_instruction_info`
+cpu_instruction_info_t cpu_get_variant_instruction_info(cpu_variant variant, u8 byte);
+
+// Get the assembler mnemonic of an NMOS 6502 opcode byte
+// @param[in] byte Opcode byte
+// @returns Upper case mnemonic, "???" for unknown opcodes
+const char* cpu_get_mnemonic(u8 byte);
+
+// Get the assembler mnemonic of an opcode byte on a given CPU variant
+// @param[in] variant
+// @param[in] byte Opcode byte
+// @returns Upper case mnemonic, "???" for unknown opcodes
+const char* cpu_get_variant_mnemonic(cpu_variant variant, u8 byte);
+
 // Executes a decoded CPU instruction using the given 6502 CPU instance
 // @param[in] cpu
 // @param[in] inst
@@ -155,4 +324,19 @@ u8 cpu_pop(cpu_t* cpu);
 // @param[out] status (optional) Status register 
 // @param[out] pc (optional) Program counter register
 // @param[out] cycles (optional) Current cycle count
-void cpu_get_state(cpu_t* cpu, u8* a, u8* x, u8* y, u8* sp, u8* status, u16* pc, u64* cycles);
\ No newline at end of file
+void cpu_get_state(cpu_t* cpu, u8* a, u8* x, u8* y, u8* sp, u8* status, u16* pc, u64* cycles);
+
+// Get the predecode cache counters of the 6502 CPU instance. 
+// Instructions on pages of memory PCI units are decoded once and cached until a store through the bus modifies the page.
+// @param[in] cpu
+// @param[out] stats
+void cpu_get_decode_cache_stats(cpu_t* cpu, cpu_decode_cache_stats_t* stats);
+
+// Zero the predecode cache counters
+// @param[in] cpu
+void cpu_reset_decode_cache_stats(cpu_t* cpu);
+
+// Discard all predecoded instructions and translated code. Needed after modifying code in a memory PCI unit's buffer directly,
+// rather than through the bus.
+// @param[in] cpu
+void cpu_flush_decode_cache(cpu_t* cpu);
@@ -0,0 +1,63 @@
+#pragma once
+#include "common.h"
+
+// Device input logs, for deterministic record/replay. While recording, every load from a device PCI unit
+// flagged `nondeterministic` is appended to a file as (cycle, address, value). While replaying, those loads
+// are served from the log in the same order, without invoking the device, so the run repeats bit-exactly.
+// A log file is the magic "S6502IN1" followed by the encoded records. Attach a log with `bus_set_input_log`.
+
+typedef struct input_log_s input_log_t;
+
+typedef enum {
+    INPUT_LOG_RECORD = 0,
+    INPUT_LOG_REPLAY
+} input_log_mode;
+
+// Create an input log to record into
+// @param[in] path File to (over)write
+// @returns Input log instance pointer, NULL if the file can't be created
+input_log_t* input_log_create(const char* path);
+
+// Open an input log to replay
+// @param[in] path
+// @returns Input log instance pointer, NULL if the file can't be opened or isn't an input log
+input_log_t* input_log_open(const char* path);
+
+// Write out everything recorded and close the file
+// @param[in] log
+void input_log_free(input_log_t* log);
+
+// Write out everything recorded so far, so the file holds it even if the process dies
+// @param[in] log
+void input_log_flush(input_log_t* log);
+
+// @param[in] log
+// @returns Whether the log records or replays
+input_log_mode input_log_get_mode(input_log_t* log);
+
+// @param[in] log
+// @returns Number of loads recorded or replayed so far
+u64 input_log_get_num_records(input_log_t* log);
+
+// Record a load. Only one thread may record into a log.
+// @param[in] log
+// @param[in] cycle CPU cycle count at the load
+// @param[in] addr Address passed to the device
+// @param[in] value Value the device returned
+void input_log_record(input_log_t* log, u64 cycle, u16 addr, u8 value);
+
+// Replay a load. Once a load doesn't match the next recorded one (by cycle and address), or the log is
+// exhausted, the replay has diverged: this and every later load must go to the device.
+// @param[in] log
+// @param[in] cycle CPU cycle count at the load
+// @param[in] addr Address passed to the device
+// @param[out] value Recorded value
+// @returns False if the replay has diverged
+b8 input_log_replay(input_log_t* log, u64 cycle, u16 addr, u8* value);
+
+// Get where a replay diverged from the log
+// @param[in] log
+// @param[out] cycle (optional) Cycle count of the first load that didn't match
+// @param[out] addr (optional) Its address
+// @returns False if the replay hasn't diverged
+b8 input_log_get_divergence(input_log_t* log, u64* cycle, u16* addr);
@@ -0,0 +1,17 @@
+#pragma once
+#include "s6502/common.h"
+
+#include <time.h>
+
+// Host time, for timing emulation. Monotonic on POSIX hosts, so clock adjustments don't skew
+// what's measured, and the C11 calendar clock elsewhere.
+// @returns Host time in seconds
+inline static double host_time_now() {
+    struct timespec ts;
+#if defined(__unix__) || defined(__APPLE__)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "s6502/common.h"
+
+// Map of disjoint (closed) intervals, kept as one contiguous array sorted by domain.
+// Inserting shifts the entries after the new one, lookups are iterative binary searches.
+typedef struct interval_map_s interval_map_t;
+
+typedef struct interval_s {
+    u32 begin,
+        end;
+    void* data;
+} interval_t;
+
+// Creates an empty interval map
+// @returns Interval map instance pointer
+interval_map_t* interval_map_create();
+
+// Frees an interval map
+// @param[in] map
+void interval_map_free(interval_map_t* map);
+
+// Inserts an interval. Overlapping intervals are rejected.
+// @param[in] map
+// @param[in] begin The minimum bound for this closed interval
+// @param[in] end The maximum bound for this closed interval
+// @param[in] data Data the interval is associated with
+// @returns True on success, false if interval overlap was attempted
+b8 interval_map_insert(interval_map_t* map, u32 begin, u32 end, void* data);
+
+// Search for the interval containing a key
+// @param[in] map
+// @param[in] key Number value used to match an interval
+// @returns Pointer to the matching interval, or NULL if not found. Valid until the next insert.
+const interval_t* interval_map_search(interval_map_t* map, u32 key);
+
+// Find the intervals overlapping a range. Being disjoint and sorted, they're consecutive entries.
+// @param[in] map
+// @param[in] begin The minimum bound of the closed range
+// @param[in] end The maximum bound of the closed range
+// @param[out] first Index of the first overlapping interval (or where one would be inserted, if none)
+// @returns Number of overlapping intervals
+u32 interval_map_query(interval_map_t* map, u32 begin, u32 end, u32* first);
+
+// @returns Number of intervals in the map
+u32 interval_map_get_count(interval_map_t* map);
+
+// @returns The intervals, in domain order. Valid until the next insert.
+const interval_t* interval_map_get_intervals(interval_map_t* map);
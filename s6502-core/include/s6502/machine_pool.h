@@ -0,0 +1,89 @@
+#pragma once
+#include "s6502/cpu.h"
+
+// Runs many independent 6502 machines (CPU + address bus pairs) across worker threads.
+// Machines execute in cycle quanta; each worker round-robins through its own queue of machines
+// and steals from the other workers' queues once its own runs dry. Without POSIX threads,
+// the thread calling `machine_pool_run` runs every machine by itself.
+typedef struct machine_pool_s machine_pool_t;
+
+// Invoked once a machine has run its cycle budget, or stopped short of it at a breakpoint or watchpoint,
+// on the worker thread that ran it. The stop reason is left in `cpu_get_stop`. Without a new budget,
+// the machine is finished for this `machine_pool_run`; with one, it goes back to the queue (past the stop).
+// @param[in] user User pointer given to `machine_pool_add`
+// @param[in] cpu The machine's CPU
+// @returns Cycle budget to keep running the machine for, 0 to finish it
+typedef u64 (*machine_pool_on_done_fn)(void* user, cpu_t* cpu);
+
+// Invoked before each quantum of a machine, on the worker thread about to run it
+// @param[in] user User pointer given to `machine_pool_add`
+// @param[in] cpu The machine's CPU
+typedef void (*machine_pool_on_start_fn)(void* user, cpu_t* cpu);
+
+// Machine pool creation options
+typedef struct machine_pool_config_s {
+    u32 num_threads;        // Worker threads, 0 for one per online core (always 1 without POSIX threads)
+    u64 quantum_cycles;     // Cycles a machine runs before going back to the queue, 0 for the default
+    b8 pin_threads;         // Pin each worker to a core (Linux only)
+} machine_pool_config_t;
+
+// Machine pool counters, accumulated over all `machine_pool_run` calls
+typedef struct machine_pool_stats_s {
+    u64 quanta;     // Quanta executed
+    u64 steals;     // Quanta taken from another worker's queue
+} machine_pool_stats_t;
+
+// Create a machine pool
+// @param[in] config (optional) Creation options, NULL for defaults
+// @returns New machine pool instance
+machine_pool_t* machine_pool_create(const machine_pool_config_t* config);
+
+// Free a machine pool, including the CPUs and address buses of all its machines
+// @param[in] pool The machine pool to destroy
+void machine_pool_free(machine_pool_t* pool);
+
+// Add a machine to the pool, which takes ownership of its CPU and address bus.
+// Every machine must have its own address bus and PCI units, as machines run concurrently.
+// @param[in] pool
+// @param[in] cpu The machine's CPU, operating on `bus`
+// @param[in] bus The machine's address bus
+// @param[in] cycles Cycle budget for the next `machine_pool_run`
+// @param[in] on_done (optional) Invoked when the machine has run its budget or stopped
+// @param[in] user User pointer passed to `on_done`
+// @returns Machine index
+u32 machine_pool_add(machine_pool_t* pool, cpu_t* cpu, bus_t* bus, u64 cycles, machine_pool_on_done_fn on_done, void* user);
+
+// Set a machine's cycle budget for the next `machine_pool_run`
+// @param[in] pool
+// @param[in] machine Machine index
+// @param[in] cycles Cycle budget
+void machine_pool_set_cycles(machine_pool_t* pool, u32 machine, u64 cycles);
+
+// Set a callback invoked before each quantum of a machine, e.g. to time the quanta it runs
+// @param[in] pool
+// @param[in] machine Machine index
+// @param[in] on_start (optional) Invoked with the user pointer given to `machine_pool_add`, NULL for none
+void machine_pool_set_start_callback(machine_pool_t* pool, u32 machine, machine_pool_on_start_fn on_start);
+
+// Run every machine until it has spent its cycle budget or stopped, blocking until all are done.
+// The calling thread works as one of the workers.
+// @param[in] pool
+void machine_pool_run(machine_pool_t* pool);
+
+// @param[in] pool
+// @param[in] machine Machine index
+// @returns The machine's CPU
+cpu_t* machine_pool_get_cpu(machine_pool_t* pool, u32 machine);
+
+// @param[in] pool
+// @returns Number of machines in the pool
+u32 machine_pool_get_num_machines(machine_pool_t* pool);
+
+// @param[in] pool
+// @returns Number of worker threads, including the thread calling `machine_pool_run`
+u32 machine_pool_get_num_threads(machine_pool_t* pool);
+
+// Get the machine pool counters
+// @param[in] pool
+// @param[out] stats Where to store the counters
+void machine_pool_get_stats(machine_pool_t* pool, machine_pool_stats_t* stats);
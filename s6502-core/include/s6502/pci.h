@@ -2,10 +2,21 @@
 #include "s6502/common.h"
 
 typedef struct pci_s pci_t;
+typedef struct pci_image_s pci_image_t;
 
 typedef void (*pci_on_attach_fn)(pci_t*);
 typedef u8 (*pci_on_load_fn)(pci_t*, u16);
 typedef void (*pci_on_store_fn)(pci_t*, u16, u8);
+typedef void (*pci_on_load_block_fn)(pci_t*, u16, u8*, u32);
+typedef void (*pci_on_store_block_fn)(pci_t*, u16, const u8*, u32);
+typedef u32 (*pci_on_save_fn)(pci_t*, void*);
+typedef void (*pci_on_restore_fn)(pci_t*, const void*, u32);
+
+// How the address bus reaches a PCI unit
+typedef enum {
+    PCI_KIND_DEVICE = 0,    // I/O device, accessed through the `on_load`/`on_store` callbacks
+    PCI_KIND_MEMORY         // Plain memory (RAM/ROM), accessed directly through `memory`
+} pci_kind;
 
 struct pci_s {
     const char* name;
@@ -13,4 +24,55 @@ struct pci_s {
     pci_on_attach_fn on_attach;
     pci_on_load_fn on_load;
     pci_on_store_fn on_store;
-};
\ No newline at end of file
+
+    // (optional) Device PCI units only: transfer a run of consecutive addresses at once (never crossing
+    // a page or mirror boundary), for `bus_load_block`/`bus_store_block`. Without them, block transfers
+    // go through `on_load`/`on_store` byte by byte.
+    pci_on_load_block_fn on_load_block;
+    pci_on_store_block_fn on_store_block;
+
+    // (optional) Device state hooks for snapshots. `on_save` writes the state to the buffer and returns 
+    // its size in bytes, or only returns the size when the buffer is NULL. `on_restore` gets the state back.
+    pci_on_save_fn on_save;
+    pci_on_restore_fn on_restore;
+
+    // Device PCI units only: loads depend on the outside world (host input, clocks, ...), so input logs
+    // record them, see `bus_set_input_log`
+    b8 nondeterministic;
+
+    // Memory-backed PCI units only
+    pci_kind kind;
+    u8* memory;         // Backing buffer, offset 0 is the PCI unit's start address on the bus
+    u32 memory_size;
+    b8 read_only;       // Stores are dropped (ROM)
+    pci_image_t* image; // (optional) Shared read-only image backing `memory`, see `pci_create_rom_file`
+};
+
+// Creates a memory-backed (RAM/ROM) PCI unit with a zeroed backing buffer. 
+// ROM contents can be written through `pci->memory` before or after attaching.
+// @param[in] name PCI unit name
+// @param[in] size Size of the backing buffer in bytes
+// @param[in] read_only True if the bus should reject stores (ROM)
+// @returns New PCI unit instance
+pci_t* pci_create_memory(const char* name, u32 size, b8 read_only);
+
+// Creates a ROM PCI unit backed by an image file, memory-mapped read-only. All ROM PCI units created from 
+// the same file share one mapping, so the image is only read in (on first access) and held in memory once, 
+// however many machines attach it. The mapping is released with the last of them.
+// `memory` must not be written, and snapshots leave such ROMs out, as their contents can't change.
+// On hosts without POSIX memory mapping, the image is read into a buffer of the PCI unit's own instead.
+// @param[in] name PCI unit name
+// @param[in] path Image file, its size is the ROM size (at most 64 KiB)
+// @returns New PCI unit instance, NULL if the file can't be mapped or read
+pci_t* pci_create_rom_file(const char* name, const char* path);
+
+// Creates another ROM PCI unit sharing the image of one created by `pci_create_rom_file` (a copy of it,
+// on hosts without memory mapping)
+// @param[in] name PCI unit name
+// @param[in] rom
+// @returns New PCI unit instance
+pci_t* pci_create_rom_shared(const char* name, pci_t* rom);
+
+// Frees a PCI unit created by one of the `pci_create_*` functions, including its backing buffer
+// @param[in] pci The PCI unit to destroy
+void pci_free(pci_t* pci);
@@ -0,0 +1,38 @@
+#pragma once
+#include "s6502/cpu.h"
+
+// Machine snapshot: CPU registers, the contents and switched bank (`bus_switch_bank`) of every memory
+// PCI unit on the CPU's address bus, and the state of device PCI units implementing `on_save`/`on_restore`.
+// Restoring only copies back the pages stored to since the snapshot, and forks share the snapshot's
+// pages copy-on-write, so both cost about as much as the pages the machine dirties. ROM images 
+// (`pci_create_rom_file`) are left out, and forks get a ROM PCI unit sharing the image.
+// Events scheduled on the bus and IRQ lines aren't part of a snapshot: devices reschedule and 
+// reassert theirs in `on_restore`.
+typedef struct snapshot_s snapshot_t;
+
+// Take a snapshot of a machine. The machine's bus then tracks dirty pages for `snapshot_restore`.
+// @param[in] cpu The machine's CPU
+// @returns New snapshot instance
+snapshot_t* snapshot_create(cpu_t* cpu);
+
+// Free a snapshot. Machines forked from it must be freed first; the snapshotted machine needn't outlive it
+// (but the names of its PCI units must, as forks reuse them).
+// @param[in] snapshot The snapshot to destroy
+void snapshot_free(snapshot_t* snapshot);
+
+// Restore a machine to a snapshot. The machine's bus must have the same PCI units attached at the same
+// addresses as when the snapshot was taken. Restoring the machine the snapshot was taken of, with no
+// other snapshot of it taken since, only copies the pages stored to through the bus in the meantime.
+// @param[in] snapshot
+// @param[in] cpu The machine's CPU
+void snapshot_restore(snapshot_t* snapshot, cpu_t* cpu);
+
+// Create a new machine from a snapshot, on an address bus without memory PCI units. Memory PCI units
+// are recreated on the bus (which owns them) and share the snapshot's pages until written to, so their
+// buffers only hold the pages written to so far; read memory through the bus instead.
+// Device PCI units aren't cloned: attach fresh ones to the bus at the snapshot's addresses beforehand,
+// and they get their saved state restored.
+// @param[in] snapshot
+// @param[in] bus Address bus for the new machine
+// @returns New 6502 CPU instance, with the snapshot's registers, backend, variant and timing
+cpu_t* snapshot_fork(snapshot_t* snapshot, bus_t* bus);
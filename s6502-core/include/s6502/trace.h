@@ -0,0 +1,65 @@
+#pragma once
+#include "common.h"
+
+// Binary instruction traces. Each executed instruction is delta-encoded against the previous record
+// into a lock-free ring buffer, which a background thread drains to a file (without POSIX threads,
+// recording drains it whenever it fills up). A trace file is
+// the magic "S6502TR1" followed by the encoded records, read back with `trace_reader_*`.
+
+typedef struct trace_s trace_t;
+typedef struct trace_reader_s trace_reader_t;
+
+#define TRACE_DEFAULT_BUFFER_SIZE (1 << 20)
+
+// One traced instruction, with the CPU state before it executed
+typedef struct trace_record_s {
+    u64 cycles;
+    u16 pc;
+    u8 opcode;          // Opcode byte
+    u8 operand_size;    // 0, 1 or 2 bytes
+    u16 operand;
+    u8 a, x, y, sp, status;
+} trace_record_t;
+
+
+// Create a trace writing to a file, and start its writer thread
+// @param[in] path File to (over)write
+// @param[in] buffer_size Ring buffer size in bytes, a power of two, 0 for `TRACE_DEFAULT_BUFFER_SIZE`
+// @returns Trace instance pointer, NULL if the file can't be created
+trace_t* trace_create(const char* path, u32 buffer_size);
+
+// Write out everything recorded, stop the writer thread (if any) and close the file
+// @param[in] trace
+void trace_free(trace_t* trace);
+
+// Append a record. Only one thread may record into a trace. Blocks while the ring buffer is full,
+// so no record is ever dropped.
+// @param[in] trace
+// @param[in] record
+void trace_record(trace_t* trace, const trace_record_t* record);
+
+// Get the number of records appended so far
+// @param[in] trace
+// @returns Record count
+u64 trace_get_num_records(trace_t* trace);
+
+// Get the number of encoded bytes appended so far, excluding the file header
+// @param[in] trace
+// @returns Byte count
+u64 trace_get_num_bytes(trace_t* trace);
+
+
+// Open a trace file for reading
+// @param[in] path
+// @returns Trace reader instance pointer, NULL if the file can't be opened or isn't a trace
+trace_reader_t* trace_reader_open(const char* path);
+
+// Close a trace file
+// @param[in] reader
+void trace_reader_free(trace_reader_t* reader);
+
+// Decode the next record
+// @param[in] reader
+// @param[out] record
+// @returns True on success, false at the end of the file or on a truncated record
+b8 trace_reader_next(trace_reader_t* reader, trace_record_t* record);
@@ -1,53 +1,582 @@
 #include "s6502/bus.h"
-#include "s6502/lib/interval_tree.h"
+#include "s6502/lib/interval_map.h"
 
-#define BUS_PCI_NODE_CACHE_SIZE 2
+#if defined(S6502_BUS_PROFILE)
+    #define BUS_PROFILE 1
+#else
+    #define BUS_PROFILE 0
+#endif
 
-// The `bus` is essentially an interval tree structure that tracks all "attached" PCI units, 
+// The `bus` is essentially a sorted map of address ranges that tracks all "attached" PCI units, 
 // and maps memory reads/writes to the appropriate unit (invoking its respective function pointer).
+// A flat page table caches which PCI unit covers each whole page, so most accesses never search the map.
+// Once sealed, every other page also knows which of the map's ranges overlap it, so the rest don't
+// search it either.
+// Pages backed by memory PCI units additionally get a host pointer, so RAM/ROM skips the callbacks altogether.
+
+// Scheduled device events are kept in a binary min-heap ordered by deadline, so the CPU only has to
+// compare its cycle counter against the heap's root between instructions.
+
+// An attached PCI unit and its address range
+typedef struct bus_attachment_s {
+    pci_t* pci;
+    u16 addr_start;
+    u16 addr_end;
+    u32 mirror_size;    // See `bus_attach_pci_mirrored`, BUS_ADDR_MAX + 1 if not mirrored
+    u32 bank_offset;    // Memory PCI units: offset of `addr_start` in the backing buffer, see `bus_switch_bank`
+} bus_attachment_t;
+
+// Access counters of a profiled bus, see `bus_enable_profiling`
+typedef struct bus_profile_s {
+    bus_profile_stats_t stats;
+    bus_access_counts_t pages[BUS_PAGE_COUNT];
+    bus_access_counts_t* pci;           // Per attachment
+    bus_access_counts_t* addresses;     // Per address, if requested
+    u16 attachment_map[BUS_ADDR_MAX + 1];   // Attachment index + 1 by address, 0 where unmapped
+} bus_profile_t;
+
+// Attached ranges overlapping a page, as consecutive entries of the bus' interval map
+typedef struct bus_page_ranges_s {
+    u16 first;
+    u16 count;
+} bus_page_ranges_t;
+
+// A watched address range, see `bus_add_watchpoint`
+typedef struct bus_watchpoint_s {
+    u16 addr_start;
+    u16 addr_end;
+    u32 access;         // BUS_WATCH_* bits, 0 once removed
+} bus_watchpoint_t;
+
+// A scheduled event
+typedef struct bus_event_s {
+    u64 deadline;
+    u64 sequence;       // Orders events with the same deadline by scheduling order
+    bus_on_event_fn on_event;
+    void* user;
+    u32 id;
+} bus_event_t;
+
 struct bus_s {
-    interval_node_t* pci_root;
-    interval_node_t* pci_node_cache[BUS_PCI_NODE_CACHE_SIZE];
+    interval_map_t* pci_map;
+    b8 sealed;                                  // See `bus_seal`, until the next attach
+    const interval_t* sealed_ranges;
+    bus_page_ranges_t page_ranges[BUS_PAGE_COUNT];
+
+    pci_t* pci_pages[BUS_PAGE_COUNT];
+    u16 pci_page_starts[BUS_PAGE_COUNT];   // Attachment address and mirror mask of the PCI unit in `pci_pages`
+    u16 pci_page_masks[BUS_PAGE_COUNT];
+    u8* memory_pages[BUS_PAGE_COUNT];
+    u16 page_aliases[BUS_PAGE_COUNT];       // Next page in a ring of mirrors of the same memory, or the page itself
+    u8 page_flags[BUS_PAGE_COUNT];
+    const u8* shared_pages[BUS_PAGE_COUNT];    // Copy-on-write sources, see `bus_share_page`
+
+    // Direct host memory actually handed out, derived from the above by `bus_update_page`
+    u8* load_pages[BUS_PAGE_COUNT];
+    u8* store_pages[BUS_PAGE_COUNT];
+
+    bus_on_invalidate_fn on_invalidate;
+    void* on_invalidate_user;
+
+    bus_attachment_t* attachments;  // In attachment order
     u32 num_pci;
+    pci_t** owned_pci;              // Freed with the bus, see `bus_adopt_pci`
+    u32 num_owned_pci;
+
+    u32 dirty_generation;
+
+    bus_event_t* events;            // Min-heap by deadline
+    u32 num_events;
+    u32 events_capacity;
+    u64 next_deadline;              // Deadline of `events[0]`, U64_MAX if there is none
+    u64 event_sequence;
+    u32 last_event_id;
+
+    bus_watchpoint_t* watchpoints;  // Indexed by ID - 1, removed ones watch no access and get reused
+    u32 num_watchpoints;
+    bus_on_watch_fn on_watch;
+    void* on_watch_user;
+
+    const u64* cycles;              // See `bus_set_cycle_counter`
+    input_log_t* input_log;
+
+    bus_profile_t* profile;         // While profiling
 };
 
-// Try to save a tree search by using the cached PCI nodes
-static inline interval_node_t* bus_cache_search(bus_t* bus, u16 addr) {
-    interval_node_t* node = NULL;
+// Bus page flags
+typedef enum {
+    BUS_PAGE_FLAG_CODE = BIT(0),        // Page holds decoded instructions, stores must invalidate them
+    BUS_PAGE_FLAG_TRACK_DIRTY = BIT(1), // The next store must mark the page dirty
+    BUS_PAGE_FLAG_DIRTY = BIT(2),       // Page was stored to since `bus_track_dirty_pages`
+    BUS_PAGE_FLAG_WATCH_LOAD = BIT(3),  // A watchpoint covers loads from part of the page
+    BUS_PAGE_FLAG_WATCH_STORE = BIT(4)  // A watchpoint covers stores to part of the page
+} bus_page_flags;
+
+// Page flags which withdraw the store pointer, so the next store goes through `bus_fault_page`
+#define BUS_PAGE_FLAGS_FAULT (BUS_PAGE_FLAG_CODE | BUS_PAGE_FLAG_TRACK_DIRTY)
+
+// Mirrors of a page are all changed along with it, as they see the same memory
+#define BUS_FOR_EACH_ALIAS(bus, page, alias) \
+    for (u32 alias = (page), alias##_done = FALSE; !alias##_done; alias = (bus)->page_aliases[alias], alias##_done = alias == (page))
+
+// Recompute the direct host memory pointers of a page
+static void bus_update_page(bus_t* bus, u32 page) {
+    pci_t* pci = bus->pci_pages[page];
+    u8* memory = bus->memory_pages[page];
+    const u8* shared = bus->shared_pages[page];
+
+#if BUS_PROFILE
+    // Profiling needs to see every access
+    if (bus->profile) {
+        bus->load_pages[page] = NULL;
+        bus->store_pages[page] = NULL;
+        return;
+    }
+#endif
+
+    // Shared pages are read-only to the bus' clients, they never write through these pointers
+    bus->load_pages[page] = !(bus->page_flags[page] & BUS_PAGE_FLAG_WATCH_LOAD) 
+        ? (shared ? (u8*)shared : memory) 
+        : NULL;
+    bus->store_pages[page] = (memory && !pci->read_only && !shared && !(bus->page_flags[page] & (BUS_PAGE_FLAGS_FAULT | BUS_PAGE_FLAG_WATCH_STORE))) 
+        ? memory 
+        : NULL;
+}
+
+// Notify the invalidate listener that a code page is about to change, and unmark it
+static void bus_invalidate_page(bus_t* bus, u32 page) {
+    bus->page_flags[page] &= ~BUS_PAGE_FLAG_CODE;
+    bus_update_page(bus, page);
+
+    if (bus->on_invalidate)
+        bus->on_invalidate(bus->on_invalidate_user, page);
+}
+
+// Recompute the pointers of a page whose contents changed, invalidating it if it holds code
+static void bus_refresh_page(bus_t* bus, u32 page) {
+    if (bus->page_flags[page] & BUS_PAGE_FLAG_CODE)
+        bus_invalidate_page(bus, page);
+    else
+        bus_update_page(bus, page);
+}
+
+// @returns True if a store to the page must go through `bus_fault_page` first.
+// Stores to read-only memory are dropped, so they leave decoded code, dirtiness and sharing alone.
+static inline b8 bus_page_faults(bus_t* bus, u32 page) {
+    if (bus->memory_pages[page] && bus->pci_pages[page]->read_only)
+        return FALSE;
+
+    return (bus->page_flags[page] & BUS_PAGE_FLAGS_FAULT) || bus->shared_pages[page];
+}
+
+// Prepare a page for a store: copy a shared page, record it as dirty, and invalidate decoded code
+static void bus_fault_page(bus_t* bus, u32 page) {
+    if (bus->shared_pages[page])
+        memcpy(bus->memory_pages[page], bus->shared_pages[page], BUS_PAGE_SIZE);
+
+    BUS_FOR_EACH_ALIAS(bus, page, alias) {
+        bus->shared_pages[alias] = NULL;
+
+        if (bus->page_flags[alias] & BUS_PAGE_FLAG_TRACK_DIRTY)
+            bus->page_flags[alias] = (bus->page_flags[alias] & ~BUS_PAGE_FLAG_TRACK_DIRTY) | BUS_PAGE_FLAG_DIRTY;
+
+        bus_refresh_page(bus, alias);
+    }
+}
+
+#if BUS_PROFILE
+static inline void bus_profile_count(bus_access_counts_t* counts, b8 store) {
+    if (store)
+        counts->stores++;
+    else
+        counts->loads++;
+}
+
+// Count an access to the bus
+static void bus_profile_access(bus_t* bus, u16 addr, b8 store) {
+    bus_profile_t* profile = bus->profile;
+    u32 page = addr >> BUS_PAGE_BITS;
+    u32 attachment = profile->attachment_map[addr];
+
+    if (bus->pci_pages[page])
+        profile->stats.page_hits++;
+    else
+        profile->stats.range_searches++;
+
+    if (attachment)
+        bus_profile_count(&profile->pci[attachment - 1], store);
+    else
+        profile->stats.unmapped++;
+
+    bus_profile_count(&profile->pages[page], store);
+
+    if (profile->addresses)
+        bus_profile_count(&profile->addresses[addr], store);
+}
+
+// Map an attachment's address range for per-PCI unit counters
+static void bus_profile_attach(bus_t* bus, u32 index) {
+    bus_profile_t* profile = bus->profile;
+    bus_attachment_t* attachment = &bus->attachments[index];
 
-    for (u32 i = 0; i < BUS_PCI_NODE_CACHE_SIZE; i++) {
-        node = bus->pci_node_cache[i];
-        if (node && interval_node_test(node, addr))
+    profile->pci = (bus_access_counts_t*)realloc(profile->pci, (index + 1) * sizeof(bus_access_counts_t));
+    memset(&profile->pci[index], 0, sizeof(bus_access_counts_t));
+
+    for (u32 addr = attachment->addr_start; addr <= attachment->addr_end; addr++)
+        profile->attachment_map[addr] = (u16)(index + 1);
+}
+#endif
+
+// Address within a PCI unit's first mirror
+static inline u16 bus_mirror_addr(u16 pci_start, u16 mirror_mask, u16 addr) {
+    return (u16)(pci_start + ((addr - pci_start) & mirror_mask));
+}
+
+// Find the attachment of the PCI unit mapped at an address
+static inline const bus_attachment_t* bus_find_attachment(bus_t* bus, u16 addr) {
+    const interval_t* range = NULL;
+
+    if (bus->sealed) {
+        // Pages hold few ranges, scanned in address order
+        bus_page_ranges_t page_ranges = bus->page_ranges[addr >> BUS_PAGE_BITS];
+        const interval_t* candidate = &bus->sealed_ranges[page_ranges.first];
+        const interval_t* last = candidate + page_ranges.count;
+
+        while (candidate < last && candidate->end < addr)
+            candidate++;
+
+        if (candidate < last && candidate->begin <= addr)
+            range = candidate;
+    }
+    else {
+        range = interval_map_search(bus->pci_map, addr);
+    }
+
+    if (range == NULL)
+        return NULL;
+
+    return &bus->attachments[(size_t)range->data];
+}
+
+// Load from a device, through the input log if it's nondeterministic and one is attached
+static inline u8 bus_load_device(bus_t* bus, pci_t* pci, u16 addr) {
+    input_log_t* log = bus->input_log;
+    if (log == NULL || !pci->nondeterministic)
+        return pci->on_load(pci, addr);
+
+    u64 cycle = bus_get_cycle(bus);
+    u8 value = 0;
+
+    if (input_log_get_mode(log) == INPUT_LOG_REPLAY) {
+        if (!input_log_replay(log, cycle, addr, &value))
+            value = pci->on_load(pci, addr);
+    }
+    else {
+        value = pci->on_load(pci, addr);
+        input_log_record(log, cycle, addr, value);
+    }
+
+    return value;
+}
+
+// Load from a page without direct host memory
+static b8 bus_load_slow(bus_t* bus, u16 addr, u8* load) {
+    const bus_attachment_t* attachment = bus_find_attachment(bus, addr);
+
+    if (attachment) {
+        pci_t* pci = attachment->pci;
+        addr = bus_mirror_addr(attachment->addr_start, (u16)(attachment->mirror_size - 1), addr);
+
+        if (pci->kind == PCI_KIND_MEMORY) {
+            *load = pci->memory[attachment->bank_offset + (addr - attachment->addr_start)];
+            return TRUE;
+        }
+        if (pci->on_load) {
+            *load = bus_load_device(bus, pci, addr);
+            return TRUE;
+        }
+    }
+
+    // TODO: should probably throw an exception instead
+    *load = U8_MAX;
+    return FALSE;
+}
+
+// Store to a page without direct host memory
+static b8 bus_store_slow(bus_t* bus, u16 addr, u8 value) {
+    const bus_attachment_t* attachment = bus_find_attachment(bus, addr);
+
+    if (attachment) {
+        pci_t* pci = attachment->pci;
+        addr = bus_mirror_addr(attachment->addr_start, (u16)(attachment->mirror_size - 1), addr);
+
+        if (pci->kind == PCI_KIND_MEMORY) {
+            if (pci->read_only)
+                return FALSE;
+
+            pci->memory[attachment->bank_offset + (addr - attachment->addr_start)] = value;
+            return TRUE;
+        }
+        if (pci->on_store) {
+            pci->on_store(pci, addr, value);
+            return TRUE;
+        }
+    }
+
+    // TODO: should probably throw an exception here too
+    return FALSE;
+}
+
+// Load through the page table, from a page without a load pointer
+static b8 bus_load_dispatch(bus_t* bus, u16 addr, u8* load) {
+    pci_t* pci = bus->pci_pages[addr >> BUS_PAGE_BITS];
+    if (pci == NULL)
+        return bus_load_slow(bus, addr, load);
+
+    // Whole pages of memory only lack a load pointer while profiled or watched
+    if (pci->kind == PCI_KIND_MEMORY) {
+        *load = bus_get_page_memory(bus, addr >> BUS_PAGE_BITS)[addr & BUS_PAGE_MASK];
+        return TRUE;
+    }
+
+    if (pci->on_load) {
+        *load = bus_load_device(bus, pci, bus_mirror_addr(bus->pci_page_starts[addr >> BUS_PAGE_BITS], bus->pci_page_masks[addr >> BUS_PAGE_BITS], addr));
+        return TRUE;
+    }
+
+    *load = U8_MAX;
+    return FALSE;
+}
+
+// Store through the page table, to a page without a store pointer
+static b8 bus_store_dispatch(bus_t* bus, u16 addr, u8 value) {
+    u32 page = addr >> BUS_PAGE_BITS;
+
+    pci_t* pci = bus->pci_pages[page];
+    if (pci == NULL)
+        return bus_store_slow(bus, addr, value);
+
+    // Whole pages of memory without a store pointer are read-only, or being profiled or watched
+    if (pci->kind == PCI_KIND_MEMORY) {
+        if (pci->read_only)
+            return FALSE;
+
+        bus->memory_pages[page][addr & BUS_PAGE_MASK] = value;
+        return TRUE;
+    }
+
+    if (pci->on_store) {
+        pci->on_store(pci, bus_mirror_addr(bus->pci_page_starts[page], bus->pci_page_masks[page], addr), value);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+// Get the device PCI unit covering a whole page, if block transfers may hand it runs directly:
+// not while the page is profiled, or watched for the access
+static inline pci_t* bus_block_device(bus_t* bus, u32 page, u8 watch_flag) {
+    pci_t* pci = bus->pci_pages[page];
+
+#if BUS_PROFILE
+    if (bus->profile)
+        return NULL;
+#endif
+
+    if (pci == NULL || pci->kind != PCI_KIND_DEVICE || (bus->page_flags[page] & watch_flag))
+        return NULL;
+
+    return pci;
+}
+
+// Clip a run on a device's page to the device's mirror
+// @param[out] device_addr Address within the first mirror the run starts at
+// @returns Length of the run
+static inline u32 bus_block_device_run(bus_t* bus, u32 page, u16 addr, u32 count, u16* device_addr) {
+    u16 start = bus->pci_page_starts[page];
+    u32 mirror_size = (u32)bus->pci_page_masks[page] + 1;
+    u32 offset = (u16)(addr - start) & bus->pci_page_masks[page];
+
+    *device_addr = (u16)(start + offset);
+    return count < mirror_size - offset ? count : mirror_size - offset;
+}
+
+// Notify the watch listener of an access on a watched page, if a watchpoint covers the address
+static void bus_check_watchpoints(bus_t* bus, u16 addr, u8 value, u32 access) {
+    for (u32 i = 0; i < bus->num_watchpoints; i++) {
+        const bus_watchpoint_t* watchpoint = &bus->watchpoints[i];
+
+        if ((watchpoint->access & access) && addr >= watchpoint->addr_start && addr <= watchpoint->addr_end) {
+            if (bus->on_watch)
+                bus->on_watch(bus->on_watch_user, addr, value, access);
+            return;
+        }
+    }
+}
+
+// Recompute the watch flags of the pages a range overlaps
+static void bus_update_watch_pages(bus_t* bus, u16 addr_start, u16 addr_end) {
+    for (u32 page = addr_start >> BUS_PAGE_BITS; page <= (u32)(addr_end >> BUS_PAGE_BITS); page++) {
+        u32 page_start = page << BUS_PAGE_BITS;
+        u8 flags = 0;
+
+        for (u32 i = 0; i < bus->num_watchpoints; i++) {
+            const bus_watchpoint_t* watchpoint = &bus->watchpoints[i];
+
+            if (watchpoint->addr_start > page_start + BUS_PAGE_MASK || watchpoint->addr_end < page_start)
+                continue;
+            if (watchpoint->access & BUS_WATCH_LOAD)
+                flags |= BUS_PAGE_FLAG_WATCH_LOAD;
+            if (watchpoint->access & BUS_WATCH_STORE)
+                flags |= BUS_PAGE_FLAG_WATCH_STORE;
+        }
+
+        bus->page_flags[page] = (bus->page_flags[page] & ~(BUS_PAGE_FLAG_WATCH_LOAD | BUS_PAGE_FLAG_WATCH_STORE)) | flags;
+        bus_update_page(bus, page);
+    }
+}
+
+// @returns True if event `a` is due before event `b`
+static inline b8 bus_event_before(const bus_event_t* a, const bus_event_t* b) {
+    return a->deadline < b->deadline || (a->deadline == b->deadline && a->sequence < b->sequence);
+}
+
+static void bus_event_sift_up(bus_t* bus, u32 index) {
+    bus_event_t event = bus->events[index];
+
+    while (index > 0) {
+        u32 parent = (index - 1) / 2;
+        if (!bus_event_before(&event, &bus->events[parent]))
             break;
+
+        bus->events[index] = bus->events[parent];
+        index = parent;
     }
 
-    return node;
+    bus->events[index] = event;
 }
 
-static inline void bus_cache_push(bus_t* bus, interval_node_t* node) {
-    // Push all elements down
-    for (u32 i = BUS_PCI_NODE_CACHE_SIZE - 1; i > 0; i--) {
-        bus->pci_node_cache[i] = bus->pci_node_cache[i - 1];
+static void bus_event_sift_down(bus_t* bus, u32 index) {
+    bus_event_t event = bus->events[index];
+
+    for (;;) {
+        u32 child = index * 2 + 1;
+        if (child >= bus->num_events)
+            break;
+
+        if (child + 1 < bus->num_events && bus_event_before(&bus->events[child + 1], &bus->events[child]))
+            child++;
+        if (!bus_event_before(&bus->events[child], &event))
+            break;
+
+        bus->events[index] = bus->events[child];
+        index = child;
     }
 
-    // Insert new first element
-    bus->pci_node_cache[0] = node;
+    bus->events[index] = event;
+}
+
+// Remove an event from the heap, keeping `next_deadline` current
+static void bus_event_remove(bus_t* bus, u32 index) {
+    bus->num_events--;
+
+    if (index < bus->num_events) {
+        bus->events[index] = bus->events[bus->num_events];
+        bus_event_sift_up(bus, index);
+        bus_event_sift_down(bus, index);
+    }
+
+    bus->next_deadline = bus->num_events ? bus->events[0].deadline : U64_MAX;
 }
 
 
 bus_t* bus_create() {
-    return (bus_t*)calloc(1, sizeof(bus_t));
+    bus_t* bus = (bus_t*)calloc(1, sizeof(bus_t));
+    bus->pci_map = interval_map_create();
+    bus->next_deadline = U64_MAX;
+
+    for (u32 page = 0; page < BUS_PAGE_COUNT; page++)
+        bus->page_aliases[page] = (u16)page;
+
+    return bus;
 }
 
 void bus_free(bus_t* bus) {
+    // Before the owned PCI units go, as this remaps pages they are attached to
+    bus_disable_profiling(bus);
+
+    interval_map_free(bus->pci_map);
+
+    for (u32 i = 0; i < bus->num_owned_pci; i++)
+        pci_free(bus->owned_pci[i]);
+
+    free(bus->owned_pci);
+
+    free(bus->attachments);
+    free(bus->events);
+    free(bus->watchpoints);
     free(bus);
 }
 
 b8 bus_attach_pci(bus_t* bus, pci_t* pci, u16 addr_start, u16 addr_end) {
-    interval_node_t* pci_node = interval_tree_insert(bus->pci_root, addr_start, addr_end, (void*)pci);
-    if (pci_node) {
-        if (bus->pci_root == NULL)
-            bus->pci_root = pci_node;
+    return bus_attach_pci_mirrored(bus, pci, addr_start, addr_end, BUS_ADDR_MAX + 1);
+}
+
+b8 bus_attach_pci_mirrored(bus_t* bus, pci_t* pci, u16 addr_start, u16 addr_end, u32 mirror_size) {
+    assert(mirror_size > 0 && mirror_size <= BUS_ADDR_MAX + 1 && (mirror_size & (mirror_size - 1)) == 0);
+
+    u32 size = (u32)(addr_end - addr_start) + 1;
+    u32 mirror_mask = mirror_size - 1;
+
+    if (pci->kind == PCI_KIND_MEMORY && (size < mirror_size ? size : mirror_size) > pci->memory_size)
+        return FALSE;
+
+    // Ranges refer to their attachment by index, as the attachments array moves
+    if (interval_map_insert(bus->pci_map, addr_start, addr_end, (void*)(size_t)bus->num_pci)) {
+        bus->sealed = FALSE;
+
+        // Map every page the PCI unit covers entirely
+        for (u32 page = addr_start >> BUS_PAGE_BITS; page <= (u32)(addr_end >> BUS_PAGE_BITS); page++) {
+            u32 page_start = page << BUS_PAGE_BITS;
+            u32 page_end = page_start + BUS_PAGE_SIZE - 1;
+            u32 offset = (page_start - addr_start) & mirror_mask;
+
+            if (page_start < addr_start || page_end > addr_end)
+                continue;
+
+            // Memory mirrored in windows smaller than a page, or not aligned to pages, isn't contiguous within one
+            if (pci->kind == PCI_KIND_MEMORY && offset + BUS_PAGE_SIZE > mirror_size)
+                continue;
+
+            bus->pci_pages[page] = pci;
+            bus->pci_page_starts[page] = addr_start;
+            bus->pci_page_masks[page] = (u16)mirror_mask;
+
+            if (pci->kind == PCI_KIND_MEMORY) {
+                bus->memory_pages[page] = &pci->memory[offset];
+
+                // Join the ring of the page mirroring the same memory one window down. Unmirrored memory has none.
+                if (mirror_size <= BUS_ADDR_MAX && page_start - addr_start >= mirror_size) {
+                    u32 mirror = page - (mirror_size >> BUS_PAGE_BITS);
+                    bus->page_aliases[page] = bus->page_aliases[mirror];
+                    bus->page_aliases[mirror] = (u16)page;
+                }
+            }
+
+            bus_update_page(bus, page);
+        }
+
+        bus->attachments = (bus_attachment_t*)realloc(bus->attachments, (bus->num_pci + 1) * sizeof(bus_attachment_t));
+        bus->attachments[bus->num_pci].pci = pci;
+        bus->attachments[bus->num_pci].addr_start = addr_start;
+        bus->attachments[bus->num_pci].addr_end = addr_end;
+        bus->attachments[bus->num_pci].mirror_size = mirror_size;
+        bus->attachments[bus->num_pci].bank_offset = 0;
+
+#if BUS_PROFILE
+        if (bus->profile)
+            bus_profile_attach(bus, bus->num_pci);
+#endif
 
         bus->num_pci++;
         return TRUE;
@@ -57,41 +586,544 @@ b8 bus_attach_pci(bus_t* bus, pci_t* pci, u16 addr_start, u16 addr_end) {
 }
 
 b8 bus_load(bus_t* bus, u16 addr, u8* load) {
-    assert(bus->pci_root != NULL);
-
-    interval_node_t* pci_node = bus_cache_search(bus, addr);
-    if (!pci_node)
-        pci_node = interval_tree_search(bus->pci_root, addr);
-    
-    if (pci_node) {
-        pci_t* pci = interval_node_get_data(pci_node);
-        if (pci && pci->on_load) {
-            *load = pci->on_load(pci, addr);
-            bus_cache_push(bus, pci_node);
+    assert(bus->num_pci > 0);
+
+#if BUS_PROFILE
+    if (bus->profile)
+        bus_profile_access(bus, addr, FALSE);
+#endif
+
+    u8* memory = bus->load_pages[addr >> BUS_PAGE_BITS];
+    if (memory) {
+        *load = memory[addr & BUS_PAGE_MASK];
+        return TRUE;
+    }
+
+    if (bus->page_flags[addr >> BUS_PAGE_BITS] & BUS_PAGE_FLAG_WATCH_LOAD) {
+        b8 loaded = bus_load_dispatch(bus, addr, load);
+        bus_check_watchpoints(bus, addr, *load, BUS_WATCH_LOAD);
+        return loaded;
+    }
+
+    return bus_load_dispatch(bus, addr, load);
+}
+
+b8 bus_store(bus_t* bus, u16 addr, u8 value) {
+    assert(bus->num_pci > 0);
+
+    u32 page = addr >> BUS_PAGE_BITS;
+    u8* memory = bus->store_pages[page];
+
+#if BUS_PROFILE
+    if (bus->profile)
+        bus_profile_access(bus, addr, TRUE);
+#endif
+
+    // Pages holding decoded instructions, tracked for dirtiness or shared have no store pointer until faulted
+    if (memory == NULL && bus_page_faults(bus, page)) {
+        bus_fault_page(bus, page);
+        memory = bus->store_pages[page];
+    }
+
+    if (memory) {
+        memory[addr & BUS_PAGE_MASK] = value;
+        return TRUE;
+    }
+
+    if (bus->page_flags[page] & BUS_PAGE_FLAG_WATCH_STORE) {
+        b8 stored = bus_store_dispatch(bus, addr, value);
+        bus_check_watchpoints(bus, addr, value, BUS_WATCH_STORE);
+        return stored;
+    }
+
+    return bus_store_dispatch(bus, addr, value);
+}
+
+b8 bus_load_block(bus_t* bus, u16 addr, u8* buffer, u32 size) {
+    assert(bus->num_pci > 0);
+    assert(size <= BUS_ADDR_MAX + 1);
+
+    b8 loaded = TRUE;
+
+    while (size > 0) {
+        u32 page = addr >> BUS_PAGE_BITS;
+        u32 count = BUS_PAGE_SIZE - (addr & BUS_PAGE_MASK);
+        if (count > size)
+            count = size;
+
+        u8* memory = bus->load_pages[page];
+        pci_t* device = bus_block_device(bus, page, BUS_PAGE_FLAG_WATCH_LOAD);
+
+        if (memory) {
+            memcpy(buffer, &memory[addr & BUS_PAGE_MASK], count);
+        }
+        // Input logs record and replay loads one by one
+        else if (device && device->on_load_block && !(device->nondeterministic && bus->input_log)) {
+            u16 device_addr = 0;
+            count = bus_block_device_run(bus, page, addr, count, &device_addr);
+            device->on_load_block(device, device_addr, buffer, count);
+        }
+        else {
+            for (u32 i = 0; i < count; i++)
+                loaded &= bus_load(bus, (u16)(addr + i), &buffer[i]);
+        }
+
+        addr = (u16)(addr + count);
+        buffer += count;
+        size -= count;
+    }
+
+    return loaded;
+}
+
+b8 bus_store_block(bus_t* bus, u16 addr, const u8* buffer, u32 size) {
+    assert(bus->num_pci > 0);
+    assert(size <= BUS_ADDR_MAX + 1);
+
+    b8 stored = TRUE;
+
+    while (size > 0) {
+        u32 page = addr >> BUS_PAGE_BITS;
+        u32 count = BUS_PAGE_SIZE - (addr & BUS_PAGE_MASK);
+        if (count > size)
+            count = size;
+
+        u8* memory = bus->store_pages[page];
+        if (memory == NULL && bus_page_faults(bus, page)) {
+            bus_fault_page(bus, page);
+            memory = bus->store_pages[page];
+        }
+
+        pci_t* device = bus_block_device(bus, page, BUS_PAGE_FLAG_WATCH_STORE);
+
+        if (memory) {
+            memcpy(&memory[addr & BUS_PAGE_MASK], buffer, count);
+        }
+        else if (device && device->on_store_block) {
+            u16 device_addr = 0;
+            count = bus_block_device_run(bus, page, addr, count, &device_addr);
+            device->on_store_block(device, device_addr, buffer, count);
+        }
+        else {
+            for (u32 i = 0; i < count; i++)
+                stored &= bus_store(bus, (u16)(addr + i), buffer[i]);
+        }
+
+        addr = (u16)(addr + count);
+        buffer += count;
+        size -= count;
+    }
+
+    return stored;
+}
+
+u8* const* bus_get_load_pages(bus_t* bus) {
+    return bus->load_pages;
+}
+
+u8* const* bus_get_store_pages(bus_t* bus) {
+    return bus->store_pages;
+}
+
+void bus_set_invalidate_callback(bus_t* bus, bus_on_invalidate_fn on_invalidate, void* user) {
+    bus->on_invalidate = on_invalidate;
+    bus->on_invalidate_user = user;
+}
+
+u32 bus_add_watchpoint(bus_t* bus, u16 addr_start, u16 addr_end, u32 access) {
+    assert(addr_end >= addr_start && access != 0 && (access & ~(BUS_WATCH_LOAD | BUS_WATCH_STORE)) == 0);
+
+    u32 index = 0;
+    while (index < bus->num_watchpoints && bus->watchpoints[index].access)
+        index++;
+
+    if (index == bus->num_watchpoints) {
+        bus->watchpoints = (bus_watchpoint_t*)realloc(bus->watchpoints, (bus->num_watchpoints + 1) * sizeof(bus_watchpoint_t));
+        bus->num_watchpoints++;
+    }
+
+    bus->watchpoints[index].addr_start = addr_start;
+    bus->watchpoints[index].addr_end = addr_end;
+    bus->watchpoints[index].access = access;
+    bus_update_watch_pages(bus, addr_start, addr_end);
+
+    return index + 1;
+}
+
+b8 bus_remove_watchpoint(bus_t* bus, u32 watchpoint) {
+    if (watchpoint == 0 || watchpoint > bus->num_watchpoints || bus->watchpoints[watchpoint - 1].access == 0)
+        return FALSE;
+
+    bus_watchpoint_t* removed = &bus->watchpoints[watchpoint - 1];
+    removed->access = 0;
+    bus_update_watch_pages(bus, removed->addr_start, removed->addr_end);
+
+    return TRUE;
+}
+
+void bus_set_watch_callback(bus_t* bus, bus_on_watch_fn on_watch, void* user) {
+    bus->on_watch = on_watch;
+    bus->on_watch_user = user;
+}
+
+void bus_seal(bus_t* bus) {
+    bus->sealed_ranges = interval_map_get_intervals(bus->pci_map);
+
+    for (u32 page = 0; page < BUS_PAGE_COUNT; page++) {
+        u32 page_start = page << BUS_PAGE_BITS;
+        u32 first = 0;
+        u32 count = interval_map_query(bus->pci_map, page_start, page_start + BUS_PAGE_MASK, &first);
+
+        bus->page_ranges[page].first = (u16)first;
+        bus->page_ranges[page].count = (u16)count;
+    }
+
+    bus->sealed = TRUE;
+}
+
+b8 bus_is_sealed(bus_t* bus) {
+    return bus->sealed;
+}
+
+u32 bus_query_pci(bus_t* bus, u16 addr_start, u16 addr_end, pci_t** pci, u16* pci_start, u32 max_pci) {
+    u32 first = 0;
+    u32 count = interval_map_query(bus->pci_map, addr_start, addr_end, &first);
+    const interval_t* ranges = interval_map_get_intervals(bus->pci_map);
+
+    for (u32 i = 0; i < count && i < max_pci; i++) {
+        if (pci != NULL)
+            pci[i] = bus->attachments[(size_t)ranges[first + i].data].pci;
+        if (pci_start != NULL)
+            pci_start[i] = (u16)ranges[first + i].begin;
+    }
+
+    return count;
+}
+
+void bus_mark_code_page(bus_t* bus, u32 page) {
+    // Stores through any mirror of the page must fault
+    BUS_FOR_EACH_ALIAS(bus, page, alias) {
+        bus->page_flags[alias] |= BUS_PAGE_FLAG_CODE;
+        bus_update_page(bus, alias);
+    }
+}
+
+void bus_adopt_pci(bus_t* bus, pci_t* pci) {
+    bus->owned_pci = (pci_t**)realloc(bus->owned_pci, (bus->num_owned_pci + 1) * sizeof(pci_t*));
+    bus->owned_pci[bus->num_owned_pci++] = pci;
+}
+
+u32 bus_get_num_pci(bus_t* bus) {
+    return bus->num_pci;
+}
+
+pci_t* bus_get_pci(bus_t* bus, u32 index, u16* addr_start, u16* addr_end) {
+    if (index >= bus->num_pci)
+        return NULL;
+
+    if (addr_start != NULL)
+        *addr_start = bus->attachments[index].addr_start;
+    if (addr_end != NULL)
+        *addr_end = bus->attachments[index].addr_end;
+
+    return bus->attachments[index].pci;
+}
+
+u32 bus_get_pci_mirror_size(bus_t* bus, u32 index) {
+    assert(index < bus->num_pci);
+    return bus->attachments[index].mirror_size;
+}
+
+b8 bus_switch_bank(bus_t* bus, u32 index, u32 offset) {
+    assert(index < bus->num_pci);
+
+    bus_attachment_t* attachment = &bus->attachments[index];
+    pci_t* pci = attachment->pci;
+    u32 size = (u32)(attachment->addr_end - attachment->addr_start) + 1;
+    u32 window = size < attachment->mirror_size ? size : attachment->mirror_size;
+
+    if (pci->kind != PCI_KIND_MEMORY || offset + window > pci->memory_size)
+        return FALSE;
+
+    attachment->bank_offset = offset;
+
+    // Only the pages mapped directly hold pointers into the bank, the rest go through the attachment
+    for (u32 page = attachment->addr_start >> BUS_PAGE_BITS; page <= (u32)(attachment->addr_end >> BUS_PAGE_BITS); page++) {
+        u32 page_start = page << BUS_PAGE_BITS;
+
+        if (bus->memory_pages[page] == NULL || page_start < attachment->addr_start || page_start + BUS_PAGE_MASK > attachment->addr_end)
+            continue;
+
+        // Copy-on-write pages are written back to the bank being left, which would otherwise never see them
+        if (bus->shared_pages[page] != NULL)
+            memcpy(bus->memory_pages[page], bus->shared_pages[page], BUS_PAGE_SIZE);
+
+        bus->memory_pages[page] = &pci->memory[offset + ((page_start - attachment->addr_start) & (attachment->mirror_size - 1))];
+        bus->shared_pages[page] = NULL;
+
+        // The page no longer shows what it did when dirty tracking started
+        if (bus->page_flags[page] & BUS_PAGE_FLAG_TRACK_DIRTY)
+            bus->page_flags[page] = (bus->page_flags[page] & ~BUS_PAGE_FLAG_TRACK_DIRTY) | BUS_PAGE_FLAG_DIRTY;
+
+        bus_refresh_page(bus, page);
+    }
+
+    return TRUE;
+}
+
+u32 bus_get_bank(bus_t* bus, u32 index) {
+    assert(index < bus->num_pci);
+    return bus->attachments[index].bank_offset;
+}
+
+u32 bus_track_dirty_pages(bus_t* bus) {
+    for (u32 page = 0; page < BUS_PAGE_COUNT; page++) {
+        bus->page_flags[page] &= ~(BUS_PAGE_FLAG_DIRTY | BUS_PAGE_FLAG_TRACK_DIRTY);
+
+        if (bus->memory_pages[page] && !bus->pci_pages[page]->read_only)
+            bus->page_flags[page] |= BUS_PAGE_FLAG_TRACK_DIRTY;
+
+        bus_update_page(bus, page);
+    }
+
+    return ++bus->dirty_generation;
+}
+
+u32 bus_get_dirty_generation(bus_t* bus) {
+    return bus->dirty_generation;
+}
+
+b8 bus_test_dirty_page(bus_t* bus, u32 page) {
+    return (bus->page_flags[page] & BUS_PAGE_FLAG_DIRTY) != 0;
+}
+
+void bus_write_page(bus_t* bus, u32 page, const u8* source) {
+    assert(bus->memory_pages[page] != NULL);
+
+    // ROM images may be mapped read-only, and never change
+    if (bus->pci_pages[page]->image)
+        return;
+
+    memcpy(bus->memory_pages[page], source, BUS_PAGE_SIZE);
+
+    BUS_FOR_EACH_ALIAS(bus, page, alias) {
+        bus->shared_pages[alias] = NULL;
+        bus_refresh_page(bus, alias);
+    }
+}
+
+const u8* bus_get_page_memory(bus_t* bus, u32 page) {
+    return bus->shared_pages[page] ? bus->shared_pages[page] : bus->memory_pages[page];
+}
+
+void bus_share_page(bus_t* bus, u32 page, const u8* source) {
+    assert(bus->memory_pages[page] != NULL);
+
+    BUS_FOR_EACH_ALIAS(bus, page, alias) {
+        bus->shared_pages[alias] = source;
+        bus_refresh_page(bus, alias);
+    }
+}
+
+u32 bus_schedule_event(bus_t* bus, u64 deadline, bus_on_event_fn on_event, void* user) {
+    assert(on_event != NULL);
+
+    if (bus->num_events == bus->events_capacity) {
+        bus->events_capacity = bus->events_capacity ? bus->events_capacity * 2 : 16;
+        bus->events = (bus_event_t*)realloc(bus->events, bus->events_capacity * sizeof(bus_event_t));
+    }
+
+    if (++bus->last_event_id == 0)
+        bus->last_event_id = 1;
+
+    bus_event_t* event = &bus->events[bus->num_events++];
+    event->deadline = deadline;
+    event->sequence = bus->event_sequence++;
+    event->on_event = on_event;
+    event->user = user;
+    event->id = bus->last_event_id;
+
+    bus_event_sift_up(bus, bus->num_events - 1);
+    bus->next_deadline = bus->events[0].deadline;
+
+    return bus->last_event_id;
+}
+
+b8 bus_cancel_event(bus_t* bus, u32 event) {
+    for (u32 i = 0; i < bus->num_events; i++) {
+        if (bus->events[i].id == event) {
+            bus_event_remove(bus, i);
             return TRUE;
         }
     }
 
-    // TODO: should probably throw an exception instead
-    *load = U8_MAX;
     return FALSE;
 }
 
-b8 bus_store(bus_t* bus, u16 addr, u8 value) {
-    assert(bus->pci_root != NULL);
+const u64* bus_get_next_deadline(bus_t* bus) {
+    return &bus->next_deadline;
+}
 
-    interval_node_t* pci_node = bus_cache_search(bus, addr);
-    if (!pci_node)
-        pci_node = interval_tree_search(bus->pci_root, addr);
+void bus_set_cycle_counter(bus_t* bus, const u64* cycles) {
+    bus->cycles = cycles;
+}
 
-    if (pci_node) {
-        pci_t* pci = interval_node_get_data(pci_node);
-        if (pci && pci->on_store) {
-            pci->on_store(pci, addr, value);
-            bus_cache_push(bus, pci_node);
-        }
+u64 bus_get_cycle(bus_t* bus) {
+    return bus->cycles ? *bus->cycles : 0;
+}
+
+void bus_set_input_log(bus_t* bus, input_log_t* log) {
+    bus->input_log = log;
+}
+
+void bus_dispatch_events(bus_t* bus, u64 cycle) {
+    // The root is re-read every time, callbacks may have changed the heap
+    while (bus->num_events && bus->events[0].deadline <= cycle) {
+        bus_event_t event = bus->events[0];
+        bus_event_remove(bus, 0);
+
+        event.on_event(bus, event.user, event.deadline);
     }
+}
 
-    // TODO: should probably throw an exception here too
+b8 bus_enable_profiling(bus_t* bus, b8 per_address) {
+#if BUS_PROFILE
+    bus_disable_profiling(bus);
+
+    bus->profile = (bus_profile_t*)calloc(1, sizeof(bus_profile_t));
+    if (per_address)
+        bus->profile->addresses = (bus_access_counts_t*)calloc(BUS_ADDR_MAX + 1, sizeof(bus_access_counts_t));
+
+    for (u32 i = 0; i < bus->num_pci; i++)
+        bus_profile_attach(bus, i);
+
+    // Instruction fetches from cached or translated code would never reach the bus
+    for (u32 page = 0; page < BUS_PAGE_COUNT; page++) {
+        if (bus->page_flags[page] & BUS_PAGE_FLAG_CODE)
+            bus_invalidate_page(bus, page);
+        else
+            bus_update_page(bus, page);
+    }
+
+    return TRUE;
+#else
+    (void)bus;
+    (void)per_address;
     return FALSE;
-}
\ No newline at end of file
+#endif
+}
+
+void bus_disable_profiling(bus_t* bus) {
+#if BUS_PROFILE
+    if (bus->profile == NULL)
+        return;
+
+    free(bus->profile->pci);
+    free(bus->profile->addresses);
+    free(bus->profile);
+    bus->profile = NULL;
+
+    for (u32 page = 0; page < BUS_PAGE_COUNT; page++)
+        bus_update_page(bus, page);
+#else
+    (void)bus;
+#endif
+}
+
+void bus_reset_profile(bus_t* bus) {
+    bus_profile_t* profile = bus->profile;
+    if (profile == NULL)
+        return;
+
+    memset(&profile->stats, 0, sizeof(profile->stats));
+    memset(profile->pages, 0, sizeof(profile->pages));
+    memset(profile->pci, 0, bus->num_pci * sizeof(bus_access_counts_t));
+
+    if (profile->addresses)
+        memset(profile->addresses, 0, (BUS_ADDR_MAX + 1) * sizeof(bus_access_counts_t));
+}
+
+void bus_get_profile_stats(bus_t* bus, bus_profile_stats_t* stats) {
+    if (bus->profile)
+        *stats = bus->profile->stats;
+    else
+        memset(stats, 0, sizeof(bus_profile_stats_t));
+}
+
+void bus_get_pci_profile(bus_t* bus, u32 index, bus_access_counts_t* counts) {
+    if (bus->profile && index < bus->num_pci)
+        *counts = bus->profile->pci[index];
+    else
+        memset(counts, 0, sizeof(bus_access_counts_t));
+}
+
+void bus_get_page_profile(bus_t* bus, u32 page, bus_access_counts_t* counts) {
+    if (bus->profile && page < BUS_PAGE_COUNT)
+        *counts = bus->profile->pages[page];
+    else
+        memset(counts, 0, sizeof(bus_access_counts_t));
+}
+
+void bus_get_addr_profile(bus_t* bus, u16 addr, bus_access_counts_t* counts) {
+    if (bus->profile && bus->profile->addresses)
+        *counts = bus->profile->addresses[addr];
+    else
+        memset(counts, 0, sizeof(bus_access_counts_t));
+}
+
+#define BUS_DUMP_HOT_ADDRESSES 16
+
+void bus_dump_profile(bus_t* bus, FILE* file) {
+    bus_profile_t* profile = bus->profile;
+    if (profile == NULL) {
+        fprintf(file, "bus profile: not profiling\n");
+        return;
+    }
+
+    fprintf(file, "bus profile: %llu page table hits, %llu range searches, %llu unmapped\n",
+        profile->stats.page_hits, profile->stats.range_searches, profile->stats.unmapped);
+
+    fprintf(file, "PCI units:\n");
+    for (u32 i = 0; i < bus->num_pci; i++) {
+        bus_attachment_t* attachment = &bus->attachments[i];
+        fprintf(file, "  %-20s $%04x-$%04x: %llu loads, %llu stores\n", attachment->pci->name ? attachment->pci->name : "(unnamed)",
+            attachment->addr_start, attachment->addr_end, profile->pci[i].loads, profile->pci[i].stores);
+    }
+
+    fprintf(file, "pages:\n");
+    for (u32 page = 0; page < BUS_PAGE_COUNT; page++) {
+        bus_access_counts_t* counts = &profile->pages[page];
+        if (counts->loads || counts->stores)
+            fprintf(file, "  $%04x: %llu loads, %llu stores\n", page << BUS_PAGE_BITS, counts->loads, counts->stores);
+    }
+
+    if (profile->addresses == NULL)
+        return;
+
+    // Selection of the hottest addresses, each pass picking the hottest one below the previous pick
+    fprintf(file, "hottest addresses:\n");
+    u64 previous_total = U64_MAX;
+    u32 previous_addr = 0;
+
+    for (u32 n = 0; n < BUS_DUMP_HOT_ADDRESSES; n++) {
+        u64 best_total = 0;
+        u32 best_addr = 0;
+
+        for (u32 addr = 0; addr <= BUS_ADDR_MAX; addr++) {
+            u64 total = profile->addresses[addr].loads + profile->addresses[addr].stores;
+            b8 below_previous = total < previous_total || (total == previous_total && addr > previous_addr);
+
+            if (below_previous && total > best_total) {
+                best_total = total;
+                best_addr = addr;
+            }
+        }
+
+        if (best_total == 0)
+            break;
+
+        fprintf(file, "  $%04x: %llu loads, %llu stores\n", best_addr, profile->addresses[best_addr].loads, profile->addresses[best_addr].stores);
+        previous_total = best_total;
+        previous_addr = best_addr;
+    }
+}
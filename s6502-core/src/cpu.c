@@ -1,445 +1,1210 @@
-#include "s6502/cpu.h"
+#include "cpu_internal.h"
+#include "cpu_opcodes.h"
+#include "jit.h"
+
+// Threaded dispatch through computed goto is only available as a GNU extension
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(S6502_NO_COMPUTED_GOTO)
+    #define CPU_COMPUTED_GOTO 1
+#else
+    #define CPU_COMPUTED_GOTO 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define CPU_FORCE_INLINE inline __attribute__((always_inline))
+    #define CPU_NO_INLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+    #define CPU_FORCE_INLINE __forceinline
+    #define CPU_NO_INLINE __declspec(noinline)
+#else
+    #define CPU_FORCE_INLINE inline
+    #define CPU_NO_INLINE
+#endif
 
-struct cpu_s {
-    u8 a, x, y, sp, status;
-    u16 pc;
-    u64 cycles;
-    bus_t* bus;
-};
 
-static const cpu_instruction_info_t g_cpu_instruction_info_table[256];
+// Utilities
 
+// N and Z are only recorded here, and assembled into the status register when it's read (`cpu_get_status`)
+static inline void cpu_eval_nz_flags(cpu_t* cpu, u8 value) {
+    cpu->n_result = value;
+    cpu->z_result = value;
+}
 
-// Utilities
+static inline void cpu_eval_carry_flag(cpu_t* cpu, b8 carry) {
+    cpu->carry = carry ? CPU_STATUS_FLAG_CARRY_BIT : 0;
+}
 
-static inline void cpu_eval_status(cpu_t* cpu, cpu_status_flags flag, u8 result) {
-    if (result)
-        cpu->status |= flag;
-    else 
-        cpu->status &= ~flag;
+static inline b8 eval_page_boundary(u16 a, u16 b) {
+    return ((a & 0xff00) != (b & 0xff00));
 }
 
-static inline void cpu_eval_zero_flag(cpu_t* cpu, u8 value) {
-    if (value == 0)
-        cpu->status |= CPU_STATUS_FLAG_ZERO_BIT;
-    else
-        cpu->status &= ~CPU_STATUS_FLAG_ZERO_BIT;
+static inline u8 cpu_load(cpu_t* cpu, u16 addr) {
+    u8* memory = cpu->load_pages[addr >> BUS_PAGE_BITS];
+    if (memory)
+        return memory[addr & BUS_PAGE_MASK];
+
+    u8 value = 0;
+    bus_load(cpu->bus, addr, &value);
+    cpu_clamp_stop(cpu);
+    return value;
 }
 
-static inline void cpu_eval_negative_flag(cpu_t* cpu, u8 value) {
-    if ((i8)value < 0)
-        cpu->status |= CPU_STATUS_FLAG_NEGATIVE_BIT;
-    else
-        cpu->status &= ~CPU_STATUS_FLAG_NEGATIVE_BIT;
-    
+static inline u16 cpu_load16(cpu_t* cpu, u16 addr) {
+    return (u16)(cpu_load(cpu, addr) | (cpu_load(cpu, (u16)(addr + 1)) << 8));
 }
 
-static inline void cpu_eval_carry_flag(cpu_t* cpu, u8 value) {
-    u8 result = value >> CPU_STATUS_CARRY_INDEX;
-    cpu->status |= (result)
-        ? CPU_STATUS_FLAG_CARRY_BIT
-        : ~CPU_STATUS_FLAG_CARRY_BIT;
+static inline void cpu_store(cpu_t* cpu, u16 addr, u8 value) {
+    u8* memory = cpu->store_pages[addr >> BUS_PAGE_BITS];
+    if (memory) {
+        memory[addr & BUS_PAGE_MASK] = value;
+        return;
+    }
+
+    bus_store(cpu->bus, addr, value);
+    cpu_clamp_stop(cpu);
 }
 
-// @returns True if the hi-byte of `b` is different than `a`
-static inline b8 eval_page_boundary(u16 a, u16 b) {
-    return ((a & 0xff00) != (b & 0xff00));
+// Instructions execute with their timing as a constant. With cycle-accurate timing, each access moves
+// `cpu->bus_cycle` on, and the dummy accesses are issued too. Cycles whose access isn't issued (instruction
+// fetches, and dummy reads of the program counter) come from the predecode cache, and only move it on.
+// With fast timing, all of this folds away.
+
+// Let cycles go by without issuing their accesses
+static CPU_FORCE_INLINE void cpu_idle(cpu_t* cpu, b8 accurate, i32 cycles) {
+    if (accurate)
+        cpu->bus_cycle += cycles;
+}
+
+static CPU_FORCE_INLINE u8 cpu_read(cpu_t* cpu, b8 accurate, u16 addr) {
+    u8 value = cpu_load(cpu, addr);
+    cpu_idle(cpu, accurate, 1);
+    return value;
+}
+
+static CPU_FORCE_INLINE void cpu_write(cpu_t* cpu, b8 accurate, u16 addr, u8 value) {
+    cpu_store(cpu, addr, value);
+    cpu_idle(cpu, accurate, 1);
+}
+
+// Dummy accesses are kept out of line, so the many places they're folded away from stay small to compile
+static CPU_NO_INLINE void cpu_dummy_load(cpu_t* cpu, u16 addr) {
+    cpu_read(cpu, TRUE, addr);
+}
+
+static CPU_NO_INLINE void cpu_dummy_store(cpu_t* cpu, u16 addr, u8 value) {
+    cpu_write(cpu, TRUE, addr, value);
+}
+
+// A read whose value is ignored, only issued with cycle-accurate timing
+static CPU_FORCE_INLINE void cpu_dummy_read(cpu_t* cpu, b8 accurate, u16 addr) {
+    if (accurate)
+        cpu_dummy_load(cpu, addr);
+}
+
+static CPU_FORCE_INLINE u16 cpu_read16(cpu_t* cpu, b8 accurate, u16 addr) {
+    u8 lo = cpu_read(cpu, accurate, addr);
+    return (u16)(lo | (cpu_read(cpu, accurate, (u16)(addr + 1)) << 8));
+}
+
+// Read a 16-bit pointer from the zeropage, wrapping around within it
+static CPU_FORCE_INLINE u16 cpu_read16_zeropage(cpu_t* cpu, b8 accurate, u8 addr) {
+    u8 lo = cpu_read(cpu, accurate, addr);
+    return (u16)(lo | (cpu_read(cpu, accurate, (u8)(addr + 1)) << 8));
+}
+
+static CPU_FORCE_INLINE void cpu_stack_push(cpu_t* cpu, b8 accurate, u8 value) {
+    cpu_write(cpu, accurate, CPU_STACK_BASE | cpu->sp--, value);
+}
+
+static CPU_FORCE_INLINE u8 cpu_stack_pull(cpu_t* cpu, b8 accurate) {
+    return cpu_read(cpu, accurate, CPU_STACK_BASE | ++cpu->sp);
+}
+
+// The cycle indexing takes to carry into the high byte. NMOS parts read the address before the carry,
+// the 65C02 reads an instruction byte again.
+// @param[in] uncarried Effective address without the carry
+static CPU_FORCE_INLINE void cpu_index_cycle(cpu_t* cpu, cpu_variant variant, b8 accurate, u16 uncarried) {
+    if (variant == CPU_VARIANT_65C02)
+        cpu_idle(cpu, accurate, 1);
+    else
+        cpu_dummy_read(cpu, accurate, uncarried);
 }
 
-// Apply addressing mode to a given address
+// Index an absolute address
+// @param[in] page_penalty Whether crossing a page boundary costs a cycle (reads). Otherwise the cycle
+//                         is always taken, as part of the base cost (writes and read-modify-writes).
+static CPU_FORCE_INLINE u16 cpu_index(cpu_t* cpu, cpu_variant variant, b8 accurate, u16 base, u8 index, b8 page_penalty) {
+    u16 addr = (u16)(base + index);
+    b8 crossed = eval_page_boundary(base, addr);
+
+    if (page_penalty)
+        cpu->cycles += crossed;
+    if (!page_penalty || crossed)
+        cpu_index_cycle(cpu, variant, accurate, (base & 0xff00) | (addr & 0xff));
+
+    return addr;
+}
+
+// Apply addressing mode to an operand
+// @param[in] variant
+// @param[in] timing
 // @param[in] addr_mode
-// @param[out] address
-// @returns Additional cycle cost from address mode resolution
-static inline u32 cpu_resolve_address(cpu_t* cpu, cpu_address_mode addr_mode, u16* addr) {
-    u16 old_addr = *addr;
+// @param[in] operand
+// @param[in] page_penalty Whether crossing a page boundary during indexing costs a cycle, see `cpu_index`
+// @returns Effective address
+static CPU_FORCE_INLINE u16 cpu_resolve_address(cpu_t* cpu, cpu_variant variant, cpu_timing timing, cpu_address_mode addr_mode, u16 operand, b8 page_penalty) {
+    b8 accurate = timing == CPU_TIMING_CYCLE_ACCURATE;
+    u16 addr = operand;
 
     switch (addr_mode) {
-    case  CPU_ADDRESS_MODE_ZEROPAGE:
-        *addr = old_addr % 0xff;
-        break;
-    case  CPU_ADDRESS_MODE_ZEROPAGE_X:
-        *addr = (old_addr + cpu->x) % 0xff;
-        break;
-    case  CPU_ADDRESS_MODE_ZEROPAGE_Y:
-        *addr = (old_addr + cpu->y) % 0xff;
-        break;
-    case  CPU_ADDRESS_MODE_ABSOLUTE_X:
-        *addr = (old_addr + cpu->x);
-        return eval_page_boundary(old_addr, *addr);
-    case  CPU_ADDRESS_MODE_ABSOLUTE_Y:
-        *addr = (old_addr + cpu->y);
-        return eval_page_boundary(old_addr, *addr);
-    case  CPU_ADDRESS_MODE_INDIRECT_X: {
-        u16 zp_addr = (old_addr + cpu->x) % 0xff;
-        u8 ptr_lo = 0, 
-           ptr_hi = 0;
-        bus_load(cpu->bus, zp_addr, &ptr_lo);
-        bus_load(cpu->bus, zp_addr + 1, &ptr_hi);
-        *addr = (ptr_hi << 8) + ptr_lo;
+    case CPU_ADDRESS_MODE_ZEROPAGE:
+        addr = operand & 0xff;
         break;
-    }
-    case  CPU_ADDRESS_MODE_INDIRECT_Y: {
-        u8 ptr_lo = 0,
-           ptr_hi = 0;
-        bus_load(cpu->bus, old_addr, &ptr_lo);
-        bus_load(cpu->bus, old_addr + 1, &ptr_hi);
-        *addr = ((ptr_hi << 8) + ptr_lo) + cpu->y;
+    case CPU_ADDRESS_MODE_ZEROPAGE_X:
+        cpu_index_cycle(cpu, variant, accurate, operand & 0xff);
+        addr = (operand + cpu->x) & 0xff;
+        break;
+    case CPU_ADDRESS_MODE_ZEROPAGE_Y:
+        cpu_index_cycle(cpu, variant, accurate, operand & 0xff);
+        addr = (operand + cpu->y) & 0xff;
+        break;
+    case CPU_ADDRESS_MODE_ABSOLUTE_X:
+        addr = cpu_index(cpu, variant, accurate, operand, cpu->x, page_penalty);
+        break;
+    case CPU_ADDRESS_MODE_ABSOLUTE_Y:
+        addr = cpu_index(cpu, variant, accurate, operand, cpu->y, page_penalty);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT: {
+        // The 65C02 fetches the pointer's hi-byte from the next page when it has to, taking a cycle more.
+        // NMOS parts fetch it without carrying into the page.
+        u16 hi_addr = variant == CPU_VARIANT_65C02 ? (u16)(operand + 1) : (operand & 0xff00) | ((operand + 1) & 0xff);
+        cpu_idle(cpu, accurate, variant == CPU_VARIANT_65C02);
+
+        u8 lo = cpu_read(cpu, accurate, operand);
+        addr = (u16)(lo | (cpu_read(cpu, accurate, hi_addr) << 8));
         break;
     }
+    case CPU_ADDRESS_MODE_INDIRECT_X:
+        cpu_index_cycle(cpu, variant, accurate, operand & 0xff);
+        addr = cpu_read16_zeropage(cpu, accurate, (u8)(operand + cpu->x));
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT_Y:
+        addr = cpu_index(cpu, variant, accurate, cpu_read16_zeropage(cpu, accurate, (u8)operand), cpu->y, page_penalty);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT_ZEROPAGE:
+        addr = cpu_read16_zeropage(cpu, accurate, (u8)operand);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT_ABSOLUTE_X:
+        cpu_idle(cpu, accurate, 1);
+        addr = cpu_read16(cpu, accurate, (u16)(operand + cpu->x));
+        break;
     default:
         break;
     }
 
-    return 0;
+    return addr;
 }
 
-// Add CPU cycles based on address mode cycle cost
-#define CPU_ADD_CYCLES(imm, zp, zp_x, zp_y, abs, abs_x, abs_y, ind_x, ind_y) \
-    switch (inst.info.address_mode) { \
-    case CPU_ADDRESS_MODE_ZEROPAGE: cycles += zp; break; \
-    case CPU_ADDRESS_MODE_ZEROPAGE_X: cycles += zp_x; break; \
-    case CPU_ADDRESS_MODE_ZEROPAGE_Y: cycles += zp_y; break; \
-    case CPU_ADDRESS_MODE_ABSOLUTE: cycles += abs; break; \
-    case CPU_ADDRESS_MODE_ABSOLUTE_X: cycles += abs_x; break; \
-    case CPU_ADDRESS_MODE_ABSOLUTE_Y: cycles += abs_y; break; \
-    case CPU_ADDRESS_MODE_INDIRECT_X: cycles += ind_x; break; \
-    case CPU_ADDRESS_MODE_INDIRECT_Y: cycles += ind_y; break; \
-    default: cycles = imm; }
+// Read the value an instruction operates on, be it immediate, the accumulator or memory
+static CPU_FORCE_INLINE u8 cpu_read_operand(cpu_t* cpu, cpu_variant variant, cpu_timing timing, cpu_address_mode addr_mode, u16 operand) {
+    switch (addr_mode) {
+    case CPU_ADDRESS_MODE_IMMEDIATE:
+        return (u8)operand;
+    case CPU_ADDRESS_MODE_ACCUMULATOR:
+        return cpu->a;
+    default:
+        return cpu_read(cpu, timing == CPU_TIMING_CYCLE_ACCURATE, cpu_resolve_address(cpu, variant, timing, addr_mode, operand, TRUE));
+    }
+}
 
+// Read the operand of a read-modify-write instruction, the accumulator or memory
+// @param[in] page_penalty See `cpu_index`
+// @param[out] addr Effective address
+static CPU_FORCE_INLINE u8 cpu_read_modify_operand(cpu_t* cpu, cpu_variant variant, cpu_timing timing, cpu_address_mode addr_mode, u16 operand, b8 page_penalty, u16* addr) {
+    if (addr_mode == CPU_ADDRESS_MODE_ACCUMULATOR)
+        return cpu->a;
 
-cpu_t* cpu_create(bus_t* bus) {
-    assert(bus != NULL);
-    
-    cpu_t* cpu = (cpu_t*)calloc(1, sizeof(cpu_t));
-    cpu->bus = bus;
+    *addr = cpu_resolve_address(cpu, variant, timing, addr_mode, operand, page_penalty);
+    return cpu_read(cpu, timing == CPU_TIMING_CYCLE_ACCURATE, *addr);
+}
 
-    return cpu;
+// Write back the result of a read-modify-write instruction. Modifying takes a cycle, in which
+// NMOS parts write the unmodified value back, and the 65C02 reads it again.
+// @param[in] addr Effective address
+// @param[in] original Unmodified value
+// @param[in] value Result
+static CPU_FORCE_INLINE void cpu_write_modify_operand(cpu_t* cpu, cpu_variant variant, cpu_timing timing, cpu_address_mode addr_mode, u16 addr, u8 original, u8 value) {
+    b8 accurate = timing == CPU_TIMING_CYCLE_ACCURATE;
+
+    if (addr_mode == CPU_ADDRESS_MODE_ACCUMULATOR) {
+        cpu->a = value;
+        return;
+    }
+
+    if (accurate && variant == CPU_VARIANT_65C02)
+        cpu_dummy_load(cpu, addr);
+    else if (accurate)
+        cpu_dummy_store(cpu, addr, original);
+
+    cpu_write(cpu, accurate, addr, value);
 }
 
-void cpu_free(cpu_t* cpu) {
-    free(cpu);
+// Taken branches read the next opcode and ignore it, and take another cycle to carry into a different page
+static CPU_FORCE_INLINE void cpu_branch(cpu_t* cpu, b8 accurate, b8 condition, u16 operand) {
+    if (condition) {
+        u16 target = (u16)(cpu->pc + (i8)operand);
+        u32 cycles = 1 + eval_page_boundary(cpu->pc, target);
+
+        cpu->cycles += cycles;
+        cpu_idle(cpu, accurate, cycles);
+        cpu->pc = target;
+    }
 }
 
-cpu_instruction_t cpu_decode(cpu_t* cpu, u32 word) {
-    // The chunk should look like this:
-    // 0. -- 24b 1. ----------- 16b   2. ------------- 8b 3. --- 0b
-    // [opcode ] [operand (8-bit) ]<=>[operand (16-bit) ] [garbage]
+static CPU_FORCE_INLINE void cpu_compare(cpu_t* cpu, u8 reg, u8 m) {
+    cpu_eval_carry_flag(cpu, reg >= m);
+    cpu_eval_nz_flags(cpu, (u8)(reg - m));
+}
 
-    cpu_instruction_t inst;
+// Take a decimal mode outcome, see `cpu_decimal_tables_t`
+static CPU_FORCE_INLINE void cpu_apply_decimal(cpu_t* cpu, cpu_variant variant, b8 accurate, u16 outcome) {
+    u8 flags = (u8)(outcome >> 8);
 
-    // Get the info from the global table. The opcode is the info's index
-    inst.info = g_cpu_instruction_info_table[(word >> 24)];
-    
-    // Extract the operand maintaining endian-ness, based on instruction size
-    switch (inst.info.size) {
-    case 2: // 8-bit operand
-        inst.operand = (u16)((word & 0x00ff0000) >> 16);
-        break;
-    case 3: // 16-bit operand
-        inst.operand = bswap16((u16)(word >> 8));
-        break;
-    default:
-        inst.operand = 0;
+    // The 65C02 takes an extra cycle to get N and Z right
+    if (variant == CPU_VARIANT_65C02) {
+        cpu->cycles++;
+        cpu_idle(cpu, accurate, 1);
     }
 
-    return inst;
+    cpu->a = (u8)outcome;
+    cpu->n_result = flags;
+    cpu->z_result = !(flags & CPU_STATUS_FLAG_ZERO_BIT);
+    cpu->carry = flags & CPU_STATUS_FLAG_CARRY_BIT;
+    cpu->overflow = flags & CPU_STATUS_FLAG_OVERFLOW_BIT;
+}
+
+// Binary add with carry, SBC adds the operand's complement
+static CPU_FORCE_INLINE void cpu_add_binary(cpu_t* cpu, u8 m) {
+    u32 sum = cpu->a + m + cpu->carry;
+
+    cpu->overflow = (u8)((~(cpu->a ^ m) & (cpu->a ^ sum) & 0x80) >> 1);
+    cpu->carry = (u8)(sum >> 8);
+    cpu->a = (u8)sum;
+    cpu_eval_nz_flags(cpu, cpu->a);
+}
+
+static CPU_FORCE_INLINE const cpu_decimal_tables_t* cpu_decimal_tables(cpu_variant variant) {
+    return variant == CPU_VARIANT_65C02 ? &g_cpu_65c02_decimal_tables : &g_cpu_nmos_decimal_tables;
+}
+
+static CPU_FORCE_INLINE void cpu_add(cpu_t* cpu, cpu_variant variant, b8 accurate, u8 m) {
+    if (CPU_HAS_DECIMAL_MODE(variant) && (cpu->status & CPU_STATUS_FLAG_DECIMAL_BIT))
+        cpu_apply_decimal(cpu, variant, accurate, cpu_decimal_tables(variant)->adc[CPU_DECIMAL_INDEX(cpu->carry, cpu->a, m)]);
+    else
+        cpu_add_binary(cpu, m);
+}
+
+static CPU_FORCE_INLINE void cpu_subtract(cpu_t* cpu, cpu_variant variant, b8 accurate, u8 m) {
+    if (CPU_HAS_DECIMAL_MODE(variant) && (cpu->status & CPU_STATUS_FLAG_DECIMAL_BIT))
+        cpu_apply_decimal(cpu, variant, accurate, cpu_decimal_tables(variant)->sbc[CPU_DECIMAL_INDEX(cpu->carry, cpu->a, m)]);
+    else
+        cpu_add_binary(cpu, m ^ 0xff);
 }
 
-void cpu_exec(cpu_t* cpu, cpu_instruction_t inst) {
-    u32 cycles = cpu_resolve_address(cpu, inst.info.address_mode, &inst.operand);
-    u8 m = 0;
 
-    switch (inst.info.opcode) {
+// Interrupts
+
+// Push the return address and status, and jump through an interrupt vector
+// @param[in] break_flag CPU_STATUS_FLAG_BREAK_BIT for BRK, 0 for hardware interrupts
+static CPU_FORCE_INLINE void cpu_enter_interrupt(cpu_t* cpu, cpu_variant variant, b8 accurate, u16 vector, u8 break_flag) {
+    cpu_stack_push(cpu, accurate, (u8)(cpu->pc >> 8));
+    cpu_stack_push(cpu, accurate, (u8)cpu->pc);
+    cpu_stack_push(cpu, accurate, cpu_get_status(cpu) | break_flag | CPU_STATUS_FLAG_UNUSED_BIT);
+    cpu->status |= CPU_STATUS_FLAG_INTERRUPT_DISABLED_BIT;
+
+    // The 65C02 also leaves decimal mode
+    if (variant == CPU_VARIANT_65C02)
+        cpu->status &= ~CPU_STATUS_FLAG_DECIMAL_BIT;
+
+    cpu->pc = cpu_read16(cpu, accurate, vector);
+}
+
+// @returns True if an interrupt must be taken before the next instruction
+static inline b8 cpu_interrupt_pending(cpu_t* cpu) {
+    return cpu->nmi_pending || (cpu->irq_lines && !(cpu->status & CPU_STATUS_FLAG_INTERRUPT_DISABLED_BIT));
+}
+
+// Get the run loop's attention for a pending interrupt. The loop only ever compares against its stop,
+// so running without interrupts pending costs nothing extra.
+static inline void cpu_check_interrupts(cpu_t* cpu) {
+    if (cpu_interrupt_pending(cpu))
+        cpu->stop = 0;
+}
+
+// Take a pending interrupt, NMI first. Entering it starts with two dummy reads of the program counter.
+// @returns True if an interrupt was taken
+static b8 cpu_take_interrupt(cpu_t* cpu) {
+    b8 accurate = cpu->ops->timing == CPU_TIMING_CYCLE_ACCURATE;
+    cpu->bus_cycle = cpu->cycles + 2;
+
+    if (cpu->nmi_pending) {
+        cpu->nmi_pending = FALSE;
+        cpu_enter_interrupt(cpu, cpu->ops->variant, accurate, CPU_VECTOR_NMI, 0);
+    }
+    else if (cpu_interrupt_pending(cpu)) {
+        cpu_enter_interrupt(cpu, cpu->ops->variant, accurate, CPU_VECTOR_IRQ, 0);
+    }
+    else {
+        return FALSE;
+    }
+
+    cpu->cycles += 7;
+    return TRUE;
+}
+
+// How an instruction accesses the memory its address mode refers to
+typedef enum {
+    CPU_ACCESS_NONE = 0,
+    CPU_ACCESS_READ,
+    CPU_ACCESS_MODIFY,  // Read-modify-write
+    CPU_ACCESS_WRITE
+} cpu_access;
+
+static CPU_FORCE_INLINE cpu_access cpu_opcode_access(cpu_opcode opcode) {
+    switch (opcode) {
     case CPU_OPCODE_ADC:
-        // TODO
-        break;
     case CPU_OPCODE_AND:
-        CPU_ADD_CYCLES(2, 3, 4, 0, 4, 4, 4, 6, 5);
-        m = inst.operand;
+    case CPU_OPCODE_BIT:
+    case CPU_OPCODE_CMP:
+    case CPU_OPCODE_CPX:
+    case CPU_OPCODE_CPY:
+    case CPU_OPCODE_EOR:
+    case CPU_OPCODE_LDA:
+    case CPU_OPCODE_LDX:
+    case CPU_OPCODE_LDY:
+    case CPU_OPCODE_ORA:
+    case CPU_OPCODE_SBC:
+        return CPU_ACCESS_READ;
+    case CPU_OPCODE_ASL:
+    case CPU_OPCODE_DEC:
+    case CPU_OPCODE_INC:
+    case CPU_OPCODE_LSR:
+    case CPU_OPCODE_ROL:
+    case CPU_OPCODE_ROR:
+    case CPU_OPCODE_TRB:
+    case CPU_OPCODE_TSB:
+        return CPU_ACCESS_MODIFY;
+    case CPU_OPCODE_STA:
+    case CPU_OPCODE_STX:
+    case CPU_OPCODE_STY:
+    case CPU_OPCODE_STZ:
+        return CPU_ACCESS_WRITE;
+    default:
+        return CPU_ACCESS_NONE;
+    }
+}
 
-        if (inst.info.address_mode != CPU_ADDRESS_MODE_IMMEDIATE)
-            bus_load(cpu->bus, inst.operand, &m);
+// Executes a single instruction. The program counter must already point past the instruction, 
+// and the base cycle cost must already be charged. With cycle-accurate timing, `cpu->bus_cycle`
+// must be at the instruction's first cycle after fetching (see `CPU_FETCH_CYCLES`).
+// When inlined with constant arguments, the opcode and address mode switches, and every check
+// of the variant and timing, fold away entirely.
+static CPU_FORCE_INLINE void cpu_execute(cpu_t* cpu, cpu_variant variant, cpu_timing timing, cpu_opcode opcode, cpu_address_mode addr_mode, u16 operand) {
+    b8 accurate = timing == CPU_TIMING_CYCLE_ACCURATE;
+    cpu_access access = cpu_opcode_access(opcode);
+    u16 addr = 0;
+    u8 m = 0;
+    u8 original = 0;
 
-        cpu->a = cpu->a & m;
+    // Memory is accessed in one place for all instructions, rather than by each, which keeps this function
+    // small until it's folded down to an instruction (there are thousands of handlers to compile).
+    // Instructions operate on `m`, and writing instructions leave what to write in it.
+    if (access == CPU_ACCESS_READ) {
+        m = cpu_read_operand(cpu, variant, timing, addr_mode, operand);
+    }
+    else if (access == CPU_ACCESS_MODIFY) {
+        b8 shift = opcode == CPU_OPCODE_ASL || opcode == CPU_OPCODE_LSR || opcode == CPU_OPCODE_ROL || opcode == CPU_OPCODE_ROR;
+        m = original = cpu_read_modify_operand(cpu, variant, timing, addr_mode, operand, shift && CPU_SHIFT_PAGE_PENALTY(variant), &addr);
+    }
+    else if (access == CPU_ACCESS_WRITE) {
+        addr = cpu_resolve_address(cpu, variant, timing, addr_mode, operand, FALSE);
+    }
 
-        cpu_eval_zero_flag(cpu, cpu->a);
-        cpu_eval_negative_flag(cpu, cpu->a);
+    switch (opcode) {
+    case CPU_OPCODE_ADC:
+        cpu_add(cpu, variant, accurate, m);
+        break;
+    case CPU_OPCODE_AND:
+        cpu->a &= m;
+
+        cpu_eval_nz_flags(cpu, cpu->a);
         break;
     case CPU_OPCODE_ASL:
-        CPU_ADD_CYCLES(2, 5, 6, 0, 6, 7, 0, 0, 0);
-        if (inst.info.address_mode == CPU_ADDRESS_MODE_ACCUMULATOR) {
-            cpu_eval_carry_flag(cpu, cpu->a);
-            cpu->a << 1;
-        }
-        else {
-            u8 val = 0;
-            bus_load(cpu->bus, inst.operand, &val);
-            cpu_eval_carry_flag(cpu, val);
-            val << 1;
-            bus_store(cpu->bus, inst.operand, val);
-        }
+        cpu_eval_carry_flag(cpu, m & 0x80);
+        m <<= 1;
 
+        cpu_eval_nz_flags(cpu, m);
         break;
     case CPU_OPCODE_BCC:
-        cycles += 2;
-        if (!cpu->status & CPU_STATUS_FLAG_CARRY_BIT) {
-            cpu->pc += (i16)inst.operand;
-            cycles++;
-        }
-
+        cpu_branch(cpu, accurate, !cpu->carry, operand);
         break;
     case CPU_OPCODE_BCS:
-        cycles += 2;
-        if (cpu->status & CPU_STATUS_FLAG_CARRY_BIT) {
-            cpu->pc += (i16)inst.operand;
-            cycles++;
-        }
-
+        cpu_branch(cpu, accurate, cpu->carry, operand);
         break;
     case CPU_OPCODE_BEQ:
-        cycles += 2;
-        if (cpu->status & CPU_STATUS_FLAG_ZERO_BIT) {
-            cpu->pc += (i16)inst.operand;
-            cycles++;
-        }
-        
+        cpu_branch(cpu, accurate, cpu->z_result == 0, operand);
         break;
     case CPU_OPCODE_BIT:
-        CPU_ADD_CYCLES(0, 2, 0, 0, 4, 0, 0, 0, 0);
-        u8 val;
-        bus_load(cpu->bus, inst.operand, &val);
-        cpu->status |= val & BIT(6);
-        cpu->status |= val & BIT(7);
+        // Immediate BIT (65C02) only sets Z
+        if (addr_mode == CPU_ADDRESS_MODE_IMMEDIATE) {
+            cpu->z_result = cpu->a & m;
+            break;
+        }
 
-        cpu_eval_zero_flag(cpu, cpu->a & val);
+        cpu->overflow = m & CPU_STATUS_FLAG_OVERFLOW_BIT;
+        cpu->n_result = m;
+        cpu->z_result = cpu->a & m;
         break;
     case CPU_OPCODE_BMI:
-        cycles += 2;
-        if (cpu->status & CPU_STATUS_FLAG_NEGATIVE_BIT) {
-            cpu->pc += (i16)inst.operand;
-            cycles++;
-        }
-
+        cpu_branch(cpu, accurate, cpu->n_result & CPU_STATUS_FLAG_NEGATIVE_BIT, operand);
         break;
     case CPU_OPCODE_BNE:
-        cycles += 2;
-        if (!(cpu->status & CPU_STATUS_FLAG_ZERO_BIT)) {
-            cpu->pc += (i16)inst.operand;
-            cycles++;
-        }
-
+        cpu_branch(cpu, accurate, cpu->z_result != 0, operand);
         break;
     case CPU_OPCODE_BPL:
-        cycles += 2;
-        if (!(cpu->status & CPU_STATUS_FLAG_NEGATIVE_BIT)) {
-            cpu->pc += (i16)inst.operand;
-            cycles++;
-        }
-
+        cpu_branch(cpu, accurate, !(cpu->n_result & CPU_STATUS_FLAG_NEGATIVE_BIT), operand);
         break;
     case CPU_OPCODE_BRK:
-        cycles = 7;
-        cpu_push(cpu, cpu->pc);
-        cpu_push(cpu, cpu->status);
-
-        u8 ptr_lo = 0,
-           ptr_hi = 0;
-        bus_load(cpu->bus, 0xfffe, &ptr_lo);
-        bus_load(cpu->bus, 0xffff, &ptr_hi);
-
-        cpu->pc = (ptr_hi << 8) + ptr_lo;
-
+        // BRK is followed by a padding byte, which the return address skips
+        cpu->pc++;
+        cpu_enter_interrupt(cpu, variant, accurate, CPU_VECTOR_IRQ, CPU_STATUS_FLAG_BREAK_BIT);
+        break;
+    case CPU_OPCODE_BRA:
+        cpu_branch(cpu, accurate, TRUE, operand);
         break;
     case CPU_OPCODE_BVC:
-        cycles += 2;
-        if (!cpu->status & CPU_STATUS_FLAG_OVERFLOW_BIT) {
-            cpu->pc += (i16)inst.operand;
-            cycles++;
-        }
-
+        cpu_branch(cpu, accurate, !cpu->overflow, operand);
         break;
     case CPU_OPCODE_BVS:
-        cycles += 2;
-        if (cpu->status & CPU_STATUS_FLAG_OVERFLOW_BIT) {
-            cpu->pc += (i16)inst.operand;
-            cycles++;
-        }
-        
+        cpu_branch(cpu, accurate, cpu->overflow, operand);
         break;
     case CPU_OPCODE_CLC:
-        cycles += 2;
-        cpu->status &= ~CPU_STATUS_FLAG_CARRY_BIT;
-
+        cpu->carry = 0;
         break;
     case CPU_OPCODE_CLD:
-        cycles += 2;
         cpu->status &= ~CPU_STATUS_FLAG_DECIMAL_BIT;
-
         break;
     case CPU_OPCODE_CLI:
-        cycles += 2;
         cpu->status &= ~CPU_STATUS_FLAG_INTERRUPT_DISABLED_BIT;
-
+        cpu_check_interrupts(cpu);
         break;
     case CPU_OPCODE_CLV:
-        cycles += 2;
-        cpu->status &= ~CPU_STATUS_FLAG_OVERFLOW_BIT;
-
+        cpu->overflow = 0;
         break;
     case CPU_OPCODE_CMP:
-        CPU_ADD_CYCLES(2, 3, 4, 0, 4, 4, 4, 6, 5);
-
-        m = inst.operand;
-        if (inst.info.address_mode != CPU_ADDRESS_MODE_IMMEDIATE)
-            bus_load(cpu->bus, inst.operand, &m);
-
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_CARRY_BIT, cpu->a >= m);
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_ZERO_BIT, cpu->a == m);
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_NEGATIVE_BIT, (i8)(cpu->a - m) < 0);
+        cpu_compare(cpu, cpu->a, m);
         break;
     case CPU_OPCODE_CPX:
-        CPU_ADD_CYCLES(2, 3, 0, 0, 4, 0, 0, 0, 0);
+        cpu_compare(cpu, cpu->x, m);
+        break;
+    case CPU_OPCODE_CPY:
+        cpu_compare(cpu, cpu->y, m);
+        break;
+    case CPU_OPCODE_DEC:
+        m--;
 
-        m = inst.operand;
-        if (inst.info.address_mode != CPU_ADDRESS_MODE_IMMEDIATE)
-            bus_load(cpu->bus, inst.operand, &m);
+        cpu_eval_nz_flags(cpu, m);
+        break;
+    case CPU_OPCODE_DEX:
+        cpu->x--;
 
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_CARRY_BIT, cpu->x >= m);
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_ZERO_BIT, cpu->x == m);
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_NEGATIVE_BIT, (i8)(cpu->x - m) < 0);
+        cpu_eval_nz_flags(cpu, cpu->x);
         break;
-    case CPU_OPCODE_CPY:
-        CPU_ADD_CYCLES(2, 3, 0, 0, 4, 0, 0, 0, 0);
+    case CPU_OPCODE_DEY:
+        cpu->y--;
 
-        m = inst.operand;
-        if (inst.info.address_mode != CPU_ADDRESS_MODE_IMMEDIATE)
-            bus_load(cpu->bus, inst.operand, &m);
+        cpu_eval_nz_flags(cpu, cpu->y);
+        break;
+    case CPU_OPCODE_EOR:
+        cpu->a ^= m;
 
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_CARRY_BIT, cpu->y >= m);
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_ZERO_BIT, cpu->y == m);
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_NEGATIVE_BIT, (i8)(cpu->y - m) < 0);
+        cpu_eval_nz_flags(cpu, cpu->a);
         break;
-    case CPU_OPCODE_DEC:
-        CPU_ADD_CYCLES(0, 5, 6, 0, 6, 7, 0, 0, 0);
+    case CPU_OPCODE_INC:
+        m++;
 
-        m = 0;
-        bus_load(cpu->bus, inst.operand, &m);
-        m -= 1;
-        bus_store(cpu->bus, inst.operand, m);
+        cpu_eval_nz_flags(cpu, m);
+        break;
+    case CPU_OPCODE_INX:
+        cpu->x++;
 
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_ZERO_BIT, m == 0);
-        cpu_eval_status(cpu, CPU_STATUS_FLAG_NEGATIVE_BIT, (i8)m < 0);
+        cpu_eval_nz_flags(cpu, cpu->x);
         break;
-    case CPU_OPCODE_LDA:
-        CPU_ADD_CYCLES(2, 3, 4, 0, 4, 3, 3, 2, 2);
+    case CPU_OPCODE_INY:
+        cpu->y++;
 
-        if (inst.info.address_mode == CPU_ADDRESS_MODE_IMMEDIATE)
-            cpu->a = (u8)inst.operand;
-        else
-            bus_load(cpu->bus, inst.operand, &cpu->a);
+        cpu_eval_nz_flags(cpu, cpu->y);
+        break;
+    case CPU_OPCODE_JMP:
+        cpu->pc = cpu_resolve_address(cpu, variant, timing, addr_mode, operand, FALSE);
+        break;
+    case CPU_OPCODE_JSR:
+        // The pushed return address points at the last byte of the JSR instruction, which is only fetched
+        // after pushing it. Before that, the stack is read (and ignored).
+        cpu_idle(cpu, accurate, -1);
+        cpu_dummy_read(cpu, accurate, CPU_STACK_BASE | cpu->sp);
+        cpu_stack_push(cpu, accurate, (u8)((cpu->pc - 1) >> 8));
+        cpu_stack_push(cpu, accurate, (u8)(cpu->pc - 1));
+        cpu_idle(cpu, accurate, 1);
+        cpu->pc = operand;
+        break;
+    case CPU_OPCODE_LDA:
+        cpu->a = m;
 
-        cpu_eval_zero_flag(cpu, cpu->a);
-        cpu_eval_negative_flag(cpu, cpu->a);
+        cpu_eval_nz_flags(cpu, cpu->a);
         break;
     case CPU_OPCODE_LDX:
-        CPU_ADD_CYCLES(2, 3, 0, 4, 4, 0, 4, 0, 0);
-        
-        if (inst.info.address_mode == CPU_ADDRESS_MODE_IMMEDIATE)
-            cpu->x = (u8)inst.operand;
-        else
-            bus_load(cpu->bus, inst.operand, &cpu->a);
+        cpu->x = m;
 
-        cpu_eval_zero_flag(cpu, cpu->x);
-        cpu_eval_negative_flag(cpu, cpu->x);
+        cpu_eval_nz_flags(cpu, cpu->x);
         break;
     case CPU_OPCODE_LDY:
-        CPU_ADD_CYCLES(2, 3, 4, 0, 4, 4, 0, 0, 0);
-        
-        if (inst.info.address_mode == CPU_ADDRESS_MODE_IMMEDIATE)
-            cpu->y = (u8)inst.operand;
-        else
-            bus_load(cpu->bus, inst.operand, &cpu->a);
+        cpu->y = m;
 
-        cpu_eval_zero_flag(cpu, cpu->y);
-        cpu_eval_negative_flag(cpu, cpu->y);
+        cpu_eval_nz_flags(cpu, cpu->y);
         break;
-    case CPU_OPCODE_STA:
-        CPU_ADD_CYCLES(0, 3, 4, 0, 4, 5, 5, 6, 6);
-        
-        bus_store(cpu->bus, inst.operand, cpu->a);
+    case CPU_OPCODE_LSR:
+        cpu_eval_carry_flag(cpu, m & 0x01);
+        m >>= 1;
 
+        cpu_eval_nz_flags(cpu, m);
         break;
-    case CPU_OPCODE_STX:
-        CPU_ADD_CYCLES(0, 3, 0, 4, 4, 0, 0, 0, 0);
-        
-        bus_store(cpu->bus, inst.operand, cpu->x);
+    case CPU_OPCODE_NOP:
+        // The 65C02's NOPs addressing memory read it, and ignore the value
+        if (addr_mode != CPU_ADDRESS_MODE_IMPLIED && addr_mode != CPU_ADDRESS_MODE_IMMEDIATE)
+            cpu_dummy_read(cpu, accurate, cpu_resolve_address(cpu, variant, timing, addr_mode, operand, FALSE));
+        break;
+    case CPU_OPCODE_ORA:
+        cpu->a |= m;
 
+        cpu_eval_nz_flags(cpu, cpu->a);
         break;
-    case CPU_OPCODE_STY:
-        CPU_ADD_CYCLES(0, 3, 4, 0, 4, 0, 0, 0, 0);
-        
-        bus_store(cpu->bus, inst.operand, cpu->y);
+    case CPU_OPCODE_PHA:
+        cpu_stack_push(cpu, accurate, cpu->a);
+        break;
+    case CPU_OPCODE_PHP:
+        cpu_stack_push(cpu, accurate, cpu_get_status(cpu) | CPU_STATUS_FLAG_BREAK_BIT | CPU_STATUS_FLAG_UNUSED_BIT);
+        break;
+    case CPU_OPCODE_PHX:
+        cpu_stack_push(cpu, accurate, cpu->x);
+        break;
+    case CPU_OPCODE_PHY:
+        cpu_stack_push(cpu, accurate, cpu->y);
+        break;
+    case CPU_OPCODE_PLA:
+        cpu_dummy_read(cpu, accurate, CPU_STACK_BASE | cpu->sp);
+        cpu->a = cpu_stack_pull(cpu, accurate);
 
+        cpu_eval_nz_flags(cpu, cpu->a);
         break;
-    case CPU_OPCODE_TAX:
-        cycles = 2;
+    case CPU_OPCODE_PLX:
+        cpu_dummy_read(cpu, accurate, CPU_STACK_BASE | cpu->sp);
+        cpu->x = cpu_stack_pull(cpu, accurate);
+
+        cpu_eval_nz_flags(cpu, cpu->x);
+        break;
+    case CPU_OPCODE_PLY:
+        cpu_dummy_read(cpu, accurate, CPU_STACK_BASE | cpu->sp);
+        cpu->y = cpu_stack_pull(cpu, accurate);
+
+        cpu_eval_nz_flags(cpu, cpu->y);
+        break;
+    case CPU_OPCODE_PLP:
+        cpu_dummy_read(cpu, accurate, CPU_STACK_BASE | cpu->sp);
+        cpu_set_status(cpu, (cpu_stack_pull(cpu, accurate) & ~CPU_STATUS_FLAG_BREAK_BIT) | CPU_STATUS_FLAG_UNUSED_BIT);
+        cpu_check_interrupts(cpu);
+        break;
+    case CPU_OPCODE_ROL: {
+        u8 carry_in = cpu->carry;
+        cpu_eval_carry_flag(cpu, m & 0x80);
+        m = (u8)((m << 1) | carry_in);
 
+        cpu_eval_nz_flags(cpu, m);
+        break;
+    }
+    case CPU_OPCODE_ROR: {
+        u8 carry_in = cpu->carry;
+        cpu_eval_carry_flag(cpu, m & 0x01);
+        m = (u8)((m >> 1) | (carry_in << 7));
+
+        cpu_eval_nz_flags(cpu, m);
+        break;
+    }
+    case CPU_OPCODE_RTI:
+        cpu_dummy_read(cpu, accurate, CPU_STACK_BASE | cpu->sp);
+        cpu_set_status(cpu, (cpu_stack_pull(cpu, accurate) & ~CPU_STATUS_FLAG_BREAK_BIT) | CPU_STATUS_FLAG_UNUSED_BIT);
+        cpu->pc = cpu_stack_pull(cpu, accurate);
+        cpu->pc |= cpu_stack_pull(cpu, accurate) << 8;
+        cpu_check_interrupts(cpu);
+        break;
+    case CPU_OPCODE_RTS:
+        // Incrementing the pulled address takes a cycle
+        cpu_dummy_read(cpu, accurate, CPU_STACK_BASE | cpu->sp);
+        cpu->pc = cpu_stack_pull(cpu, accurate);
+        cpu->pc |= cpu_stack_pull(cpu, accurate) << 8;
+        cpu_idle(cpu, accurate, 1);
+        cpu->pc++;
+        break;
+    case CPU_OPCODE_SBC:
+        cpu_subtract(cpu, variant, accurate, m);
+        break;
+    case CPU_OPCODE_SEC:
+        cpu->carry = CPU_STATUS_FLAG_CARRY_BIT;
+        break;
+    case CPU_OPCODE_SED:
+        cpu->status |= CPU_STATUS_FLAG_DECIMAL_BIT;
+        break;
+    case CPU_OPCODE_SEI:
+        cpu->status |= CPU_STATUS_FLAG_INTERRUPT_DISABLED_BIT;
+        break;
+    case CPU_OPCODE_STA:
+        m = cpu->a;
+        break;
+    case CPU_OPCODE_STX:
+        m = cpu->x;
+        break;
+    case CPU_OPCODE_STY:
+        m = cpu->y;
+        break;
+    case CPU_OPCODE_STZ:
+        m = 0;
+        break;
+    case CPU_OPCODE_TAX:
         cpu->x = cpu->a;
 
-        cpu_eval_zero_flag(cpu, cpu->x);
-        cpu_eval_negative_flag(cpu, cpu->x);
+        cpu_eval_nz_flags(cpu, cpu->x);
         break;
     case CPU_OPCODE_TAY:
-        cycles = 2;
-
         cpu->y = cpu->a;
 
-        cpu_eval_zero_flag(cpu, cpu->y);
-        cpu_eval_negative_flag(cpu, cpu->y);
+        cpu_eval_nz_flags(cpu, cpu->y);
+        break;
+    case CPU_OPCODE_TRB:
+    case CPU_OPCODE_TSB:
+        // Only Z is set, from the bits tested
+        cpu->z_result = cpu->a & m;
+        m = opcode == CPU_OPCODE_TSB ? m | cpu->a : m & ~cpu->a;
         break;
     case CPU_OPCODE_TSX:
-        cycles = 2;
-
         cpu->x = cpu->sp;
 
-        cpu_eval_zero_flag(cpu, cpu->x);
-        cpu_eval_negative_flag(cpu, cpu->x);
+        cpu_eval_nz_flags(cpu, cpu->x);
         break;
     case CPU_OPCODE_TXA:
-        cycles = 2;
-
         cpu->a = cpu->x;
 
-        cpu_eval_zero_flag(cpu, cpu->a);
-        cpu_eval_negative_flag(cpu, cpu->a);
+        cpu_eval_nz_flags(cpu, cpu->a);
         break;
     case CPU_OPCODE_TXS:
-        cycles = 2;
-
         cpu->sp = cpu->x;
-
         break;
     case CPU_OPCODE_TYA:
-        cycles = 2;
-
         cpu->a = cpu->y;
 
-        cpu_eval_zero_flag(cpu, cpu->a);
-        cpu_eval_negative_flag(cpu, cpu->a);
+        cpu_eval_nz_flags(cpu, cpu->a);
+        break;
+    default:
+        // Unknown opcodes execute as a NOP
+        break;
+    }
+
+    if (access == CPU_ACCESS_MODIFY)
+        cpu_write_modify_operand(cpu, variant, timing, addr_mode, addr, original, m);
+    else if (access == CPU_ACCESS_WRITE)
+        cpu_write(cpu, accurate, addr, m);
+}
+
+
+// Predecode cache
+
+static void cpu_on_invalidate(void* user, u32 page) {
+    cpu_t* cpu = (cpu_t*)user;
+    cpu_decoded_page_t* decoded_page = cpu->decoded_pages[page];
+
+    if (decoded_page) {
+        memset(decoded_page, 0, sizeof(cpu_decoded_page_t));
+        cpu->decode_stats.invalidations++;
+    }
+
+    if (cpu->jit)
+        jit_invalidate_page(cpu->jit, page);
+}
+
+// @returns True if there's a breakpoint at an address
+static inline b8 cpu_test_breakpoint(cpu_t* cpu, u16 addr) {
+    return cpu->breakpoint_counts[addr >> BUS_PAGE_BITS] && (cpu->breakpoints[addr >> 3] & BIT((addr & 7)));
+}
+
+// Decode the instruction at the program counter from memory, and cache it if it's 
+// entirely within a page of direct host memory (so any change to it goes through the bus).
+// Breakpoints are returned invalid (yet decoded), and never cached.
+static cpu_decoded_t cpu_decode_miss(cpu_t* cpu) {
+    u16 pc = cpu->pc;
+    cpu_decoded_t decoded;
+
+    // With cycle-accurate timing, fetches which reach the bus (from devices, or across a page) each take a cycle
+    // from the instruction's first. Instructions then set the cycle of their own accesses.
+    b8 accurate = cpu->ops->timing == CPU_TIMING_CYCLE_ACCURATE;
+    if (accurate)
+        cpu->bus_cycle = cpu->cycles;
+
+    cpu->fetching = TRUE;
+    decoded.opcode = cpu_load(cpu, pc);
+    decoded.valid = TRUE;
+
+    u8 size = cpu->ops->info[decoded.opcode].size;
+    decoded.operand = 0;
+
+    for (u8 i = 1; i < size; i++) {
+        cpu->bus_cycle += accurate;
+        decoded.operand |= (u16)(cpu_load(cpu, (u16)(pc + i)) << ((i - 1) * 8));
+    }
+
+    cpu->fetching = FALSE;
+    cpu->decode_stats.misses++;
+
+    u32 page = pc >> BUS_PAGE_BITS;
+
+    if (cpu_test_breakpoint(cpu, pc)) {
+        if (pc == cpu->resume_pc)
+            cpu->resume_pc = -1;
+        else
+            decoded.valid = FALSE;
+
+        return decoded;
+    }
+    b8 cacheable = cpu->load_pages[page] != NULL
+        && (pc & BUS_PAGE_MASK) + CPU_INSTRUCTION_LENGTH(size) <= BUS_PAGE_SIZE;
+
+    if (cacheable) {
+        cpu_decoded_page_t* decoded_page = cpu->decoded_pages[page];
+        if (decoded_page == NULL) {
+            decoded_page = (cpu_decoded_page_t*)calloc(1, sizeof(cpu_decoded_page_t));
+            cpu->decoded_pages[page] = decoded_page;
+        }
+
+        if (!decoded_page->marked) {
+            bus_mark_code_page(cpu->bus, page);
+            decoded_page->marked = TRUE;
+        }
+
+        decoded_page->insts[pc & BUS_PAGE_MASK] = decoded;
+    }
+
+    return decoded;
+}
+
+// Get the decoded instruction at the program counter
+static CPU_FORCE_INLINE cpu_decoded_t cpu_decode_pc(cpu_t* cpu) {
+    cpu_decoded_page_t* decoded_page = cpu->decoded_pages[cpu->pc >> BUS_PAGE_BITS];
+
+    if (decoded_page) {
+        cpu_decoded_t decoded = decoded_page->insts[cpu->pc & BUS_PAGE_MASK];
+        if (decoded.valid) {
+            cpu->decode_stats.hits++;
+            return decoded;
+        }
+    }
+
+    return cpu_decode_miss(cpu);
+}
+
+
+// Debugging
+
+// Stop the run at a breakpoint, before executing its instruction
+static void cpu_break(cpu_t* cpu) {
+    cpu->stopped.reason = CPU_STOP_BREAKPOINT;
+    cpu->stopped.addr = cpu->pc;
+    cpu->stop = 0;
+}
+
+// Stop the run once the instruction accessing a watched address completes
+static void cpu_on_watch(void* user, u16 addr, u8 value, u32 access) {
+    cpu_t* cpu = (cpu_t*)user;
+
+    if (cpu->fetching)
+        return;
+
+    // With cycle-accurate timing, a read-modify-write writes the unmodified value back first: report what it leaves
+    if (cpu->ops->timing == CPU_TIMING_CYCLE_ACCURATE && cpu->stopped.reason == CPU_STOP_WATCHPOINT
+        && cpu->stopped.addr == addr && cpu->stopped.access == BUS_WATCH_STORE && access == BUS_WATCH_STORE) {
+        cpu->stopped.value = value;
+        return;
+    }
+
+    if (cpu->stopped.reason != CPU_STOP_NONE)
+        return;
+
+    cpu->stopped.reason = CPU_STOP_WATCHPOINT;
+    cpu->stopped.addr = addr;
+    cpu->stopped.value = value;
+    cpu->stopped.access = access;
+    cpu->stop = 0;
+}
+
+
+// Tracing
+
+// Record the instruction at the program counter, with the state before it executes
+static void cpu_trace_instruction(cpu_t* cpu, cpu_decoded_t decoded) {
+    u8 size = cpu->ops->info[decoded.opcode].size;
+    trace_record_t record;
+
+    record.cycles = cpu->cycles;
+    record.pc = cpu->pc;
+    record.opcode = decoded.opcode;
+    record.operand_size = size ? size - 1 : 0;
+    record.operand = decoded.operand;
+    record.a = cpu->a;
+    record.x = cpu->x;
+    record.y = cpu->y;
+    record.sp = cpu->sp;
+    record.status = cpu_get_status(cpu);
+
+    trace_record(cpu->trace, &record);
+}
+
+
+// Variants, each specialized from its instruction table, once per timing
+
+#define CPU_VARIANT CPU_VARIANT_NMOS
+#define CPU_VARIANT_TABLE CPU_OPCODE_TABLE_NMOS
+#define CPU_VARIANT_TIMING CPU_TIMING_FAST
+#define CPU_VARIANT_SYMBOL(name) cpu_nmos_##name
+#include "cpu_variant.h"
+
+#define CPU_VARIANT CPU_VARIANT_65C02
+#define CPU_VARIANT_TABLE CPU_OPCODE_TABLE_65C02
+#define CPU_VARIANT_TIMING CPU_TIMING_FAST
+#define CPU_VARIANT_SYMBOL(name) cpu_65c02_##name
+#include "cpu_variant.h"
+
+#define CPU_VARIANT CPU_VARIANT_2A03
+#define CPU_VARIANT_TABLE CPU_OPCODE_TABLE_NMOS
+#define CPU_VARIANT_TIMING CPU_TIMING_FAST
+#define CPU_VARIANT_SYMBOL(name) cpu_2a03_##name
+#include "cpu_variant.h"
+
+#define CPU_VARIANT CPU_VARIANT_NMOS
+#define CPU_VARIANT_TABLE CPU_OPCODE_TABLE_NMOS
+#define CPU_VARIANT_TIMING CPU_TIMING_CYCLE_ACCURATE
+#define CPU_VARIANT_SYMBOL(name) cpu_accurate_nmos_##name
+#include "cpu_variant.h"
+
+#define CPU_VARIANT CPU_VARIANT_65C02
+#define CPU_VARIANT_TABLE CPU_OPCODE_TABLE_65C02
+#define CPU_VARIANT_TIMING CPU_TIMING_CYCLE_ACCURATE
+#define CPU_VARIANT_SYMBOL(name) cpu_accurate_65c02_##name
+#include "cpu_variant.h"
+
+#define CPU_VARIANT CPU_VARIANT_2A03
+#define CPU_VARIANT_TABLE CPU_OPCODE_TABLE_NMOS
+#define CPU_VARIANT_TIMING CPU_TIMING_CYCLE_ACCURATE
+#define CPU_VARIANT_SYMBOL(name) cpu_accurate_2a03_##name
+#include "cpu_variant.h"
+
+#define CPU_VARIANT_OPS(variant, timing, name) \
+    { variant, timing, cpu_##name##_info_table, cpu_##name##_mnemonic_table, cpu_##name##_handler_table, \
+      cpu_##name##_execute, cpu_##name##_run_interpreter }
+
+const cpu_variant_ops_t g_cpu_variant_ops[CPU_TIMING_COUNT][CPU_VARIANT_COUNT] = {
+    [CPU_TIMING_FAST] = {
+        [CPU_VARIANT_NMOS] = CPU_VARIANT_OPS(CPU_VARIANT_NMOS, CPU_TIMING_FAST, nmos),
+        [CPU_VARIANT_65C02] = CPU_VARIANT_OPS(CPU_VARIANT_65C02, CPU_TIMING_FAST, 65c02),
+        [CPU_VARIANT_2A03] = CPU_VARIANT_OPS(CPU_VARIANT_2A03, CPU_TIMING_FAST, 2a03)
+    },
+    [CPU_TIMING_CYCLE_ACCURATE] = {
+        [CPU_VARIANT_NMOS] = CPU_VARIANT_OPS(CPU_VARIANT_NMOS, CPU_TIMING_CYCLE_ACCURATE, accurate_nmos),
+        [CPU_VARIANT_65C02] = CPU_VARIANT_OPS(CPU_VARIANT_65C02, CPU_TIMING_CYCLE_ACCURATE, accurate_65c02),
+        [CPU_VARIANT_2A03] = CPU_VARIANT_OPS(CPU_VARIANT_2A03, CPU_TIMING_CYCLE_ACCURATE, accurate_2a03)
+    }
+};
+
+#undef CPU_VARIANT_OPS
+
+
+cpu_t* cpu_create(bus_t* bus) {
+    return cpu_create_ex(bus, NULL);
+}
+
+cpu_t* cpu_create_ex(bus_t* bus, const cpu_config_t* config) {
+    assert(bus != NULL);
+    assert(config == NULL || config->variant < CPU_VARIANT_COUNT);
+    assert(config == NULL || config->timing < CPU_TIMING_COUNT);
+
+    cpu_t* cpu = (cpu_t*)calloc(1, sizeof(cpu_t));
+    cpu->bus = bus;
+    cpu->ops = config ? &g_cpu_variant_ops[config->timing][config->variant] : &g_cpu_variant_ops[CPU_TIMING_FAST][CPU_VARIANT_NMOS];
+    cpu->load_pages = bus_get_load_pages(bus);
+    cpu->store_pages = bus_get_store_pages(bus);
+    cpu->next_deadline = bus_get_next_deadline(bus);
+    cpu_set_status(cpu, CPU_STATUS_FLAG_UNUSED_BIT);
+    cpu->backend = CPU_BACKEND_INTERPRETER;
+    cpu->resume_pc = -1;
+
+    // Translated code only has fast timing
+    if (config && config->backend == CPU_BACKEND_JIT && config->timing == CPU_TIMING_FAST) {
+        cpu->jit = jit_create(cpu);
+        if (cpu->jit)
+            cpu->backend = CPU_BACKEND_JIT;
+    }
+
+    bus_set_invalidate_callback(bus, cpu_on_invalidate, cpu);
+    bus_set_watch_callback(bus, cpu_on_watch, cpu);
+    bus_set_cycle_counter(bus, cpu->ops->timing == CPU_TIMING_CYCLE_ACCURATE ? &cpu->bus_cycle : &cpu->cycles);
+
+    return cpu;
+}
+
+cpu_backend cpu_get_backend(cpu_t* cpu) {
+    return cpu->backend;
+}
+
+cpu_variant cpu_get_variant(cpu_t* cpu) {
+    return cpu->ops->variant;
+}
+
+cpu_timing cpu_get_timing(cpu_t* cpu) {
+    return cpu->ops->timing;
+}
+
+void cpu_free(cpu_t* cpu) {
+    bus_set_invalidate_callback(cpu->bus, NULL, NULL);
+    bus_set_watch_callback(cpu->bus, NULL, NULL);
+    bus_set_cycle_counter(cpu->bus, NULL);
+
+    if (cpu->jit)
+        jit_free(cpu->jit);
+
+    for (u32 i = 0; i < BUS_PAGE_COUNT; i++)
+        free(cpu->decoded_pages[i]);
+
+    free(cpu->breakpoints);
+    free(cpu);
+}
+
+void cpu_reset(cpu_t* cpu) {
+    // The reset sequence reads the vector in its last two cycles
+    cpu->bus_cycle = cpu->cycles + 5;
+    cpu->pc = cpu_read16(cpu, cpu->ops->timing == CPU_TIMING_CYCLE_ACCURATE, CPU_VECTOR_RESET);
+    cpu->sp = 0xfd;
+    cpu->status |= CPU_STATUS_FLAG_INTERRUPT_DISABLED_BIT | CPU_STATUS_FLAG_UNUSED_BIT;
+    cpu->nmi_pending = FALSE;
+    cpu->cycles += 7;
+}
+
+u32 cpu_step(cpu_t* cpu) {
+    u64 start = cpu->cycles;
+    memset(&cpu->stopped, 0, sizeof(cpu_stop_t));
+
+    if (!cpu_take_interrupt(cpu)) {
+        cpu_decoded_t decoded = cpu_decode_pc(cpu);
+        if (CPU_TRACE && cpu->trace)
+            cpu_trace_instruction(cpu, decoded);
+
+        cpu->ops->handlers[decoded.opcode](cpu, decoded.operand);
+    }
+
+    if (cpu->cycles >= *cpu->next_deadline)
+        bus_dispatch_events(cpu->bus, cpu->cycles);
+
+    return (u32)(cpu->cycles - start);
+}
+
+// Runs translated blocks where available, interpreting single instructions in between, until `cpu->stop`.
+// A block only runs if it's guaranteed to finish by then, so overshoot stays as with the interpreter.
+static void cpu_run_jit(cpu_t* cpu) {
+    while (cpu->cycles < cpu->stop) {
+        jit_block_t* block = jit_lookup(cpu->jit, cpu->pc);
+
+        if (block && cpu->cycles + block->max_cycles <= cpu->stop) {
+            // Translated code keeps the whole status register in a host register
+            cpu->status = cpu_get_status(cpu);
+            block->code(cpu);
+            cpu_set_status(cpu, cpu->status);
+        }
+        else {
+            cpu_decoded_t decoded = cpu_decode_pc(cpu);
+            if (!decoded.valid) {
+                cpu_break(cpu);
+                return;
+            }
+
+            cpu->ops->handlers[decoded.opcode](cpu, decoded.operand);
+        }
+    }
+}
+
+// Interprets instructions until `cpu->stop`, recording each into the trace
+static void cpu_run_traced(cpu_t* cpu) {
+    while (cpu->cycles < cpu->stop) {
+        cpu_decoded_t decoded = cpu_decode_pc(cpu);
+        if (!decoded.valid) {
+            cpu_break(cpu);
+            return;
+        }
+
+        cpu_trace_instruction(cpu, decoded);
+        cpu->ops->handlers[decoded.opcode](cpu, decoded.operand);
+    }
+}
+
+u64 cpu_run(cpu_t* cpu, u64 cycles) {
+    u64 target = cpu->cycles + cycles;
+
+    // Resuming at the breakpoint the last run stopped at executes its instruction
+    cpu->resume_pc = (cpu->stopped.reason == CPU_STOP_BREAKPOINT && cpu->stopped.addr == cpu->pc) ? cpu->pc : -1;
+    memset(&cpu->stopped, 0, sizeof(cpu_stop_t));
+
+    // The inner loops only break out for the next event deadline, and get cut short
+    // by devices scheduling an earlier one or raising an interrupt while they run
+    for (;;) {
+        cpu_take_interrupt(cpu);
+        cpu->stop = target < *cpu->next_deadline ? target : *cpu->next_deadline;
+
+        if (CPU_TRACE && cpu->trace)
+            cpu_run_traced(cpu);
+        else if (cpu->jit)
+            cpu_run_jit(cpu);
+        else
+            cpu->ops->run_interpreter(cpu);
+
+        if (cpu->cycles >= *cpu->next_deadline)
+            bus_dispatch_events(cpu->bus, cpu->cycles);
+
+        if (cpu->cycles >= target || cpu->stopped.reason != CPU_STOP_NONE)
+            break;
+    }
+
+    return cpu->cycles > target ? cpu->cycles - target : 0;
+}
+
+void cpu_set_irq(cpu_t* cpu, u32 lines, b8 asserted) {
+    if (asserted)
+        cpu->irq_lines |= lines;
+    else
+        cpu->irq_lines &= ~lines;
+
+    cpu_check_interrupts(cpu);
+}
+
+void cpu_trigger_nmi(cpu_t* cpu) {
+    cpu->nmi_pending = TRUE;
+    cpu_check_interrupts(cpu);
+}
+
+b8 cpu_set_trace(cpu_t* cpu, trace_t* trace) {
+    if (!CPU_TRACE)
+        return FALSE;
+
+    // Have a running loop break out, to switch between the traced and untraced ones
+    cpu->trace = trace;
+    cpu->stop = 0;
+    return TRUE;
+}
+
+b8 cpu_add_breakpoint(cpu_t* cpu, u16 addr) {
+    if (cpu->breakpoints == NULL)
+        cpu->breakpoints = (u8*)calloc((BUS_ADDR_MAX + 1) / 8, 1);
+
+    if (cpu_test_breakpoint(cpu, addr))
+        return FALSE;
+
+    u32 page = addr >> BUS_PAGE_BITS;
+    cpu->breakpoints[addr >> 3] |= BIT((addr & 7));
+    cpu->breakpoint_counts[page]++;
+
+    // Translated blocks may run through the address, predecoded instructions only start there
+    if (cpu->decoded_pages[page])
+        cpu->decoded_pages[page]->insts[addr & BUS_PAGE_MASK].valid = FALSE;
+    if (cpu->jit)
+        jit_invalidate_page(cpu->jit, page);
+
+    return TRUE;
+}
+
+b8 cpu_remove_breakpoint(cpu_t* cpu, u16 addr) {
+    if (cpu->breakpoints == NULL || !cpu_test_breakpoint(cpu, addr))
+        return FALSE;
+
+    cpu->breakpoints[addr >> 3] &= ~BIT((addr & 7));
+    cpu->breakpoint_counts[addr >> BUS_PAGE_BITS]--;
+
+    return TRUE;
+}
+
+void cpu_get_stop(cpu_t* cpu, cpu_stop_t* stop) {
+    *stop = cpu->stopped;
+}
+
+cpu_instruction_t cpu_decode(cpu_t* cpu, u32 word) {
+    // The chunk should look like this:
+    // 0. -- 24b 1. ----------- 16b   2. ------------- 8b 3. --- 0b
+    // [opcode ] [operand (8-bit) ]<=>[operand (16-bit) ] [garbage]
+
+    cpu_instruction_t inst;
+
+    // Get the info from the global table. The opcode is the info's index
+    inst.info = cpu->ops->info[(word >> 24)];
+    
+    // Extract the operand maintaining endian-ness, based on instruction size
+    switch (inst.info.size) {
+    case 2: // 8-bit operand
+        inst.operand = (u16)((word & 0x00ff0000) >> 16);
         break;
+    case 3: // 16-bit operand
+        inst.operand = bswap16((u16)(word >> 8));
+        break;
+    default:
+        inst.operand = 0;
     }
 
-    cpu->cycles += cycles;
+    return inst;
+}
+
+cpu_instruction_info_t cpu_get_instruction_info(u8 byte) {
+    return cpu_get_variant_instruction_info(CPU_VARIANT_NMOS, byte);
+}
+
+cpu_instruction_info_t cpu_get_variant_instruction_info(cpu_variant variant, u8 byte) {
+    return g_cpu_variant_ops[CPU_TIMING_FAST][variant].info[byte];
+}
+
+const char* cpu_get_mnemonic(u8 byte) {
+    return cpu_get_variant_mnemonic(CPU_VARIANT_NMOS, byte);
+}
+
+const char* cpu_get_variant_mnemonic(cpu_variant variant, u8 byte) {
+    const cpu_variant_ops_t* ops = &g_cpu_variant_ops[CPU_TIMING_FAST][variant];
+
+    if (ops->info[byte].opcode == CPU_OPCODE_UNKNOWN)
+        return "???";
+
+    return ops->mnemonics[byte];
+}
+
+void cpu_exec(cpu_t* cpu, cpu_instruction_t inst) {
+    cpu->bus_cycle = cpu->cycles + CPU_FETCH_CYCLES(inst.info.size, inst.info.cycles);
+    cpu->cycles += inst.info.cycles;
+    cpu->ops->execute(cpu, inst.info.opcode, inst.info.address_mode, inst.operand);
 }
 
 void cpu_push(cpu_t* cpu, u8 value) {
-    bus_store(cpu->bus, cpu->sp--, value);
+    cpu_stack_push(cpu, FALSE, value);
 }
 
 u8 cpu_pop(cpu_t* cpu) {
-    u8 value = 0;
-    bus_load(cpu->bus, cpu->sp++, &value);
-    return value;
+    return cpu_stack_pull(cpu, FALSE);
 }
 
 
@@ -453,285 +1218,27 @@ void cpu_get_state(cpu_t* cpu, u8* a, u8* x, u8* y, u8* sp, u8* status, u16* pc,
     if (sp != NULL)
         *sp = cpu->sp;
     if (status != NULL)
-        *status = cpu->status;
+        *status = cpu_get_status(cpu);
     if (pc != NULL)
         *pc = cpu->pc;
     if (cycles != NULL)
         *cycles = cpu->cycles;
 }
 
+void cpu_get_decode_cache_stats(cpu_t* cpu, cpu_decode_cache_stats_t* stats) {
+    *stats = cpu->decode_stats;
+}
+
+void cpu_reset_decode_cache_stats(cpu_t* cpu) {
+    memset(&cpu->decode_stats, 0, sizeof(cpu_decode_cache_stats_t));
+}
 
+void cpu_flush_decode_cache(cpu_t* cpu) {
+    for (u32 i = 0; i < BUS_PAGE_COUNT; i++) {
+        if (cpu->decoded_pages[i])
+            cpu_on_invalidate(cpu, i);
+    }
 
-static const cpu_instruction_info_t g_cpu_instruction_info_table[256] = {
-    { CPU_OPCODE_BRK, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x00
-    { CPU_OPCODE_ORA, CPU_ADDRESS_MODE_INDIRECT_X, 2 },     // 0x01
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x02
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x03
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x04
-    { CPU_OPCODE_ORA, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x05
-    { CPU_OPCODE_ASL, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x06
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x07
-    { CPU_OPCODE_PHP, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x08
-    { CPU_OPCODE_ORA, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0x09
-    { CPU_OPCODE_ASL, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x0A
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x0B
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x0C
-    { CPU_OPCODE_ORA, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x0D
-    { CPU_OPCODE_ASL, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x0E
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x0F
-
-    { CPU_OPCODE_BPL, CPU_ADDRESS_MODE_RELATIVE, 2 },       // 0x10
-    { CPU_OPCODE_ORA, CPU_ADDRESS_MODE_INDIRECT_Y, 2 },     // 0x11
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x12
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x13
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x14
-    { CPU_OPCODE_ORA, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0x15
-    { CPU_OPCODE_ASL, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0x16
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x17
-    { CPU_OPCODE_CLC, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x18
-    { CPU_OPCODE_ORA, CPU_ADDRESS_MODE_ABSOLUTE_Y, 3 },     // 0x19
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x1A
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x1B
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x1C
-    { CPU_OPCODE_ORA, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0x1D
-    { CPU_OPCODE_ASL, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0x1E
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x1F
-
-    { CPU_OPCODE_JSR, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x20
-    { CPU_OPCODE_AND, CPU_ADDRESS_MODE_INDIRECT_X, 2 },     // 0x21
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x22
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x23
-    { CPU_OPCODE_BIT, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x24
-    { CPU_OPCODE_AND, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x25
-    { CPU_OPCODE_ROL, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x26
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x27
-    { CPU_OPCODE_PLP, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x28
-    { CPU_OPCODE_AND, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0x29
-    { CPU_OPCODE_ROL, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x2A
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x2B
-    { CPU_OPCODE_BIT, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x2C
-    { CPU_OPCODE_AND, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x2D
-    { CPU_OPCODE_ROL, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x2E
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x2F
-
-    { CPU_OPCODE_BMI, CPU_ADDRESS_MODE_RELATIVE, 2 },       // 0x30
-    { CPU_OPCODE_AND, CPU_ADDRESS_MODE_INDIRECT_Y, 2 },     // 0x31
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x32
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x33
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x34
-    { CPU_OPCODE_AND, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0x35
-    { CPU_OPCODE_ROL, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0x36
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x37
-    { CPU_OPCODE_SEC, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x38
-    { CPU_OPCODE_AND, CPU_ADDRESS_MODE_ABSOLUTE_Y, 3 },     // 0x39
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x3A
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x3B
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x3C
-    { CPU_OPCODE_AND, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0x3D
-    { CPU_OPCODE_ROL, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0x3E
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x3F
-
-    { CPU_OPCODE_RTI, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x40
-    { CPU_OPCODE_EOR, CPU_ADDRESS_MODE_INDIRECT_X, 2 },     // 0x41
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x42
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x43
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x44
-    { CPU_OPCODE_EOR, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x45
-    { CPU_OPCODE_LSR, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x46
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x47
-    { CPU_OPCODE_PHA, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x48
-    { CPU_OPCODE_EOR, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0x49
-    { CPU_OPCODE_LSR, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x4A
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x4B
-    { CPU_OPCODE_JMP, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x4C
-    { CPU_OPCODE_EOR, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x4D
-    { CPU_OPCODE_LSR, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x4E
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x4F
-
-    { CPU_OPCODE_BVC, CPU_ADDRESS_MODE_RELATIVE, 2 },       // 0x50
-    { CPU_OPCODE_EOR, CPU_ADDRESS_MODE_INDIRECT_Y, 2 },     // 0x51
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x52
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x53
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x54
-    { CPU_OPCODE_EOR, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0x55
-    { CPU_OPCODE_LSR, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0x56
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x57
-    { CPU_OPCODE_CLI, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x58
-    { CPU_OPCODE_EOR, CPU_ADDRESS_MODE_ABSOLUTE_Y, 3 },     // 0x59
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x5A
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x5B
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x5C
-    { CPU_OPCODE_EOR, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0x5D
-    { CPU_OPCODE_LSR, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0x5E
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x5F
-
-    { CPU_OPCODE_RTS, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x60
-    { CPU_OPCODE_ADC, CPU_ADDRESS_MODE_INDIRECT_X, 2 },     // 0x61
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x62
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x63
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x64
-    { CPU_OPCODE_ADC, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x65
-    { CPU_OPCODE_ROR, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x66
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x67
-    { CPU_OPCODE_PLA, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x68
-    { CPU_OPCODE_ADC, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0x69
-    { CPU_OPCODE_ROR, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x6A
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x6B
-    { CPU_OPCODE_JMP, CPU_ADDRESS_MODE_INDIRECT, 3 },       // 0x6C
-    { CPU_OPCODE_ADC, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x6D
-    { CPU_OPCODE_ROR, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x6E
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x6F
-
-    { CPU_OPCODE_BVS, CPU_ADDRESS_MODE_RELATIVE, 2 },       // 0x70
-    { CPU_OPCODE_ADC, CPU_ADDRESS_MODE_INDIRECT_Y, 2 },     // 0x71
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x72
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x73
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x74
-    { CPU_OPCODE_ADC, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0x75
-    { CPU_OPCODE_ROR, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0x76
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x77
-    { CPU_OPCODE_SEI, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x78
-    { CPU_OPCODE_ADC, CPU_ADDRESS_MODE_ABSOLUTE_Y, 3 },     // 0x79
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x7A
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x7B
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x7C
-    { CPU_OPCODE_ADC, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0x7D
-    { CPU_OPCODE_ROR, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0x7E
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x7F
-
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x80
-    { CPU_OPCODE_STA, CPU_ADDRESS_MODE_INDIRECT_X, 2 },     // 0x81
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x82
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x83
-    { CPU_OPCODE_STY, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x84
-    { CPU_OPCODE_STA, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x85
-    { CPU_OPCODE_STX, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0x86
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x87
-    { CPU_OPCODE_DEY, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x88
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x89
-    { CPU_OPCODE_TXA, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x8A
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x8B
-    { CPU_OPCODE_STY, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x8C
-    { CPU_OPCODE_STA, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x8D
-    { CPU_OPCODE_STX, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0x8E
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x8F
-
-    { CPU_OPCODE_BCC, CPU_ADDRESS_MODE_RELATIVE, 2 },       // 0x90
-    { CPU_OPCODE_STA, CPU_ADDRESS_MODE_INDIRECT_Y, 2 },     // 0x91
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x92
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x93
-    { CPU_OPCODE_STY, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0x94
-    { CPU_OPCODE_STA, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0x95
-    { CPU_OPCODE_STX, CPU_ADDRESS_MODE_ZEROPAGE_Y, 2 },     // 0x96
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x97
-    { CPU_OPCODE_TYA, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x98
-    { CPU_OPCODE_STA, CPU_ADDRESS_MODE_ABSOLUTE_Y, 3 },     // 0x99
-    { CPU_OPCODE_TXS, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0x9A
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x9B
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x9C
-    { CPU_OPCODE_STA, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0x9D
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x9E
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0x9F
-
-    { CPU_OPCODE_LDY, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0xA0
-    { CPU_OPCODE_LDA, CPU_ADDRESS_MODE_INDIRECT_X, 2 },     // 0xA1
-    { CPU_OPCODE_LDX, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0xA2
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xA3
-    { CPU_OPCODE_LDY, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0xA4
-    { CPU_OPCODE_LDA, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0xA5
-    { CPU_OPCODE_LDX, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0xA6
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xA7
-    { CPU_OPCODE_TAY, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0xA8
-    { CPU_OPCODE_LDA, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0xA9
-    { CPU_OPCODE_TAX, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0xAA
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xAB
-    { CPU_OPCODE_LDY, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0xAC
-    { CPU_OPCODE_LDA, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0xAD
-    { CPU_OPCODE_LDX, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0xAE
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xAF
-
-    { CPU_OPCODE_BCS, CPU_ADDRESS_MODE_RELATIVE, 2 },       // 0xB0
-    { CPU_OPCODE_LDA, CPU_ADDRESS_MODE_INDIRECT_Y, 2 },     // 0xB1
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xB2
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xB3
-    { CPU_OPCODE_LDY, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0xB4
-    { CPU_OPCODE_LDA, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0xB5
-    { CPU_OPCODE_LDX, CPU_ADDRESS_MODE_ZEROPAGE_Y, 2 },     // 0xB6
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xB7
-    { CPU_OPCODE_CLV, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0xB8
-    { CPU_OPCODE_LDA, CPU_ADDRESS_MODE_ABSOLUTE_Y, 3 },     // 0xB9
-    { CPU_OPCODE_TSX, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0xBA
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xBB
-    { CPU_OPCODE_LDY, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0xBC
-    { CPU_OPCODE_LDA, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0xBD
-    { CPU_OPCODE_LDX, CPU_ADDRESS_MODE_ABSOLUTE_Y, 3 },     // 0xBE
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xBF
-
-    { CPU_OPCODE_CPY, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0xC0
-    { CPU_OPCODE_CMP, CPU_ADDRESS_MODE_INDIRECT_X, 2 },     // 0xC1
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xC2
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xC3
-    { CPU_OPCODE_CPY, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0xC4
-    { CPU_OPCODE_CMP, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0xC5
-    { CPU_OPCODE_DEC, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0xC6
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xC7
-    { CPU_OPCODE_INY, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0xC8
-    { CPU_OPCODE_CMP, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0xC9
-    { CPU_OPCODE_DEX, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0xCA
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xCB
-    { CPU_OPCODE_CPY, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0xCC
-    { CPU_OPCODE_CMP, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0xCD
-    { CPU_OPCODE_DEC, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0xCE
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xCF
-
-    { CPU_OPCODE_BNE, CPU_ADDRESS_MODE_RELATIVE, 2 },       // 0xD0
-    { CPU_OPCODE_CMP, CPU_ADDRESS_MODE_INDIRECT_Y, 2 },     // 0xD1
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xD2
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xD3
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xD4
-    { CPU_OPCODE_CMP, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0xD5
-    { CPU_OPCODE_DEC, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0xD6
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xD7
-    { CPU_OPCODE_CLD, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0xD8
-    { CPU_OPCODE_CMP, CPU_ADDRESS_MODE_ABSOLUTE_Y, 3 },     // 0xD9
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xDA
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xDB
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xDC
-    { CPU_OPCODE_CMP, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0xDD
-    { CPU_OPCODE_DEC, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0xDE
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xDF
-
-    { CPU_OPCODE_CPX, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0xE0
-    { CPU_OPCODE_SBC, CPU_ADDRESS_MODE_INDIRECT_X, 2 },     // 0xE1
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xE2
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xE3
-    { CPU_OPCODE_CPX, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0xE4
-    { CPU_OPCODE_SBC, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0xE5
-    { CPU_OPCODE_INC, CPU_ADDRESS_MODE_ZEROPAGE, 2 },       // 0xE6
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xE7
-    { CPU_OPCODE_INX, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0xE8
-    { CPU_OPCODE_SBC, CPU_ADDRESS_MODE_IMMEDIATE, 2 },      // 0xE9
-    { CPU_OPCODE_NOP, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0xEA
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xEB
-    { CPU_OPCODE_CPX, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0xEC
-    { CPU_OPCODE_SBC, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0xED
-    { CPU_OPCODE_INC, CPU_ADDRESS_MODE_ABSOLUTE, 3 },       // 0xEE
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xEF
-
-    { CPU_OPCODE_BEQ, CPU_ADDRESS_MODE_RELATIVE, 2 },       // 0xF0
-    { CPU_OPCODE_SBC, CPU_ADDRESS_MODE_INDIRECT_Y, 2 },     // 0xF1
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xF2
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xF3
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xF4
-    { CPU_OPCODE_SBC, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0xF5
-    { CPU_OPCODE_INC, CPU_ADDRESS_MODE_ZEROPAGE_X, 2 },     // 0xF6
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xF7
-    { CPU_OPCODE_SED, CPU_ADDRESS_MODE_IMPLIED, 1 },        // 0xF8
-    { CPU_OPCODE_SBC, CPU_ADDRESS_MODE_ABSOLUTE_Y, 3 },     // 0xF9
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xFA
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xFB
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xFC
-    { CPU_OPCODE_SBC, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0xFD
-    { CPU_OPCODE_INC, CPU_ADDRESS_MODE_ABSOLUTE_X, 3 },     // 0xFE
-    { CPU_OPCODE_UNKNOWN, CPU_ADDRESS_MODE_UNKNOWN, 0 },    // 0xFF
-};
\ No newline at end of file
+    if (cpu->jit)
+        jit_flush(cpu->jit);
+}
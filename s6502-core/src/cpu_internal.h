@@ -0,0 +1,148 @@
+#pragma once
+#include "s6502/cpu.h"
+
+// CPU internals shared between the interpreter and the JIT
+
+typedef struct jit_s jit_t;
+
+// Bytes an instruction occupies. Unknown opcodes execute as single byte NOPs.
+#define CPU_INSTRUCTION_LENGTH(size) ((size) ? (size) : 1)
+
+// Cycles an instruction spends fetching: its bytes, and single-byte instructions also read the next byte
+// (and ignore it), except for the 65C02's single cycle NOPs
+#define CPU_FETCH_CYCLES(size, base_cycles) \
+    ((size) > 1 ? (size) : ((base_cycles) < 2 ? (base_cycles) : 2))
+
+// Instruction tracing (`cpu_set_trace`) can be compiled out entirely
+#if !defined(S6502_NO_TRACE)
+    #define CPU_TRACE 1
+#else
+    #define CPU_TRACE 0
+#endif
+
+#define CPU_STACK_BASE 0x0100
+#define CPU_VECTOR_NMI 0xfffa
+#define CPU_VECTOR_RESET 0xfffc
+#define CPU_VECTOR_IRQ 0xfffe
+
+// Instruction handler, entered with the program counter still pointing at the opcode
+typedef void (*cpu_handler_fn)(cpu_t*, u16);
+
+// Everything specialized for one CPU variant and timing, generated from its opcode table (see cpu_variant.h)
+typedef struct cpu_variant_ops_s {
+    cpu_variant variant;
+    cpu_timing timing;
+    const cpu_instruction_info_t* info;     // Indexed by opcode byte
+    const char* const* mnemonics;           // Indexed by opcode byte
+    const cpu_handler_fn* handlers;         // Indexed by opcode byte
+    void (*execute)(cpu_t*, cpu_opcode, cpu_address_mode, u16);    // See `cpu_exec`
+    void (*run_interpreter)(cpu_t*);        // Interprets instructions until `cpu->stop`
+} cpu_variant_ops_t;
+
+// Predecoded instruction
+typedef struct cpu_decoded_s {
+    u16 operand;
+    u8 opcode;      // Opcode byte
+    b8 valid;
+} cpu_decoded_t;
+
+// Predecoded instructions of one bus page, indexed by address within the page
+typedef struct cpu_decoded_page_s {
+    cpu_decoded_t insts[BUS_PAGE_SIZE];
+    b8 marked;      // Page is marked as code on the bus
+} cpu_decoded_page_t;
+
+struct cpu_s {
+    u8 a, x, y, sp;
+    u16 pc;
+
+    // The status register only holds I, D, B and U. The other flags are kept apart, so instructions 
+    // set them with plain stores, and N/Z only as the result they derive from.
+    u8 status;
+    u8 n_result;    // N is bit 7 of this
+    u8 z_result;    // Z is set if this is zero
+    u8 carry;       // CPU_STATUS_FLAG_CARRY_BIT or 0
+    u8 overflow;    // CPU_STATUS_FLAG_OVERFLOW_BIT or 0
+
+    u64 cycles;
+    bus_t* bus;
+
+    // Cycle-accurate timing only: the cycle of the bus access in progress, which is what the bus is timed by.
+    // Each instruction starts it at its first cycle after fetching, and every access moves it on by one.
+    u64 bus_cycle;
+
+    // The run loop breaks out at `stop`: the run's target, or the next event deadline if earlier.
+    // Anything else needing the loop's attention, like a pending interrupt, pulls it in to 0.
+    u64 stop;
+    const u64* next_deadline;   // See `bus_get_next_deadline`
+
+    u32 irq_lines;      // Asserted IRQ lines, see `cpu_set_irq`
+    b8 nmi_pending;
+
+    // Direct host memory of the bus, see `bus_get_load_pages`
+    u8* const* load_pages;
+    u8* const* store_pages;
+
+    // Predecode cache, pages are allocated on first execution
+    cpu_decoded_page_t* decoded_pages[BUS_PAGE_COUNT];
+    cpu_decode_cache_stats_t decode_stats;
+
+    const cpu_variant_ops_t* ops;
+    cpu_backend backend;
+    jit_t* jit;     // CPU_BACKEND_JIT only
+
+    trace_t* trace; // (optional) Records every instruction, see `cpu_set_trace`
+
+    // Breakpoints are never predecoded, so only decoding from memory checks them
+    u8* breakpoints;                        // Bitmap by address, allocated with the first breakpoint
+    u16 breakpoint_counts[BUS_PAGE_COUNT];  // Per page, pages with breakpoints aren't translated
+    i32 resume_pc;      // Breakpoint to execute rather than stop at, the one the run last stopped at
+    b8 fetching;        // Decoding from memory, loads aren't data accesses for watchpoints
+    cpu_stop_t stopped;
+};
+
+// Assemble the status register from the separately kept flags
+static inline u8 cpu_get_status(const cpu_t* cpu) {
+    return (cpu->status & ~(CPU_STATUS_FLAG_NEGATIVE_BIT | CPU_STATUS_FLAG_ZERO_BIT | CPU_STATUS_FLAG_CARRY_BIT | CPU_STATUS_FLAG_OVERFLOW_BIT))
+        | (cpu->n_result & CPU_STATUS_FLAG_NEGATIVE_BIT)
+        | ((cpu->z_result == 0) << CPU_STATUS_ZERO_INDEX)
+        | cpu->carry
+        | cpu->overflow;
+}
+
+// Set the whole status register, splitting out the separately kept flags
+static inline void cpu_set_status(cpu_t* cpu, u8 status) {
+    cpu->status = status;
+    cpu->n_result = status & CPU_STATUS_FLAG_NEGATIVE_BIT;
+    cpu->z_result = !(status & CPU_STATUS_FLAG_ZERO_BIT);
+    cpu->carry = status & CPU_STATUS_FLAG_CARRY_BIT;
+    cpu->overflow = status & CPU_STATUS_FLAG_OVERFLOW_BIT;
+}
+
+// Pull the run loop's stop in when a device scheduled an event before it
+static inline void cpu_clamp_stop(cpu_t* cpu) {
+    if (*cpu->next_deadline < cpu->stop)
+        cpu->stop = *cpu->next_deadline;
+}
+
+// Indexed by `cpu_timing`, then `cpu_variant`
+extern const cpu_variant_ops_t g_cpu_variant_ops[CPU_TIMING_COUNT][CPU_VARIANT_COUNT];
+
+// Whether ADC and SBC honour the decimal flag on a variant
+#define CPU_HAS_DECIMAL_MODE(variant) ((variant) != CPU_VARIANT_2A03)
+
+// Whether shifts and rotates of indexed memory only take the indexing cycle when crossing a page,
+// and are charged for it then, as reads are. NMOS parts always take it, as part of the base cost.
+#define CPU_SHIFT_PAGE_PENALTY(variant) ((variant) == CPU_VARIANT_65C02)
+
+// Decimal mode ADC/SBC outcomes of every carry, accumulator and operand, generated at build time (tools/decimal_tables.c).
+// Entries hold the result in bits 0-7, and N, V, Z and C in their status register positions in bits 8-15.
+#define CPU_DECIMAL_INDEX(carry, a, m) (((u32)(carry) << 16) | ((u32)(a) << 8) | (m))
+
+typedef struct cpu_decimal_tables_s {
+    u16 adc[2 << 16];
+    u16 sbc[2 << 16];
+} cpu_decimal_tables_t;
+
+extern const cpu_decimal_tables_t g_cpu_nmos_decimal_tables;
+extern const cpu_decimal_tables_t g_cpu_65c02_decimal_tables;
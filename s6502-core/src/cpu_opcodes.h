@@ -0,0 +1,555 @@
+#pragma once
+#include "s6502/cpu.h"
+
+// Instruction tables, one entry per opcode byte:
+// X(byte, opcode, address mode, size in bytes, base cycle cost)
+// Page-crossing and branch-taken penalties are charged by the instruction itself.
+
+// NMOS 6502, also the 2A03
+#define CPU_OPCODE_TABLE_NMOS(X) \
+    X(0x00, BRK, IMPLIED, 1, 7)                     \
+    X(0x01, ORA, INDIRECT_X, 2, 6)                  \
+    X(0x02, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x03, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x04, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x05, ORA, ZEROPAGE, 2, 3)                    \
+    X(0x06, ASL, ZEROPAGE, 2, 5)                    \
+    X(0x07, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x08, PHP, IMPLIED, 1, 3)                     \
+    X(0x09, ORA, IMMEDIATE, 2, 2)                   \
+    X(0x0A, ASL, ACCUMULATOR, 1, 2)                 \
+    X(0x0B, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x0C, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x0D, ORA, ABSOLUTE, 3, 4)                    \
+    X(0x0E, ASL, ABSOLUTE, 3, 6)                    \
+    X(0x0F, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0x10, BPL, RELATIVE, 2, 2)                    \
+    X(0x11, ORA, INDIRECT_Y, 2, 5)                  \
+    X(0x12, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x13, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x14, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x15, ORA, ZEROPAGE_X, 2, 4)                  \
+    X(0x16, ASL, ZEROPAGE_X, 2, 6)                  \
+    X(0x17, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x18, CLC, IMPLIED, 1, 2)                     \
+    X(0x19, ORA, ABSOLUTE_Y, 3, 4)                  \
+    X(0x1A, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x1B, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x1C, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x1D, ORA, ABSOLUTE_X, 3, 4)                  \
+    X(0x1E, ASL, ABSOLUTE_X, 3, 7)                  \
+    X(0x1F, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0x20, JSR, ABSOLUTE, 3, 6)                    \
+    X(0x21, AND, INDIRECT_X, 2, 6)                  \
+    X(0x22, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x23, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x24, BIT, ZEROPAGE, 2, 3)                    \
+    X(0x25, AND, ZEROPAGE, 2, 3)                    \
+    X(0x26, ROL, ZEROPAGE, 2, 5)                    \
+    X(0x27, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x28, PLP, IMPLIED, 1, 4)                     \
+    X(0x29, AND, IMMEDIATE, 2, 2)                   \
+    X(0x2A, ROL, ACCUMULATOR, 1, 2)                 \
+    X(0x2B, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x2C, BIT, ABSOLUTE, 3, 4)                    \
+    X(0x2D, AND, ABSOLUTE, 3, 4)                    \
+    X(0x2E, ROL, ABSOLUTE, 3, 6)                    \
+    X(0x2F, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0x30, BMI, RELATIVE, 2, 2)                    \
+    X(0x31, AND, INDIRECT_Y, 2, 5)                  \
+    X(0x32, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x33, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x34, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x35, AND, ZEROPAGE_X, 2, 4)                  \
+    X(0x36, ROL, ZEROPAGE_X, 2, 6)                  \
+    X(0x37, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x38, SEC, IMPLIED, 1, 2)                     \
+    X(0x39, AND, ABSOLUTE_Y, 3, 4)                  \
+    X(0x3A, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x3B, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x3C, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x3D, AND, ABSOLUTE_X, 3, 4)                  \
+    X(0x3E, ROL, ABSOLUTE_X, 3, 7)                  \
+    X(0x3F, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0x40, RTI, IMPLIED, 1, 6)                     \
+    X(0x41, EOR, INDIRECT_X, 2, 6)                  \
+    X(0x42, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x43, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x44, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x45, EOR, ZEROPAGE, 2, 3)                    \
+    X(0x46, LSR, ZEROPAGE, 2, 5)                    \
+    X(0x47, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x48, PHA, IMPLIED, 1, 3)                     \
+    X(0x49, EOR, IMMEDIATE, 2, 2)                   \
+    X(0x4A, LSR, ACCUMULATOR, 1, 2)                 \
+    X(0x4B, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x4C, JMP, ABSOLUTE, 3, 3)                    \
+    X(0x4D, EOR, ABSOLUTE, 3, 4)                    \
+    X(0x4E, LSR, ABSOLUTE, 3, 6)                    \
+    X(0x4F, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0x50, BVC, RELATIVE, 2, 2)                    \
+    X(0x51, EOR, INDIRECT_Y, 2, 5)                  \
+    X(0x52, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x53, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x54, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x55, EOR, ZEROPAGE_X, 2, 4)                  \
+    X(0x56, LSR, ZEROPAGE_X, 2, 6)                  \
+    X(0x57, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x58, CLI, IMPLIED, 1, 2)                     \
+    X(0x59, EOR, ABSOLUTE_Y, 3, 4)                  \
+    X(0x5A, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x5B, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x5C, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x5D, EOR, ABSOLUTE_X, 3, 4)                  \
+    X(0x5E, LSR, ABSOLUTE_X, 3, 7)                  \
+    X(0x5F, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0x60, RTS, IMPLIED, 1, 6)                     \
+    X(0x61, ADC, INDIRECT_X, 2, 6)                  \
+    X(0x62, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x63, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x64, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x65, ADC, ZEROPAGE, 2, 3)                    \
+    X(0x66, ROR, ZEROPAGE, 2, 5)                    \
+    X(0x67, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x68, PLA, IMPLIED, 1, 4)                     \
+    X(0x69, ADC, IMMEDIATE, 2, 2)                   \
+    X(0x6A, ROR, ACCUMULATOR, 1, 2)                 \
+    X(0x6B, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x6C, JMP, INDIRECT, 3, 5)                    \
+    X(0x6D, ADC, ABSOLUTE, 3, 4)                    \
+    X(0x6E, ROR, ABSOLUTE, 3, 6)                    \
+    X(0x6F, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0x70, BVS, RELATIVE, 2, 2)                    \
+    X(0x71, ADC, INDIRECT_Y, 2, 5)                  \
+    X(0x72, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x73, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x74, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x75, ADC, ZEROPAGE_X, 2, 4)                  \
+    X(0x76, ROR, ZEROPAGE_X, 2, 6)                  \
+    X(0x77, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x78, SEI, IMPLIED, 1, 2)                     \
+    X(0x79, ADC, ABSOLUTE_Y, 3, 4)                  \
+    X(0x7A, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x7B, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x7C, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x7D, ADC, ABSOLUTE_X, 3, 4)                  \
+    X(0x7E, ROR, ABSOLUTE_X, 3, 7)                  \
+    X(0x7F, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0x80, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x81, STA, INDIRECT_X, 2, 6)                  \
+    X(0x82, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x83, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x84, STY, ZEROPAGE, 2, 3)                    \
+    X(0x85, STA, ZEROPAGE, 2, 3)                    \
+    X(0x86, STX, ZEROPAGE, 2, 3)                    \
+    X(0x87, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x88, DEY, IMPLIED, 1, 2)                     \
+    X(0x89, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x8A, TXA, IMPLIED, 1, 2)                     \
+    X(0x8B, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x8C, STY, ABSOLUTE, 3, 4)                    \
+    X(0x8D, STA, ABSOLUTE, 3, 4)                    \
+    X(0x8E, STX, ABSOLUTE, 3, 4)                    \
+    X(0x8F, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0x90, BCC, RELATIVE, 2, 2)                    \
+    X(0x91, STA, INDIRECT_Y, 2, 6)                  \
+    X(0x92, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x93, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x94, STY, ZEROPAGE_X, 2, 4)                  \
+    X(0x95, STA, ZEROPAGE_X, 2, 4)                  \
+    X(0x96, STX, ZEROPAGE_Y, 2, 4)                  \
+    X(0x97, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x98, TYA, IMPLIED, 1, 2)                     \
+    X(0x99, STA, ABSOLUTE_Y, 3, 5)                  \
+    X(0x9A, TXS, IMPLIED, 1, 2)                     \
+    X(0x9B, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x9C, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x9D, STA, ABSOLUTE_X, 3, 5)                  \
+    X(0x9E, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0x9F, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0xA0, LDY, IMMEDIATE, 2, 2)                   \
+    X(0xA1, LDA, INDIRECT_X, 2, 6)                  \
+    X(0xA2, LDX, IMMEDIATE, 2, 2)                   \
+    X(0xA3, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xA4, LDY, ZEROPAGE, 2, 3)                    \
+    X(0xA5, LDA, ZEROPAGE, 2, 3)                    \
+    X(0xA6, LDX, ZEROPAGE, 2, 3)                    \
+    X(0xA7, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xA8, TAY, IMPLIED, 1, 2)                     \
+    X(0xA9, LDA, IMMEDIATE, 2, 2)                   \
+    X(0xAA, TAX, IMPLIED, 1, 2)                     \
+    X(0xAB, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xAC, LDY, ABSOLUTE, 3, 4)                    \
+    X(0xAD, LDA, ABSOLUTE, 3, 4)                    \
+    X(0xAE, LDX, ABSOLUTE, 3, 4)                    \
+    X(0xAF, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0xB0, BCS, RELATIVE, 2, 2)                    \
+    X(0xB1, LDA, INDIRECT_Y, 2, 5)                  \
+    X(0xB2, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xB3, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xB4, LDY, ZEROPAGE_X, 2, 4)                  \
+    X(0xB5, LDA, ZEROPAGE_X, 2, 4)                  \
+    X(0xB6, LDX, ZEROPAGE_Y, 2, 4)                  \
+    X(0xB7, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xB8, CLV, IMPLIED, 1, 2)                     \
+    X(0xB9, LDA, ABSOLUTE_Y, 3, 4)                  \
+    X(0xBA, TSX, IMPLIED, 1, 2)                     \
+    X(0xBB, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xBC, LDY, ABSOLUTE_X, 3, 4)                  \
+    X(0xBD, LDA, ABSOLUTE_X, 3, 4)                  \
+    X(0xBE, LDX, ABSOLUTE_Y, 3, 4)                  \
+    X(0xBF, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0xC0, CPY, IMMEDIATE, 2, 2)                   \
+    X(0xC1, CMP, INDIRECT_X, 2, 6)                  \
+    X(0xC2, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xC3, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xC4, CPY, ZEROPAGE, 2, 3)                    \
+    X(0xC5, CMP, ZEROPAGE, 2, 3)                    \
+    X(0xC6, DEC, ZEROPAGE, 2, 5)                    \
+    X(0xC7, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xC8, INY, IMPLIED, 1, 2)                     \
+    X(0xC9, CMP, IMMEDIATE, 2, 2)                   \
+    X(0xCA, DEX, IMPLIED, 1, 2)                     \
+    X(0xCB, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xCC, CPY, ABSOLUTE, 3, 4)                    \
+    X(0xCD, CMP, ABSOLUTE, 3, 4)                    \
+    X(0xCE, DEC, ABSOLUTE, 3, 6)                    \
+    X(0xCF, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0xD0, BNE, RELATIVE, 2, 2)                    \
+    X(0xD1, CMP, INDIRECT_Y, 2, 5)                  \
+    X(0xD2, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xD3, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xD4, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xD5, CMP, ZEROPAGE_X, 2, 4)                  \
+    X(0xD6, DEC, ZEROPAGE_X, 2, 6)                  \
+    X(0xD7, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xD8, CLD, IMPLIED, 1, 2)                     \
+    X(0xD9, CMP, ABSOLUTE_Y, 3, 4)                  \
+    X(0xDA, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xDB, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xDC, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xDD, CMP, ABSOLUTE_X, 3, 4)                  \
+    X(0xDE, DEC, ABSOLUTE_X, 3, 7)                  \
+    X(0xDF, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0xE0, CPX, IMMEDIATE, 2, 2)                   \
+    X(0xE1, SBC, INDIRECT_X, 2, 6)                  \
+    X(0xE2, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xE3, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xE4, CPX, ZEROPAGE, 2, 3)                    \
+    X(0xE5, SBC, ZEROPAGE, 2, 3)                    \
+    X(0xE6, INC, ZEROPAGE, 2, 5)                    \
+    X(0xE7, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xE8, INX, IMPLIED, 1, 2)                     \
+    X(0xE9, SBC, IMMEDIATE, 2, 2)                   \
+    X(0xEA, NOP, IMPLIED, 1, 2)                     \
+    X(0xEB, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xEC, CPX, ABSOLUTE, 3, 4)                    \
+    X(0xED, SBC, ABSOLUTE, 3, 4)                    \
+    X(0xEE, INC, ABSOLUTE, 3, 6)                    \
+    X(0xEF, UNKNOWN, UNKNOWN, 0, 2)                 \
+    \
+    X(0xF0, BEQ, RELATIVE, 2, 2)                    \
+    X(0xF1, SBC, INDIRECT_Y, 2, 5)                  \
+    X(0xF2, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xF3, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xF4, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xF5, SBC, ZEROPAGE_X, 2, 4)                  \
+    X(0xF6, INC, ZEROPAGE_X, 2, 6)                  \
+    X(0xF7, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xF8, SED, IMPLIED, 1, 2)                     \
+    X(0xF9, SBC, ABSOLUTE_Y, 3, 4)                  \
+    X(0xFA, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xFB, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xFC, UNKNOWN, UNKNOWN, 0, 2)                 \
+    X(0xFD, SBC, ABSOLUTE_X, 3, 4)                  \
+    X(0xFE, INC, ABSOLUTE_X, 3, 7)                  \
+    X(0xFF, UNKNOWN, UNKNOWN, 0, 2)
+
+// 65C02. Every opcode the NMOS part leaves undefined is a NOP of fixed size and cycles.
+// The Rockwell and WDC bit instructions (RMB, SMB, BBR, BBS) and WAI/STP aren't included.
+#define CPU_OPCODE_TABLE_65C02(X) \
+    X(0x00, BRK, IMPLIED, 1, 7)                     \
+    X(0x01, ORA, INDIRECT_X, 2, 6)                  \
+    X(0x02, NOP, IMMEDIATE, 2, 2)                   \
+    X(0x03, NOP, IMPLIED, 1, 1)                     \
+    X(0x04, TSB, ZEROPAGE, 2, 5)                    \
+    X(0x05, ORA, ZEROPAGE, 2, 3)                    \
+    X(0x06, ASL, ZEROPAGE, 2, 5)                    \
+    X(0x07, NOP, IMPLIED, 1, 1)                     \
+    X(0x08, PHP, IMPLIED, 1, 3)                     \
+    X(0x09, ORA, IMMEDIATE, 2, 2)                   \
+    X(0x0A, ASL, ACCUMULATOR, 1, 2)                 \
+    X(0x0B, NOP, IMPLIED, 1, 1)                     \
+    X(0x0C, TSB, ABSOLUTE, 3, 6)                    \
+    X(0x0D, ORA, ABSOLUTE, 3, 4)                    \
+    X(0x0E, ASL, ABSOLUTE, 3, 6)                    \
+    X(0x0F, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0x10, BPL, RELATIVE, 2, 2)                    \
+    X(0x11, ORA, INDIRECT_Y, 2, 5)                  \
+    X(0x12, ORA, INDIRECT_ZEROPAGE, 2, 5)           \
+    X(0x13, NOP, IMPLIED, 1, 1)                     \
+    X(0x14, TRB, ZEROPAGE, 2, 5)                    \
+    X(0x15, ORA, ZEROPAGE_X, 2, 4)                  \
+    X(0x16, ASL, ZEROPAGE_X, 2, 6)                  \
+    X(0x17, NOP, IMPLIED, 1, 1)                     \
+    X(0x18, CLC, IMPLIED, 1, 2)                     \
+    X(0x19, ORA, ABSOLUTE_Y, 3, 4)                  \
+    X(0x1A, INC, ACCUMULATOR, 1, 2)                 \
+    X(0x1B, NOP, IMPLIED, 1, 1)                     \
+    X(0x1C, TRB, ABSOLUTE, 3, 6)                    \
+    X(0x1D, ORA, ABSOLUTE_X, 3, 4)                  \
+    X(0x1E, ASL, ABSOLUTE_X, 3, 6)                  \
+    X(0x1F, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0x20, JSR, ABSOLUTE, 3, 6)                    \
+    X(0x21, AND, INDIRECT_X, 2, 6)                  \
+    X(0x22, NOP, IMMEDIATE, 2, 2)                   \
+    X(0x23, NOP, IMPLIED, 1, 1)                     \
+    X(0x24, BIT, ZEROPAGE, 2, 3)                    \
+    X(0x25, AND, ZEROPAGE, 2, 3)                    \
+    X(0x26, ROL, ZEROPAGE, 2, 5)                    \
+    X(0x27, NOP, IMPLIED, 1, 1)                     \
+    X(0x28, PLP, IMPLIED, 1, 4)                     \
+    X(0x29, AND, IMMEDIATE, 2, 2)                   \
+    X(0x2A, ROL, ACCUMULATOR, 1, 2)                 \
+    X(0x2B, NOP, IMPLIED, 1, 1)                     \
+    X(0x2C, BIT, ABSOLUTE, 3, 4)                    \
+    X(0x2D, AND, ABSOLUTE, 3, 4)                    \
+    X(0x2E, ROL, ABSOLUTE, 3, 6)                    \
+    X(0x2F, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0x30, BMI, RELATIVE, 2, 2)                    \
+    X(0x31, AND, INDIRECT_Y, 2, 5)                  \
+    X(0x32, AND, INDIRECT_ZEROPAGE, 2, 5)           \
+    X(0x33, NOP, IMPLIED, 1, 1)                     \
+    X(0x34, BIT, ZEROPAGE_X, 2, 4)                  \
+    X(0x35, AND, ZEROPAGE_X, 2, 4)                  \
+    X(0x36, ROL, ZEROPAGE_X, 2, 6)                  \
+    X(0x37, NOP, IMPLIED, 1, 1)                     \
+    X(0x38, SEC, IMPLIED, 1, 2)                     \
+    X(0x39, AND, ABSOLUTE_Y, 3, 4)                  \
+    X(0x3A, DEC, ACCUMULATOR, 1, 2)                 \
+    X(0x3B, NOP, IMPLIED, 1, 1)                     \
+    X(0x3C, BIT, ABSOLUTE_X, 3, 4)                  \
+    X(0x3D, AND, ABSOLUTE_X, 3, 4)                  \
+    X(0x3E, ROL, ABSOLUTE_X, 3, 6)                  \
+    X(0x3F, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0x40, RTI, IMPLIED, 1, 6)                     \
+    X(0x41, EOR, INDIRECT_X, 2, 6)                  \
+    X(0x42, NOP, IMMEDIATE, 2, 2)                   \
+    X(0x43, NOP, IMPLIED, 1, 1)                     \
+    X(0x44, NOP, ZEROPAGE, 2, 3)                    \
+    X(0x45, EOR, ZEROPAGE, 2, 3)                    \
+    X(0x46, LSR, ZEROPAGE, 2, 5)                    \
+    X(0x47, NOP, IMPLIED, 1, 1)                     \
+    X(0x48, PHA, IMPLIED, 1, 3)                     \
+    X(0x49, EOR, IMMEDIATE, 2, 2)                   \
+    X(0x4A, LSR, ACCUMULATOR, 1, 2)                 \
+    X(0x4B, NOP, IMPLIED, 1, 1)                     \
+    X(0x4C, JMP, ABSOLUTE, 3, 3)                    \
+    X(0x4D, EOR, ABSOLUTE, 3, 4)                    \
+    X(0x4E, LSR, ABSOLUTE, 3, 6)                    \
+    X(0x4F, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0x50, BVC, RELATIVE, 2, 2)                    \
+    X(0x51, EOR, INDIRECT_Y, 2, 5)                  \
+    X(0x52, EOR, INDIRECT_ZEROPAGE, 2, 5)           \
+    X(0x53, NOP, IMPLIED, 1, 1)                     \
+    X(0x54, NOP, ZEROPAGE_X, 2, 4)                  \
+    X(0x55, EOR, ZEROPAGE_X, 2, 4)                  \
+    X(0x56, LSR, ZEROPAGE_X, 2, 6)                  \
+    X(0x57, NOP, IMPLIED, 1, 1)                     \
+    X(0x58, CLI, IMPLIED, 1, 2)                     \
+    X(0x59, EOR, ABSOLUTE_Y, 3, 4)                  \
+    X(0x5A, PHY, IMPLIED, 1, 3)                     \
+    X(0x5B, NOP, IMPLIED, 1, 1)                     \
+    X(0x5C, NOP, ABSOLUTE, 3, 8)                    \
+    X(0x5D, EOR, ABSOLUTE_X, 3, 4)                  \
+    X(0x5E, LSR, ABSOLUTE_X, 3, 6)                  \
+    X(0x5F, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0x60, RTS, IMPLIED, 1, 6)                     \
+    X(0x61, ADC, INDIRECT_X, 2, 6)                  \
+    X(0x62, NOP, IMMEDIATE, 2, 2)                   \
+    X(0x63, NOP, IMPLIED, 1, 1)                     \
+    X(0x64, STZ, ZEROPAGE, 2, 3)                    \
+    X(0x65, ADC, ZEROPAGE, 2, 3)                    \
+    X(0x66, ROR, ZEROPAGE, 2, 5)                    \
+    X(0x67, NOP, IMPLIED, 1, 1)                     \
+    X(0x68, PLA, IMPLIED, 1, 4)                     \
+    X(0x69, ADC, IMMEDIATE, 2, 2)                   \
+    X(0x6A, ROR, ACCUMULATOR, 1, 2)                 \
+    X(0x6B, NOP, IMPLIED, 1, 1)                     \
+    X(0x6C, JMP, INDIRECT, 3, 6)                    \
+    X(0x6D, ADC, ABSOLUTE, 3, 4)                    \
+    X(0x6E, ROR, ABSOLUTE, 3, 6)                    \
+    X(0x6F, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0x70, BVS, RELATIVE, 2, 2)                    \
+    X(0x71, ADC, INDIRECT_Y, 2, 5)                  \
+    X(0x72, ADC, INDIRECT_ZEROPAGE, 2, 5)           \
+    X(0x73, NOP, IMPLIED, 1, 1)                     \
+    X(0x74, STZ, ZEROPAGE_X, 2, 4)                  \
+    X(0x75, ADC, ZEROPAGE_X, 2, 4)                  \
+    X(0x76, ROR, ZEROPAGE_X, 2, 6)                  \
+    X(0x77, NOP, IMPLIED, 1, 1)                     \
+    X(0x78, SEI, IMPLIED, 1, 2)                     \
+    X(0x79, ADC, ABSOLUTE_Y, 3, 4)                  \
+    X(0x7A, PLY, IMPLIED, 1, 4)                     \
+    X(0x7B, NOP, IMPLIED, 1, 1)                     \
+    X(0x7C, JMP, INDIRECT_ABSOLUTE_X, 3, 6)         \
+    X(0x7D, ADC, ABSOLUTE_X, 3, 4)                  \
+    X(0x7E, ROR, ABSOLUTE_X, 3, 6)                  \
+    X(0x7F, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0x80, BRA, RELATIVE, 2, 2)                    \
+    X(0x81, STA, INDIRECT_X, 2, 6)                  \
+    X(0x82, NOP, IMMEDIATE, 2, 2)                   \
+    X(0x83, NOP, IMPLIED, 1, 1)                     \
+    X(0x84, STY, ZEROPAGE, 2, 3)                    \
+    X(0x85, STA, ZEROPAGE, 2, 3)                    \
+    X(0x86, STX, ZEROPAGE, 2, 3)                    \
+    X(0x87, NOP, IMPLIED, 1, 1)                     \
+    X(0x88, DEY, IMPLIED, 1, 2)                     \
+    X(0x89, BIT, IMMEDIATE, 2, 2)                   \
+    X(0x8A, TXA, IMPLIED, 1, 2)                     \
+    X(0x8B, NOP, IMPLIED, 1, 1)                     \
+    X(0x8C, STY, ABSOLUTE, 3, 4)                    \
+    X(0x8D, STA, ABSOLUTE, 3, 4)                    \
+    X(0x8E, STX, ABSOLUTE, 3, 4)                    \
+    X(0x8F, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0x90, BCC, RELATIVE, 2, 2)                    \
+    X(0x91, STA, INDIRECT_Y, 2, 6)                  \
+    X(0x92, STA, INDIRECT_ZEROPAGE, 2, 5)           \
+    X(0x93, NOP, IMPLIED, 1, 1)                     \
+    X(0x94, STY, ZEROPAGE_X, 2, 4)                  \
+    X(0x95, STA, ZEROPAGE_X, 2, 4)                  \
+    X(0x96, STX, ZEROPAGE_Y, 2, 4)                  \
+    X(0x97, NOP, IMPLIED, 1, 1)                     \
+    X(0x98, TYA, IMPLIED, 1, 2)                     \
+    X(0x99, STA, ABSOLUTE_Y, 3, 5)                  \
+    X(0x9A, TXS, IMPLIED, 1, 2)                     \
+    X(0x9B, NOP, IMPLIED, 1, 1)                     \
+    X(0x9C, STZ, ABSOLUTE, 3, 4)                    \
+    X(0x9D, STA, ABSOLUTE_X, 3, 5)                  \
+    X(0x9E, STZ, ABSOLUTE_X, 3, 5)                  \
+    X(0x9F, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0xA0, LDY, IMMEDIATE, 2, 2)                   \
+    X(0xA1, LDA, INDIRECT_X, 2, 6)                  \
+    X(0xA2, LDX, IMMEDIATE, 2, 2)                   \
+    X(0xA3, NOP, IMPLIED, 1, 1)                     \
+    X(0xA4, LDY, ZEROPAGE, 2, 3)                    \
+    X(0xA5, LDA, ZEROPAGE, 2, 3)                    \
+    X(0xA6, LDX, ZEROPAGE, 2, 3)                    \
+    X(0xA7, NOP, IMPLIED, 1, 1)                     \
+    X(0xA8, TAY, IMPLIED, 1, 2)                     \
+    X(0xA9, LDA, IMMEDIATE, 2, 2)                   \
+    X(0xAA, TAX, IMPLIED, 1, 2)                     \
+    X(0xAB, NOP, IMPLIED, 1, 1)                     \
+    X(0xAC, LDY, ABSOLUTE, 3, 4)                    \
+    X(0xAD, LDA, ABSOLUTE, 3, 4)                    \
+    X(0xAE, LDX, ABSOLUTE, 3, 4)                    \
+    X(0xAF, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0xB0, BCS, RELATIVE, 2, 2)                    \
+    X(0xB1, LDA, INDIRECT_Y, 2, 5)                  \
+    X(0xB2, LDA, INDIRECT_ZEROPAGE, 2, 5)           \
+    X(0xB3, NOP, IMPLIED, 1, 1)                     \
+    X(0xB4, LDY, ZEROPAGE_X, 2, 4)                  \
+    X(0xB5, LDA, ZEROPAGE_X, 2, 4)                  \
+    X(0xB6, LDX, ZEROPAGE_Y, 2, 4)                  \
+    X(0xB7, NOP, IMPLIED, 1, 1)                     \
+    X(0xB8, CLV, IMPLIED, 1, 2)                     \
+    X(0xB9, LDA, ABSOLUTE_Y, 3, 4)                  \
+    X(0xBA, TSX, IMPLIED, 1, 2)                     \
+    X(0xBB, NOP, IMPLIED, 1, 1)                     \
+    X(0xBC, LDY, ABSOLUTE_X, 3, 4)                  \
+    X(0xBD, LDA, ABSOLUTE_X, 3, 4)                  \
+    X(0xBE, LDX, ABSOLUTE_Y, 3, 4)                  \
+    X(0xBF, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0xC0, CPY, IMMEDIATE, 2, 2)                   \
+    X(0xC1, CMP, INDIRECT_X, 2, 6)                  \
+    X(0xC2, NOP, IMMEDIATE, 2, 2)                   \
+    X(0xC3, NOP, IMPLIED, 1, 1)                     \
+    X(0xC4, CPY, ZEROPAGE, 2, 3)                    \
+    X(0xC5, CMP, ZEROPAGE, 2, 3)                    \
+    X(0xC6, DEC, ZEROPAGE, 2, 5)                    \
+    X(0xC7, NOP, IMPLIED, 1, 1)                     \
+    X(0xC8, INY, IMPLIED, 1, 2)                     \
+    X(0xC9, CMP, IMMEDIATE, 2, 2)                   \
+    X(0xCA, DEX, IMPLIED, 1, 2)                     \
+    X(0xCB, NOP, IMPLIED, 1, 1)                     \
+    X(0xCC, CPY, ABSOLUTE, 3, 4)                    \
+    X(0xCD, CMP, ABSOLUTE, 3, 4)                    \
+    X(0xCE, DEC, ABSOLUTE, 3, 6)                    \
+    X(0xCF, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0xD0, BNE, RELATIVE, 2, 2)                    \
+    X(0xD1, CMP, INDIRECT_Y, 2, 5)                  \
+    X(0xD2, CMP, INDIRECT_ZEROPAGE, 2, 5)           \
+    X(0xD3, NOP, IMPLIED, 1, 1)                     \
+    X(0xD4, NOP, ZEROPAGE_X, 2, 4)                  \
+    X(0xD5, CMP, ZEROPAGE_X, 2, 4)                  \
+    X(0xD6, DEC, ZEROPAGE_X, 2, 6)                  \
+    X(0xD7, NOP, IMPLIED, 1, 1)                     \
+    X(0xD8, CLD, IMPLIED, 1, 2)                     \
+    X(0xD9, CMP, ABSOLUTE_Y, 3, 4)                  \
+    X(0xDA, PHX, IMPLIED, 1, 3)                     \
+    X(0xDB, NOP, IMPLIED, 1, 1)                     \
+    X(0xDC, NOP, ABSOLUTE, 3, 4)                    \
+    X(0xDD, CMP, ABSOLUTE_X, 3, 4)                  \
+    X(0xDE, DEC, ABSOLUTE_X, 3, 7)                  \
+    X(0xDF, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0xE0, CPX, IMMEDIATE, 2, 2)                   \
+    X(0xE1, SBC, INDIRECT_X, 2, 6)                  \
+    X(0xE2, NOP, IMMEDIATE, 2, 2)                   \
+    X(0xE3, NOP, IMPLIED, 1, 1)                     \
+    X(0xE4, CPX, ZEROPAGE, 2, 3)                    \
+    X(0xE5, SBC, ZEROPAGE, 2, 3)                    \
+    X(0xE6, INC, ZEROPAGE, 2, 5)                    \
+    X(0xE7, NOP, IMPLIED, 1, 1)                     \
+    X(0xE8, INX, IMPLIED, 1, 2)                     \
+    X(0xE9, SBC, IMMEDIATE, 2, 2)                   \
+    X(0xEA, NOP, IMPLIED, 1, 2)                     \
+    X(0xEB, NOP, IMPLIED, 1, 1)                     \
+    X(0xEC, CPX, ABSOLUTE, 3, 4)                    \
+    X(0xED, SBC, ABSOLUTE, 3, 4)                    \
+    X(0xEE, INC, ABSOLUTE, 3, 6)                    \
+    X(0xEF, NOP, IMPLIED, 1, 1)                     \
+    \
+    X(0xF0, BEQ, RELATIVE, 2, 2)                    \
+    X(0xF1, SBC, INDIRECT_Y, 2, 5)                  \
+    X(0xF2, SBC, INDIRECT_ZEROPAGE, 2, 5)           \
+    X(0xF3, NOP, IMPLIED, 1, 1)                     \
+    X(0xF4, NOP, ZEROPAGE_X, 2, 4)                  \
+    X(0xF5, SBC, ZEROPAGE_X, 2, 4)                  \
+    X(0xF6, INC, ZEROPAGE_X, 2, 6)                  \
+    X(0xF7, NOP, IMPLIED, 1, 1)                     \
+    X(0xF8, SED, IMPLIED, 1, 2)                     \
+    X(0xF9, SBC, ABSOLUTE_Y, 3, 4)                  \
+    X(0xFA, PLX, IMPLIED, 1, 4)                     \
+    X(0xFB, NOP, IMPLIED, 1, 1)                     \
+    X(0xFC, NOP, ABSOLUTE, 3, 4)                    \
+    X(0xFD, SBC, ABSOLUTE_X, 3, 4)                  \
+    X(0xFE, INC, ABSOLUTE_X, 3, 7)                  \
+    X(0xFF, NOP, IMPLIED, 1, 1)
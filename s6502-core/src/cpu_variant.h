@@ -0,0 +1,101 @@
+// Everything specialized for one CPU variant and timing: instruction info, mnemonics, handlers and the interpreter loop.
+// Included by cpu.c once per variant and timing, with these defined:
+//   CPU_VARIANT                the `cpu_variant`
+//   CPU_VARIANT_TABLE          its instruction table, see cpu_opcodes.h
+//   CPU_VARIANT_TIMING         the `cpu_timing`
+//   CPU_VARIANT_SYMBOL(name)   a symbol name unique to the variant and timing
+// Every instruction executes with the variant and timing as constants, so the checks of other variants' quirks,
+// and the cycle-accurate bus accesses with fast timing, fold away.
+
+static const cpu_instruction_info_t CPU_VARIANT_SYMBOL(info_table)[256] = {
+#define CPU_INFO_ENTRY(byte, opcode, mode, size, base_cycles) \
+    [byte] = { CPU_OPCODE_##opcode, CPU_ADDRESS_MODE_##mode, size, base_cycles },
+    CPU_VARIANT_TABLE(CPU_INFO_ENTRY)
+#undef CPU_INFO_ENTRY
+};
+
+static const char* const CPU_VARIANT_SYMBOL(mnemonic_table)[256] = {
+#define CPU_MNEMONIC_ENTRY(byte, opcode, mode, size, base_cycles) [byte] = #opcode,
+    CPU_VARIANT_TABLE(CPU_MNEMONIC_ENTRY)
+#undef CPU_MNEMONIC_ENTRY
+};
+
+// Only cycle-accurate timing keeps `cpu->bus_cycle`
+#define CPU_VARIANT_START_BUS_CYCLE(size, base_cycles) \
+    if (CPU_VARIANT_TIMING == CPU_TIMING_CYCLE_ACCURATE) \
+        cpu->bus_cycle = cpu->cycles + CPU_FETCH_CYCLES(size, base_cycles)
+
+// One handler per opcode byte, with address mode, size and cycle cost known at compile time.
+// The interpreter loop inlines them, once each has been folded down to its instruction.
+#define CPU_DEFINE_HANDLER(byte, opcode, mode, size, base_cycles) \
+    static CPU_FORCE_INLINE void CPU_VARIANT_SYMBOL(handler_##byte)(cpu_t* cpu, u16 operand) { \
+        cpu->pc += CPU_INSTRUCTION_LENGTH(size); \
+        CPU_VARIANT_START_BUS_CYCLE(size, base_cycles); \
+        cpu->cycles += base_cycles; \
+        cpu_execute(cpu, CPU_VARIANT, CPU_VARIANT_TIMING, CPU_OPCODE_##opcode, CPU_ADDRESS_MODE_##mode, operand); \
+    }
+CPU_VARIANT_TABLE(CPU_DEFINE_HANDLER)
+#undef CPU_DEFINE_HANDLER
+
+static const cpu_handler_fn CPU_VARIANT_SYMBOL(handler_table)[256] = {
+#define CPU_HANDLER_ENTRY(byte, opcode, mode, size, base_cycles) [byte] = CPU_VARIANT_SYMBOL(handler_##byte),
+    CPU_VARIANT_TABLE(CPU_HANDLER_ENTRY)
+#undef CPU_HANDLER_ENTRY
+};
+
+// Executes an instruction decoded elsewhere, see `cpu_exec`
+static void CPU_VARIANT_SYMBOL(execute)(cpu_t* cpu, cpu_opcode opcode, cpu_address_mode addr_mode, u16 operand) {
+    cpu_execute(cpu, CPU_VARIANT, CPU_VARIANT_TIMING, opcode, addr_mode, operand);
+}
+
+// Interprets instructions until `cpu->stop`
+static void CPU_VARIANT_SYMBOL(run_interpreter)(cpu_t* cpu) {
+#if CPU_COMPUTED_GOTO
+    static const void* labels[256] = {
+    #define CPU_LABEL_ENTRY(byte, opcode, mode, size, base_cycles) [byte] = &&cpu_label_##byte,
+        CPU_VARIANT_TABLE(CPU_LABEL_ENTRY)
+    #undef CPU_LABEL_ENTRY
+    };
+
+    // Every handler ends in its own indirect jump, giving the branch predictor one target history per opcode.
+    // Predecoded instructions are always valid, so the breakpoint check folds away on the cache hit path.
+    cpu_decoded_t decoded;
+
+    #define CPU_DISPATCH() \
+        if (cpu->cycles >= cpu->stop) \
+            return; \
+        decoded = cpu_decode_pc(cpu); \
+        if (!decoded.valid) { \
+            cpu_break(cpu); \
+            return; \
+        } \
+        goto *labels[decoded.opcode];
+
+    CPU_DISPATCH();
+
+    #define CPU_DEFINE_LABEL(byte, opcode, mode, size, base_cycles) \
+    cpu_label_##byte: { \
+        CPU_VARIANT_SYMBOL(handler_##byte)(cpu, decoded.operand); \
+        CPU_DISPATCH(); \
+    }
+    CPU_VARIANT_TABLE(CPU_DEFINE_LABEL)
+    #undef CPU_DEFINE_LABEL
+    #undef CPU_DISPATCH
+#else
+    while (cpu->cycles < cpu->stop) {
+        cpu_decoded_t decoded = cpu_decode_pc(cpu);
+        if (!decoded.valid) {
+            cpu_break(cpu);
+            return;
+        }
+
+        CPU_VARIANT_SYMBOL(handler_table)[decoded.opcode](cpu, decoded.operand);
+    }
+#endif
+}
+
+#undef CPU_VARIANT_START_BUS_CYCLE
+#undef CPU_VARIANT
+#undef CPU_VARIANT_TABLE
+#undef CPU_VARIANT_TIMING
+#undef CPU_VARIANT_SYMBOL
@@ -0,0 +1,193 @@
+#include "s6502/input_log.h"
+
+#include <stdio.h>
+
+#define INPUT_LOG_MAGIC "S6502IN1"
+#define INPUT_LOG_MAGIC_SIZE 8
+#define INPUT_LOG_BUFFER_SIZE (1 << 16)
+
+// Encoded record layout: the cycle delta as a zigzag LEB128 (snapshot restores can take the cycle count back),
+// shifted left by one with the low bit set if the address changed, then the address if so (little endian),
+// then the value. Devices polled in a loop take 2 or 3 bytes per load.
+#define INPUT_LOG_MAX_RECORD_SIZE (10 + 2 + 1)
+
+typedef struct input_log_entry_s {
+    u64 cycle;
+    u16 addr;
+    u8 value;
+} input_log_entry_t;
+
+struct input_log_s {
+    FILE* file;
+    input_log_mode mode;
+    u64 num_records;
+
+    input_log_entry_t previous;     // Last record encoded or decoded
+    input_log_entry_t next;         // Replay: the record the next load must match
+    b8 has_next;
+
+    b8 diverged;
+    u64 diverged_cycle;
+    u16 diverged_addr;
+};
+
+// Decode the next record into `log->next`
+// @returns False at the end of the file or on a truncated record
+static b8 input_log_decode(input_log_t* log) {
+    FILE* file = log->file;
+    u64 word = 0;
+    u32 shift = 0;
+    int byte;
+
+    do {
+        byte = getc(file);
+        if (byte == EOF || shift >= 64)
+            return FALSE;
+
+        word |= (u64)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    u64 zigzag = word >> 1;
+    input_log_entry_t entry = log->previous;
+    entry.cycle += (zigzag >> 1) ^ (0 - (zigzag & 1));
+
+    if (word & 1) {
+        int lo = getc(file);
+        int hi = getc(file);
+        if (lo == EOF || hi == EOF)
+            return FALSE;
+
+        entry.addr = (u16)(lo | (hi << 8));
+    }
+
+    int value = getc(file);
+    if (value == EOF)
+        return FALSE;
+
+    entry.value = (u8)value;
+    log->next = entry;
+    log->previous = entry;
+
+    return TRUE;
+}
+
+
+input_log_t* input_log_create(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        return NULL;
+
+    setvbuf(file, NULL, _IOFBF, INPUT_LOG_BUFFER_SIZE);
+    fwrite(INPUT_LOG_MAGIC, 1, INPUT_LOG_MAGIC_SIZE, file);
+
+    input_log_t* log = (input_log_t*)calloc(1, sizeof(input_log_t));
+    log->file = file;
+    log->mode = INPUT_LOG_RECORD;
+
+    return log;
+}
+
+input_log_t* input_log_open(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    char magic[INPUT_LOG_MAGIC_SIZE];
+    if (fread(magic, 1, INPUT_LOG_MAGIC_SIZE, file) != INPUT_LOG_MAGIC_SIZE || memcmp(magic, INPUT_LOG_MAGIC, INPUT_LOG_MAGIC_SIZE) != 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    setvbuf(file, NULL, _IOFBF, INPUT_LOG_BUFFER_SIZE);
+
+    input_log_t* log = (input_log_t*)calloc(1, sizeof(input_log_t));
+    log->file = file;
+    log->mode = INPUT_LOG_REPLAY;
+    log->has_next = input_log_decode(log);
+
+    return log;
+}
+
+void input_log_free(input_log_t* log) {
+    fclose(log->file);
+    free(log);
+}
+
+void input_log_flush(input_log_t* log) {
+    if (log->mode == INPUT_LOG_RECORD)
+        fflush(log->file);
+}
+
+input_log_mode input_log_get_mode(input_log_t* log) {
+    return log->mode;
+}
+
+u64 input_log_get_num_records(input_log_t* log) {
+    return log->num_records;
+}
+
+void input_log_record(input_log_t* log, u64 cycle, u16 addr, u8 value) {
+    assert(log->mode == INPUT_LOG_RECORD);
+
+    u8 bytes[INPUT_LOG_MAX_RECORD_SIZE];
+    u32 size = 0;
+
+    i64 delta = (i64)(cycle - log->previous.cycle);
+    u64 zigzag = ((u64)delta << 1) ^ (u64)(delta >> 63);
+    b8 addr_changed = log->num_records == 0 || addr != log->previous.addr;
+
+    // The zigzag delta loses its top bit to the address flag, only reached by deltas of 2^62 cycles
+    u64 word = (zigzag << 1) | addr_changed;
+
+    do {
+        u8 byte = word & 0x7f;
+        word >>= 7;
+        bytes[size++] = word ? byte | 0x80 : byte;
+    } while (word);
+
+    if (addr_changed) {
+        bytes[size++] = (u8)addr;
+        bytes[size++] = (u8)(addr >> 8);
+    }
+
+    bytes[size++] = value;
+    fwrite(bytes, 1, size, log->file);
+
+    log->previous.cycle = cycle;
+    log->previous.addr = addr;
+    log->previous.value = value;
+    log->num_records++;
+}
+
+b8 input_log_replay(input_log_t* log, u64 cycle, u16 addr, u8* value) {
+    assert(log->mode == INPUT_LOG_REPLAY);
+
+    if (log->diverged)
+        return FALSE;
+
+    if (!log->has_next || log->next.cycle != cycle || log->next.addr != addr) {
+        log->diverged = TRUE;
+        log->diverged_cycle = cycle;
+        log->diverged_addr = addr;
+        return FALSE;
+    }
+
+    *value = log->next.value;
+    log->num_records++;
+    log->has_next = input_log_decode(log);
+
+    return TRUE;
+}
+
+b8 input_log_get_divergence(input_log_t* log, u64* cycle, u16* addr) {
+    if (!log->diverged)
+        return FALSE;
+
+    if (cycle)
+        *cycle = log->diverged_cycle;
+    if (addr)
+        *addr = log->diverged_addr;
+
+    return TRUE;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "cpu_internal.h"
+
+// Dynamic recompiler translating hot basic blocks of 6502 code to native code.
+// Only available on x86-64 hosts with the System V calling convention.
+
+// Translated basic block
+typedef struct jit_block_s {
+    void (*code)(cpu_t*);
+    u32 max_cycles;     // Upper bound of the cycles the block can take, including penalties
+} jit_block_t;
+
+// @returns True if the host supports the JIT
+b8 jit_supported();
+
+// Creates a JIT instance for a CPU
+// @param[in] cpu
+// @returns New JIT instance, or NULL if the host isn't supported
+jit_t* jit_create(cpu_t* cpu);
+
+// Frees a JIT instance and all translated code
+// @param[in] jit
+void jit_free(jit_t* jit);
+
+// Looks up the translated block starting at an address, counting the execution and 
+// translating the block once it becomes hot. Must not be called from within a block.
+// @param[in] jit
+// @param[in] pc Block start address
+// @returns Translated block, or NULL if the address should be interpreted
+jit_block_t* jit_lookup(jit_t* jit, u16 pc);
+
+// Discards all blocks starting in a bus page. Safe to call while a block is executing, 
+// which then exits after the current instruction.
+// @param[in] jit
+// @param[in] page Bus page index
+void jit_invalidate_page(jit_t* jit, u32 page);
+
+// Discards all translated blocks
+// @param[in] jit
+void jit_flush(jit_t* jit);
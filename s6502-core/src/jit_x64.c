@@ -0,0 +1,1322 @@
+#include "jit.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__)) && !defined(S6502_NO_JIT)
+    #define JIT_X64 1
+#else
+    #define JIT_X64 0
+#endif
+
+#if JIT_X64
+
+#include <stddef.h>
+#include <sys/mman.h>
+
+#define JIT_CODE_SIZE (4 * 1024 * 1024)
+#define JIT_MAX_BLOCKS 16384
+#define JIT_MAX_BLOCK_INSTRUCTIONS 64
+#define JIT_MAX_BLOCK_CODE (32 * 1024)
+#define JIT_MAX_EXITS 256
+
+// Executions of an address before it gets translated
+#define JIT_HOT_THRESHOLD 16
+
+// Blocks and execution counters of one bus page, indexed by address within the page
+typedef struct jit_page_s {
+    jit_block_t* blocks[BUS_PAGE_SIZE];
+    u16 counters[BUS_PAGE_SIZE];
+} jit_page_t;
+
+struct jit_s {
+    cpu_t* cpu;
+    jit_page_t* pages[BUS_PAGE_COUNT];
+
+    // Code and blocks are bump allocated, and only reclaimed all at once by `jit_flush`
+    u8* code;
+    u32 code_used;
+    jit_block_t* blocks;
+    u32 num_blocks;
+
+    b8 exit_requested;  // A page was invalidated, possibly under the executing block
+};
+
+// Marks addresses that failed to translate, so they aren't retried
+static jit_block_t g_jit_untranslatable;
+
+// Zero and negative flags for every 8-bit result. Constant, as translated code of every CPU reads it.
+#define JIT_NZ_NEGATIVE_16 \
+    CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, \
+    CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT, CPU_STATUS_FLAG_NEGATIVE_BIT
+
+static const u8 g_jit_nz_table[256] = {
+    [0x00] = CPU_STATUS_FLAG_ZERO_BIT,
+    [0x80] = JIT_NZ_NEGATIVE_16, JIT_NZ_NEGATIVE_16, JIT_NZ_NEGATIVE_16, JIT_NZ_NEGATIVE_16,
+        JIT_NZ_NEGATIVE_16, JIT_NZ_NEGATIVE_16, JIT_NZ_NEGATIVE_16, JIT_NZ_NEGATIVE_16
+};
+
+
+// x86-64 emitter
+
+typedef enum {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+    NO_REG = 0xff
+} jit_reg;
+
+// Register assignment within a block. All of them are callee-saved, so they survive calls into the bus.
+#define JIT_REG_CPU R12
+#define JIT_REG_A R13
+#define JIT_REG_X R14
+#define JIT_REG_Y R15
+#define JIT_REG_SP RBP
+#define JIT_REG_STATUS RBX
+
+// Condition codes
+typedef enum {
+    CC_B = 0x2,     // Below (carry)
+    CC_AE = 0x3,    // Above or equal (no carry)
+    CC_E = 0x4,
+    CC_NE = 0x5
+} jit_cc;
+
+// ALU operations, as `op r/m32, r32` opcodes and their `81 /ext` immediate forms
+typedef enum {
+    ALU_ADD = 0x01,
+    ALU_OR = 0x09,
+    ALU_AND = 0x21,
+    ALU_SUB = 0x29,
+    ALU_XOR = 0x31,
+    ALU_CMP = 0x39,
+    ALU_TEST = 0x85,
+    ALU_MOV = 0x89
+} jit_alu;
+
+typedef struct jit_emitter_s {
+    u8* code;
+    u32 size;
+    u32 capacity;
+    b8 overflow;
+} jit_emitter_t;
+
+static void emit8(jit_emitter_t* e, u8 byte) {
+    if (e->size >= e->capacity) {
+        e->overflow = TRUE;
+        return;
+    }
+
+    e->code[e->size++] = byte;
+}
+
+static void emit16(jit_emitter_t* e, u16 value) {
+    emit8(e, (u8)value);
+    emit8(e, (u8)(value >> 8));
+}
+
+static void emit32(jit_emitter_t* e, u32 value) {
+    emit16(e, (u16)value);
+    emit16(e, (u16)(value >> 16));
+}
+
+static void emit64(jit_emitter_t* e, u64 value) {
+    emit32(e, (u32)value);
+    emit32(e, (u32)(value >> 32));
+}
+
+// REX prefix, omitted when not needed. Byte operations on SPL/BPL/SIL/DIL always need one.
+static void emit_rex(jit_emitter_t* e, b8 w, u8 reg, u8 index, u8 base, b8 byte_reg) {
+    u8 rex = 0x40 | (w << 3) | (((reg >> 3) & 1) << 2) | (((index >> 3) & 1) << 1) | ((base >> 3) & 1);
+    b8 force = byte_reg && ((reg >= RSP && reg <= RDI) || (base >= RSP && base <= RDI));
+
+    if (rex != 0x40 || force)
+        emit8(e, rex);
+}
+
+static void emit_modrm_reg(jit_emitter_t* e, u8 reg, u8 rm) {
+    emit8(e, 0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// ModRM (and SIB/displacement) for `[base + index * (1 << scale) + disp]`
+static void emit_modrm_mem(jit_emitter_t* e, u8 reg, u8 base, u8 index, u8 scale, i32 disp) {
+    u8 mod = (disp == 0 && (base & 7) != RBP) ? 0 : ((disp >= -128 && disp <= 127) ? 1 : 2);
+
+    if (index == NO_REG && (base & 7) != RSP) {
+        emit8(e, (mod << 6) | ((reg & 7) << 3) | (base & 7));
+    }
+    else {
+        emit8(e, (mod << 6) | ((reg & 7) << 3) | 4);
+        emit8(e, (scale << 6) | (((index == NO_REG) ? 4 : index) & 7) << 3 | (base & 7));
+    }
+
+    if (mod == 1)
+        emit8(e, (u8)disp);
+    else if (mod == 2)
+        emit32(e, (u32)disp);
+}
+
+#define REX_INDEX(index) (((index) == NO_REG) ? 0 : (index))
+
+// `op dst, src` on 32-bit registers
+static void emit_alu_rr(jit_emitter_t* e, jit_alu op, u8 dst, u8 src) {
+    emit_rex(e, FALSE, src, 0, dst, FALSE);
+    emit8(e, op);
+    emit_modrm_reg(e, src, dst);
+}
+
+// `op dst, imm32` on a 32-bit register
+static void emit_alu_ri(jit_emitter_t* e, jit_alu op, u8 dst, u32 imm) {
+    if (op == ALU_MOV) {
+        emit_rex(e, FALSE, 0, 0, dst, FALSE);
+        emit8(e, 0xb8 + (dst & 7));
+        emit32(e, imm);
+        return;
+    }
+
+    emit_rex(e, FALSE, 0, 0, dst, FALSE);
+    emit8(e, 0x81);
+    emit_modrm_reg(e, op >> 3, dst);
+    emit32(e, imm);
+}
+
+// `op dst, dword [base + disp]`
+static void emit_alu_rm(jit_emitter_t* e, jit_alu op, u8 dst, u8 base, i32 disp) {
+    emit_rex(e, FALSE, dst, 0, base, FALSE);
+    emit8(e, op == ALU_MOV ? 0x8b : op + 2);
+    emit_modrm_mem(e, dst, base, NO_REG, 0, disp);
+}
+
+// `mov dword [base + disp], src`
+static void emit_store_m32(jit_emitter_t* e, u8 base, i32 disp, u8 src) {
+    emit_rex(e, FALSE, src, 0, base, FALSE);
+    emit8(e, 0x89);
+    emit_modrm_mem(e, src, base, NO_REG, 0, disp);
+}
+
+static void emit_mov_ri64(jit_emitter_t* e, u8 dst, u64 imm) {
+    emit_rex(e, TRUE, 0, 0, dst, FALSE);
+    emit8(e, 0xb8 + (dst & 7));
+    emit64(e, imm);
+}
+
+static void emit_mov_rr64(jit_emitter_t* e, u8 dst, u8 src) {
+    emit_rex(e, TRUE, src, 0, dst, FALSE);
+    emit8(e, 0x89);
+    emit_modrm_reg(e, src, dst);
+}
+
+// `test reg, reg` on 64-bit registers
+static void emit_test_r64(jit_emitter_t* e, u8 reg) {
+    emit_rex(e, TRUE, reg, 0, reg, FALSE);
+    emit8(e, 0x85);
+    emit_modrm_reg(e, reg, reg);
+}
+
+// `movzx dst, src8`
+static void emit_movzx_rr8(jit_emitter_t* e, u8 dst, u8 src) {
+    emit_rex(e, FALSE, dst, 0, src, TRUE);
+    emit8(e, 0x0f);
+    emit8(e, 0xb6);
+    emit_modrm_reg(e, dst, src);
+}
+
+// `movzx dst, byte [base + index + disp]`
+static void emit_movzx_rm8(jit_emitter_t* e, u8 dst, u8 base, u8 index, i32 disp) {
+    emit_rex(e, FALSE, dst, REX_INDEX(index), base, FALSE);
+    emit8(e, 0x0f);
+    emit8(e, 0xb6);
+    emit_modrm_mem(e, dst, base, index, 0, disp);
+}
+
+// `mov dst, qword [base + index * 8]`
+static void emit_load_r64_table(jit_emitter_t* e, u8 dst, u8 base, u8 index) {
+    emit_rex(e, TRUE, dst, index, base, FALSE);
+    emit8(e, 0x8b);
+    emit_modrm_mem(e, dst, base, index, 3, 0);
+}
+
+// `movzx dst, word [base + index * 2]`
+static void emit_movzx_r16_table(jit_emitter_t* e, u8 dst, u8 base, u8 index) {
+    emit_rex(e, FALSE, dst, index, base, FALSE);
+    emit8(e, 0x0f);
+    emit8(e, 0xb7);
+    emit_modrm_mem(e, dst, base, index, 1, 0);
+}
+
+// `mov byte [base + index + disp], src8`
+static void emit_store_m8(jit_emitter_t* e, u8 base, u8 index, i32 disp, u8 src) {
+    emit_rex(e, FALSE, src, REX_INDEX(index), base, TRUE);
+    emit8(e, 0x88);
+    emit_modrm_mem(e, src, base, index, 0, disp);
+}
+
+// `mov word [base + disp], src16`
+static void emit_store_m16(jit_emitter_t* e, u8 base, i32 disp, u8 src) {
+    emit8(e, 0x66);
+    emit_rex(e, FALSE, src, 0, base, FALSE);
+    emit8(e, 0x89);
+    emit_modrm_mem(e, src, base, NO_REG, 0, disp);
+}
+
+// `mov word [base + disp], imm16`
+static void emit_store_m16_imm(jit_emitter_t* e, u8 base, i32 disp, u16 imm) {
+    emit8(e, 0x66);
+    emit_rex(e, FALSE, 0, 0, base, FALSE);
+    emit8(e, 0xc7);
+    emit_modrm_mem(e, 0, base, NO_REG, 0, disp);
+    emit16(e, imm);
+}
+
+// `add qword [base + disp], imm32`
+static void emit_add_m64_imm(jit_emitter_t* e, u8 base, i32 disp, u32 imm) {
+    emit_rex(e, TRUE, 0, 0, base, FALSE);
+    emit8(e, 0x81);
+    emit_modrm_mem(e, 0, base, NO_REG, 0, disp);
+    emit32(e, imm);
+}
+
+// `add qword [base + disp], src64`
+static void emit_add_m64_r(jit_emitter_t* e, u8 base, i32 disp, u8 src) {
+    emit_rex(e, TRUE, src, 0, base, FALSE);
+    emit8(e, 0x01);
+    emit_modrm_mem(e, src, base, NO_REG, 0, disp);
+}
+
+// `or dst8, byte [base + index]`
+static void emit_or_r8_m8(jit_emitter_t* e, u8 dst, u8 base, u8 index) {
+    emit_rex(e, FALSE, dst, index, base, TRUE);
+    emit8(e, 0x0a);
+    emit_modrm_mem(e, dst, base, index, 0, 0);
+}
+
+// `shl/shr dst, imm8`
+static void emit_shl_ri(jit_emitter_t* e, u8 dst, u8 imm) {
+    emit_rex(e, FALSE, 0, 0, dst, FALSE);
+    emit8(e, 0xc1);
+    emit_modrm_reg(e, 4, dst);
+    emit8(e, imm);
+}
+
+static void emit_shr_ri(jit_emitter_t* e, u8 dst, u8 imm) {
+    emit_rex(e, FALSE, 0, 0, dst, FALSE);
+    emit8(e, 0xc1);
+    emit_modrm_reg(e, 5, dst);
+    emit8(e, imm);
+}
+
+// `test dst8, imm8`
+static void emit_test_r8_imm(jit_emitter_t* e, u8 dst, u8 imm) {
+    emit_rex(e, FALSE, 0, 0, dst, TRUE);
+    emit8(e, 0xf6);
+    emit_modrm_reg(e, 0, dst);
+    emit8(e, imm);
+}
+
+static void emit_setcc(jit_emitter_t* e, jit_cc cc, u8 dst) {
+    emit_rex(e, FALSE, 0, 0, dst, TRUE);
+    emit8(e, 0x0f);
+    emit8(e, 0x90 + cc);
+    emit_modrm_reg(e, 0, dst);
+}
+
+// @returns Offset of the rel32 to patch
+static u32 emit_jcc(jit_emitter_t* e, jit_cc cc) {
+    emit8(e, 0x0f);
+    emit8(e, 0x80 + cc);
+    emit32(e, 0);
+    return e->size - 4;
+}
+
+// @returns Offset of the rel32 to patch
+static u32 emit_jmp(jit_emitter_t* e) {
+    emit8(e, 0xe9);
+    emit32(e, 0);
+    return e->size - 4;
+}
+
+// Point a rel32 at the current position
+static void emit_patch_here(jit_emitter_t* e, u32 rel_offset) {
+    if (e->overflow)
+        return;
+
+    u32 rel = e->size - (rel_offset + 4);
+    memcpy(&e->code[rel_offset], &rel, sizeof(rel));
+}
+
+static void emit_call(jit_emitter_t* e, const void* fn) {
+    emit_mov_ri64(e, RAX, (u64)(size_t)fn);
+    emit8(e, 0xff);
+    emit8(e, 0xd0);
+}
+
+static void emit_push(jit_emitter_t* e, u8 reg) {
+    emit_rex(e, FALSE, 0, 0, reg, FALSE);
+    emit8(e, 0x50 + (reg & 7));
+}
+
+static void emit_pop(jit_emitter_t* e, u8 reg) {
+    emit_rex(e, FALSE, 0, 0, reg, FALSE);
+    emit8(e, 0x58 + (reg & 7));
+}
+
+
+// Bus access helpers, called from translated code when a page has no direct host memory
+
+// @returns The value loaded, with bit 8 set if the executing block must exit after the instruction,
+// because a watchpoint stopped the run, or a device scheduled an event the block might run past
+static u32 jit_helper_load(cpu_t* cpu, u32 addr) {
+    u64 stop = cpu->stop;
+    u8 value = 0;
+    bus_load(cpu->bus, (u16)addr, &value);
+    cpu_clamp_stop(cpu);
+
+    return value | ((u32)(cpu->stop != stop) << 8);
+}
+
+// @returns True if the executing block must exit, because code was invalidated, 
+// or a device scheduled an event the block might run past
+static u32 jit_helper_store(cpu_t* cpu, u32 addr, u32 value) {
+    u64 stop = cpu->stop;
+    bus_store(cpu->bus, (u16)addr, (u8)value);
+    cpu_clamp_stop(cpu);
+
+    b8 exit_requested = cpu->jit->exit_requested || cpu->stop != stop;
+    cpu->jit->exit_requested = FALSE;
+    return exit_requested;
+}
+
+
+// Block translation
+
+#define JIT_CPU_FIELD(field) ((i32)offsetof(cpu_t, field))
+
+// Scratch stack slots below the saved registers
+#define JIT_SCRATCH_0 0
+#define JIT_SCRATCH_1 8
+#define JIT_SCRATCH_EXIT 16     // Nonzero once a load asked the block to exit, see `jit_helper_load`
+#define JIT_FRAME_SIZE 24
+
+typedef struct jit_translation_s {
+    jit_emitter_t e;
+    cpu_t* cpu;
+    u32 exits[JIT_MAX_EXITS];   // jmp rel32 offsets to the epilogue
+    u32 num_exits;
+    u32 max_cycles;
+    b8 loaded;                  // The instruction being translated loads through `jit_helper_load`
+} jit_translation_t;
+
+static void jit_emit_exit(jit_translation_t* t) {
+    u32 rel = emit_jmp(&t->e);
+
+    if (t->num_exits < JIT_MAX_EXITS)
+        t->exits[t->num_exits++] = rel;
+    else
+        t->e.overflow = TRUE;
+}
+
+// Exit the block at a fixed address
+static void jit_emit_exit_to(jit_translation_t* t, u16 pc) {
+    emit_store_m16_imm(&t->e, JIT_REG_CPU, JIT_CPU_FIELD(pc), pc);
+    jit_emit_exit(t);
+}
+
+static void jit_emit_add_cycles(jit_translation_t* t, u32 cycles) {
+    if (cycles)
+        emit_add_m64_imm(&t->e, JIT_REG_CPU, JIT_CPU_FIELD(cycles), cycles);
+}
+
+// Set the zero and negative flags from a zero-extended 8-bit value. Clobbers RSI.
+static void jit_emit_nz(jit_translation_t* t, u8 reg) {
+    emit_alu_ri(&t->e, ALU_AND, JIT_REG_STATUS, ~(u32)(CPU_STATUS_FLAG_ZERO_BIT | CPU_STATUS_FLAG_NEGATIVE_BIT));
+    emit_mov_ri64(&t->e, RSI, (u64)(size_t)g_jit_nz_table);
+    emit_or_r8_m8(&t->e, JIT_REG_STATUS, RSI, reg);
+}
+
+// Set the carry flag from a register holding 0 or 1
+static void jit_emit_carry_reg(jit_translation_t* t, u8 reg) {
+    emit_alu_ri(&t->e, ALU_AND, JIT_REG_STATUS, ~(u32)CPU_STATUS_FLAG_CARRY_BIT);
+    emit_alu_rr(&t->e, ALU_OR, JIT_REG_STATUS, reg);
+}
+
+// Load from the bus address in EAX into EAX. Clobbers all caller-saved registers.
+// Loads through the bus may request the block to exit once the instruction is done, see `jit_emit_load_exit`.
+static void jit_emit_load(jit_translation_t* t) {
+    jit_emitter_t* e = &t->e;
+
+    emit_alu_rr(e, ALU_MOV, RCX, RAX);
+    emit_shr_ri(e, RCX, BUS_PAGE_BITS);
+    emit_mov_ri64(e, RDX, (u64)(size_t)t->cpu->load_pages);
+    emit_load_r64_table(e, RDX, RDX, RCX);
+    emit_test_r64(e, RDX);
+    u32 slow = emit_jcc(e, CC_E);
+
+    emit_alu_ri(e, ALU_AND, RAX, BUS_PAGE_MASK);
+    emit_movzx_rm8(e, RAX, RDX, RAX, 0);
+    u32 done = emit_jmp(e);
+
+    emit_patch_here(e, slow);
+    emit_alu_rr(e, ALU_MOV, RSI, RAX);
+    emit_mov_rr64(e, RDI, JIT_REG_CPU);
+    emit_call(e, jit_helper_load);
+
+    emit_alu_rr(e, ALU_MOV, RCX, RAX);
+    emit_shr_ri(e, RCX, 8);
+    emit_alu_rm(e, ALU_OR, RCX, RSP, JIT_SCRATCH_EXIT);
+    emit_store_m32(e, RSP, JIT_SCRATCH_EXIT, RCX);
+    emit_alu_ri(e, ALU_AND, RAX, 0xff);
+    t->loaded = TRUE;
+
+    emit_patch_here(e, done);
+}
+
+// Exit the block to `next_pc` if a load of the instruction just translated requested it
+static void jit_emit_load_exit(jit_translation_t* t, u16 next_pc) {
+    jit_emitter_t* e = &t->e;
+
+    emit_alu_rm(e, ALU_MOV, RAX, RSP, JIT_SCRATCH_EXIT);
+    emit_test_r8_imm(e, RAX, 0xff);
+    u32 stay = emit_jcc(e, CC_E);
+    jit_emit_exit_to(t, next_pc);
+    emit_patch_here(e, stay);
+}
+
+// Store EDX to the bus address in EAX. Clobbers all caller-saved registers.
+// All of the instruction's register updates must be done by then, as the block
+// exits to `next_pc` if the store invalidated code (unless `next_pc` is negative).
+static void jit_emit_store(jit_translation_t* t, i32 next_pc) {
+    jit_emitter_t* e = &t->e;
+
+    emit_alu_rr(e, ALU_MOV, RCX, RAX);
+    emit_shr_ri(e, RCX, BUS_PAGE_BITS);
+    emit_mov_ri64(e, RSI, (u64)(size_t)t->cpu->store_pages);
+    emit_load_r64_table(e, RSI, RSI, RCX);
+    emit_test_r64(e, RSI);
+    u32 slow = emit_jcc(e, CC_E);
+
+    emit_alu_ri(e, ALU_AND, RAX, BUS_PAGE_MASK);
+    emit_store_m8(e, RSI, RAX, 0, RDX);
+    u32 done = emit_jmp(e);
+
+    emit_patch_here(e, slow);
+    emit_alu_rr(e, ALU_MOV, RSI, RAX);
+    emit_mov_rr64(e, RDI, JIT_REG_CPU);
+    emit_call(e, jit_helper_store);
+
+    if (next_pc >= 0) {
+        emit_test_r8_imm(e, RAX, 0xff);
+        u32 stay = emit_jcc(e, CC_E);
+        jit_emit_exit_to(t, (u16)next_pc);
+        emit_patch_here(e, stay);
+    }
+
+    emit_patch_here(e, done);
+}
+
+// Effective address of an operand into EAX, charging page-crossing penalties if requested
+static void jit_emit_address(jit_translation_t* t, cpu_address_mode mode, u16 operand, b8 page_penalty) {
+    jit_emitter_t* e = &t->e;
+
+    switch (mode) {
+    case CPU_ADDRESS_MODE_ZEROPAGE:
+        emit_alu_ri(e, ALU_MOV, RAX, operand & 0xff);
+        break;
+    case CPU_ADDRESS_MODE_ZEROPAGE_X:
+    case CPU_ADDRESS_MODE_ZEROPAGE_Y:
+        emit_alu_rr(e, ALU_MOV, RAX, mode == CPU_ADDRESS_MODE_ZEROPAGE_X ? JIT_REG_X : JIT_REG_Y);
+        emit_alu_ri(e, ALU_ADD, RAX, operand & 0xff);
+        emit_movzx_rr8(e, RAX, RAX);
+        break;
+    case CPU_ADDRESS_MODE_ABSOLUTE:
+        emit_alu_ri(e, ALU_MOV, RAX, operand);
+        break;
+    case CPU_ADDRESS_MODE_ABSOLUTE_X:
+    case CPU_ADDRESS_MODE_ABSOLUTE_Y: {
+        u8 index = mode == CPU_ADDRESS_MODE_ABSOLUTE_X ? JIT_REG_X : JIT_REG_Y;
+
+        if (page_penalty) {
+            // (lo + index) >> 8 is exactly the page-crossing penalty
+            emit_alu_rr(e, ALU_MOV, RCX, index);
+            emit_alu_ri(e, ALU_ADD, RCX, operand & 0xff);
+            emit_shr_ri(e, RCX, 8);
+            emit_add_m64_r(e, JIT_REG_CPU, JIT_CPU_FIELD(cycles), RCX);
+        }
+
+        emit_alu_rr(e, ALU_MOV, RAX, index);
+        emit_alu_ri(e, ALU_ADD, RAX, operand);
+        emit_alu_ri(e, ALU_AND, RAX, 0xffff);
+        break;
+    }
+    case CPU_ADDRESS_MODE_INDIRECT:
+        // The pointer's hi-byte is fetched without carrying into the page (NMOS quirk, fixed on the 65C02)
+        emit_alu_ri(e, ALU_MOV, RAX, operand);
+        jit_emit_load(t);
+        emit_store_m32(e, RSP, JIT_SCRATCH_0, RAX);
+        if (t->cpu->ops->variant == CPU_VARIANT_65C02)
+            emit_alu_ri(e, ALU_MOV, RAX, (u16)(operand + 1));
+        else
+            emit_alu_ri(e, ALU_MOV, RAX, (operand & 0xff00) | ((operand + 1) & 0xff));
+        jit_emit_load(t);
+        emit_shl_ri(e, RAX, 8);
+        emit_alu_rm(e, ALU_OR, RAX, RSP, JIT_SCRATCH_0);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT_X:
+        emit_alu_rr(e, ALU_MOV, RAX, JIT_REG_X);
+        emit_alu_ri(e, ALU_ADD, RAX, operand & 0xff);
+        emit_movzx_rr8(e, RAX, RAX);
+        emit_store_m32(e, RSP, JIT_SCRATCH_1, RAX);
+        jit_emit_load(t);
+        emit_store_m32(e, RSP, JIT_SCRATCH_0, RAX);
+        emit_alu_rm(e, ALU_MOV, RAX, RSP, JIT_SCRATCH_1);
+        emit_alu_ri(e, ALU_ADD, RAX, 1);
+        emit_movzx_rr8(e, RAX, RAX);
+        jit_emit_load(t);
+        emit_shl_ri(e, RAX, 8);
+        emit_alu_rm(e, ALU_OR, RAX, RSP, JIT_SCRATCH_0);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT_ZEROPAGE:
+        emit_alu_ri(e, ALU_MOV, RAX, operand & 0xff);
+        jit_emit_load(t);
+        emit_store_m32(e, RSP, JIT_SCRATCH_0, RAX);
+        emit_alu_ri(e, ALU_MOV, RAX, (operand + 1) & 0xff);
+        jit_emit_load(t);
+        emit_shl_ri(e, RAX, 8);
+        emit_alu_rm(e, ALU_OR, RAX, RSP, JIT_SCRATCH_0);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT_Y:
+        emit_alu_ri(e, ALU_MOV, RAX, operand & 0xff);
+        jit_emit_load(t);
+        emit_store_m32(e, RSP, JIT_SCRATCH_0, RAX);
+        emit_alu_ri(e, ALU_MOV, RAX, (operand + 1) & 0xff);
+        jit_emit_load(t);
+        emit_shl_ri(e, RAX, 8);
+        emit_alu_rm(e, ALU_OR, RAX, RSP, JIT_SCRATCH_0);
+
+        if (page_penalty) {
+            emit_movzx_rr8(e, RCX, RAX);
+            emit_alu_rr(e, ALU_ADD, RCX, JIT_REG_Y);
+            emit_shr_ri(e, RCX, 8);
+            emit_add_m64_r(e, JIT_REG_CPU, JIT_CPU_FIELD(cycles), RCX);
+        }
+
+        emit_alu_rr(e, ALU_ADD, RAX, JIT_REG_Y);
+        emit_alu_ri(e, ALU_AND, RAX, 0xffff);
+        break;
+    default:
+        break;
+    }
+}
+
+// Value an instruction operates on into EAX
+static void jit_emit_read_operand(jit_translation_t* t, cpu_address_mode mode, u16 operand) {
+    switch (mode) {
+    case CPU_ADDRESS_MODE_IMMEDIATE:
+        emit_alu_ri(&t->e, ALU_MOV, RAX, operand & 0xff);
+        break;
+    case CPU_ADDRESS_MODE_ACCUMULATOR:
+        emit_alu_rr(&t->e, ALU_MOV, RAX, JIT_REG_A);
+        break;
+    default:
+        jit_emit_address(t, mode, operand, TRUE);
+        jit_emit_load(t);
+        break;
+    }
+}
+
+// Stack address of a push into EAX, decrementing the stack pointer
+static void jit_emit_push_address(jit_translation_t* t) {
+    emit_alu_rr(&t->e, ALU_MOV, RAX, JIT_REG_SP);
+    emit_alu_ri(&t->e, ALU_OR, RAX, CPU_STACK_BASE);
+    emit_alu_ri(&t->e, ALU_SUB, JIT_REG_SP, 1);
+    emit_alu_ri(&t->e, ALU_AND, JIT_REG_SP, 0xff);
+}
+
+// Pull a byte from the stack into EAX
+static void jit_emit_pull(jit_translation_t* t) {
+    emit_alu_ri(&t->e, ALU_ADD, JIT_REG_SP, 1);
+    emit_alu_ri(&t->e, ALU_AND, JIT_REG_SP, 0xff);
+    emit_alu_rr(&t->e, ALU_MOV, RAX, JIT_REG_SP);
+    emit_alu_ri(&t->e, ALU_OR, RAX, CPU_STACK_BASE);
+    jit_emit_load(t);
+}
+
+// Load a value into a 6502 register and set flags
+static void jit_emit_load_register(jit_translation_t* t, u8 reg, cpu_address_mode mode, u16 operand) {
+    jit_emit_read_operand(t, mode, operand);
+    emit_alu_rr(&t->e, ALU_MOV, reg, RAX);
+    jit_emit_nz(t, reg);
+}
+
+static void jit_emit_compare(jit_translation_t* t, u8 reg, cpu_address_mode mode, u16 operand) {
+    jit_emit_read_operand(t, mode, operand);
+    emit_alu_rr(&t->e, ALU_MOV, RCX, reg);
+    emit_alu_rr(&t->e, ALU_SUB, RCX, RAX);
+    emit_setcc(&t->e, CC_AE, RDX);
+    emit_movzx_rr8(&t->e, RDX, RDX);
+    jit_emit_carry_reg(t, RDX);
+    emit_movzx_rr8(&t->e, RCX, RCX);
+    jit_emit_nz(t, RCX);
+}
+
+// Decimal ADC/SBC, with the operand in EAX and carry in ECX. Taken only when the decimal flag is set,
+// otherwise jumps to `binary`, which the caller patches along with `done`.
+static void jit_emit_add_decimal(jit_translation_t* t, b8 subtract, u32* binary, u32* done) {
+    jit_emitter_t* e = &t->e;
+    const cpu_decimal_tables_t* tables = t->cpu->ops->variant == CPU_VARIANT_65C02 ? &g_cpu_65c02_decimal_tables : &g_cpu_nmos_decimal_tables;
+
+    emit_test_r8_imm(e, JIT_REG_STATUS, CPU_STATUS_FLAG_DECIMAL_BIT);
+    *binary = emit_jcc(e, CC_E);
+
+    // The 65C02 takes a cycle longer to fix up the result
+    if (t->cpu->ops->variant == CPU_VARIANT_65C02) {
+        jit_emit_add_cycles(t, 1);
+        t->max_cycles++;
+    }
+
+    // Index the table by carry, accumulator and operand
+    emit_shl_ri(e, RCX, 16);
+    emit_alu_rr(e, ALU_MOV, RDX, JIT_REG_A);
+    emit_shl_ri(e, RDX, 8);
+    emit_alu_rr(e, ALU_OR, RCX, RDX);
+    emit_alu_rr(e, ALU_OR, RCX, RAX);
+    emit_mov_ri64(e, RSI, (u64)(size_t)(subtract ? tables->sbc : tables->adc));
+    emit_movzx_r16_table(e, RAX, RSI, RCX);
+    emit_movzx_rr8(e, JIT_REG_A, RAX);
+    emit_shr_ri(e, RAX, 8);
+    emit_alu_ri(e, ALU_AND, JIT_REG_STATUS, ~(u32)(CPU_STATUS_FLAG_NEGATIVE_BIT | CPU_STATUS_FLAG_OVERFLOW_BIT | CPU_STATUS_FLAG_ZERO_BIT | CPU_STATUS_FLAG_CARRY_BIT));
+    emit_alu_rr(e, ALU_OR, JIT_REG_STATUS, RAX);
+    *done = emit_jmp(e);
+}
+
+// ADC and SBC. Decimal mode looks the outcome up in the interpreter's tables, binary mode computes it inline.
+// Variants without decimal mode never test the flag.
+static void jit_emit_add(jit_translation_t* t, b8 subtract, cpu_address_mode mode, u16 operand) {
+    jit_emitter_t* e = &t->e;
+    cpu_variant variant = t->cpu->ops->variant;
+    u32 binary = 0,
+        done = 0;
+
+    jit_emit_read_operand(t, mode, operand);
+    emit_alu_rr(e, ALU_MOV, RCX, JIT_REG_STATUS);
+    emit_alu_ri(e, ALU_AND, RCX, CPU_STATUS_FLAG_CARRY_BIT);
+
+    if (CPU_HAS_DECIMAL_MODE(variant))
+        jit_emit_add_decimal(t, subtract, &binary, &done);
+
+    // Sum into EDX, V into ECX, SBC adds the operand's complement
+    if (CPU_HAS_DECIMAL_MODE(variant))
+        emit_patch_here(e, binary);
+    if (subtract)
+        emit_alu_ri(e, ALU_XOR, RAX, 0xff);
+
+    emit_alu_rr(e, ALU_MOV, RDX, JIT_REG_A);
+    emit_alu_rr(e, ALU_ADD, RDX, RAX);
+    emit_alu_rr(e, ALU_ADD, RDX, RCX);
+    emit_alu_rr(e, ALU_MOV, RCX, JIT_REG_A);
+    emit_alu_rr(e, ALU_XOR, RCX, RAX);
+    emit_alu_ri(e, ALU_XOR, RCX, 0xff);
+    emit_alu_rr(e, ALU_MOV, RSI, JIT_REG_A);
+    emit_alu_rr(e, ALU_XOR, RSI, RDX);
+    emit_alu_rr(e, ALU_AND, RCX, RSI);
+    emit_alu_ri(e, ALU_AND, RCX, 0x80);
+    emit_shr_ri(e, RCX, 1);
+    emit_alu_ri(e, ALU_AND, JIT_REG_STATUS, ~(u32)CPU_STATUS_FLAG_OVERFLOW_BIT);
+    emit_alu_rr(e, ALU_OR, JIT_REG_STATUS, RCX);
+    emit_alu_rr(e, ALU_MOV, RCX, RDX);
+    emit_shr_ri(e, RCX, 8);
+    jit_emit_carry_reg(t, RCX);
+    emit_movzx_rr8(e, JIT_REG_A, RDX);
+    jit_emit_nz(t, JIT_REG_A);
+
+    if (CPU_HAS_DECIMAL_MODE(variant))
+        emit_patch_here(e, done);
+}
+
+static void jit_emit_transfer(jit_translation_t* t, u8 dst, u8 src, b8 flags) {
+    emit_alu_rr(&t->e, ALU_MOV, dst, src);
+    if (flags)
+        jit_emit_nz(t, dst);
+}
+
+// Increment or decrement a 6502 register
+static void jit_emit_step_register(jit_translation_t* t, u8 reg, u32 step) {
+    emit_alu_ri(&t->e, ALU_ADD, reg, step);
+    emit_movzx_rr8(&t->e, reg, reg);
+    jit_emit_nz(t, reg);
+}
+
+// Shifts and rotates, on the accumulator or memory
+static void jit_emit_shift(jit_translation_t* t, cpu_opcode opcode, cpu_address_mode mode, u16 operand, u16 next_pc) {
+    jit_emitter_t* e = &t->e;
+
+    if (mode == CPU_ADDRESS_MODE_ACCUMULATOR) {
+        emit_alu_rr(e, ALU_MOV, RAX, JIT_REG_A);
+    }
+    else {
+        jit_emit_address(t, mode, operand, CPU_SHIFT_PAGE_PENALTY(t->cpu->ops->variant));
+        emit_store_m32(e, RSP, JIT_SCRATCH_1, RAX);
+        jit_emit_load(t);
+    }
+
+    // Carry out into ECX, result into EAX
+    switch (opcode) {
+    case CPU_OPCODE_ASL:
+        emit_alu_rr(e, ALU_MOV, RCX, RAX);
+        emit_shr_ri(e, RCX, 7);
+        emit_shl_ri(e, RAX, 1);
+        emit_movzx_rr8(e, RAX, RAX);
+        break;
+    case CPU_OPCODE_LSR:
+        emit_alu_rr(e, ALU_MOV, RCX, RAX);
+        emit_alu_ri(e, ALU_AND, RCX, 1);
+        emit_shr_ri(e, RAX, 1);
+        break;
+    case CPU_OPCODE_ROL:
+        emit_alu_rr(e, ALU_MOV, RDX, JIT_REG_STATUS);
+        emit_alu_ri(e, ALU_AND, RDX, CPU_STATUS_FLAG_CARRY_BIT);
+        emit_alu_rr(e, ALU_MOV, RCX, RAX);
+        emit_shr_ri(e, RCX, 7);
+        emit_shl_ri(e, RAX, 1);
+        emit_alu_rr(e, ALU_OR, RAX, RDX);
+        emit_movzx_rr8(e, RAX, RAX);
+        break;
+    case CPU_OPCODE_ROR:
+        emit_alu_rr(e, ALU_MOV, RDX, JIT_REG_STATUS);
+        emit_alu_ri(e, ALU_AND, RDX, CPU_STATUS_FLAG_CARRY_BIT);
+        emit_shl_ri(e, RDX, 7);
+        emit_alu_rr(e, ALU_MOV, RCX, RAX);
+        emit_alu_ri(e, ALU_AND, RCX, 1);
+        emit_shr_ri(e, RAX, 1);
+        emit_alu_rr(e, ALU_OR, RAX, RDX);
+        break;
+    default:
+        break;
+    }
+
+    jit_emit_carry_reg(t, RCX);
+    emit_alu_rr(e, ALU_MOV, RDX, RAX);
+    jit_emit_nz(t, RDX);
+
+    if (mode == CPU_ADDRESS_MODE_ACCUMULATOR) {
+        emit_alu_rr(e, ALU_MOV, JIT_REG_A, RDX);
+    }
+    else {
+        emit_alu_rm(e, ALU_MOV, RAX, RSP, JIT_SCRATCH_1);
+        jit_emit_store(t, next_pc);
+    }
+}
+
+// Increment or decrement memory
+static void jit_emit_step_memory(jit_translation_t* t, cpu_address_mode mode, u16 operand, u32 step, u16 next_pc) {
+    jit_emit_address(t, mode, operand, FALSE);
+    emit_store_m32(&t->e, RSP, JIT_SCRATCH_1, RAX);
+    jit_emit_load(t);
+    emit_alu_ri(&t->e, ALU_ADD, RAX, step);
+    emit_movzx_rr8(&t->e, RDX, RAX);
+    jit_emit_nz(t, RDX);
+    emit_alu_rm(&t->e, ALU_MOV, RAX, RSP, JIT_SCRATCH_1);
+    jit_emit_store(t, next_pc);
+}
+
+static void jit_emit_branch(jit_translation_t* t, cpu_status_flags flag, b8 taken_if_set, u16 operand, u16 next_pc) {
+    u16 target = (u16)(next_pc + (i8)operand);
+
+    emit_test_r8_imm(&t->e, JIT_REG_STATUS, flag);
+    u32 not_taken = emit_jcc(&t->e, taken_if_set ? CC_E : CC_NE);
+
+    jit_emit_add_cycles(t, 1 + ((next_pc & 0xff00) != (target & 0xff00)));
+    jit_emit_exit_to(t, target);
+
+    emit_patch_here(&t->e, not_taken);
+    jit_emit_exit_to(t, next_pc);
+
+    t->max_cycles += 2;
+}
+
+// Translates one instruction
+// @returns False if the instruction can't be translated (nothing was emitted)
+static b8 jit_emit_instruction(jit_translation_t* t, cpu_instruction_info_t info, u16 operand, u16 next_pc, b8* terminal) {
+    jit_emitter_t* e = &t->e;
+    cpu_address_mode mode = info.address_mode;
+
+    *terminal = FALSE;
+
+    // Left to the interpreter. Instructions which may enable interrupts must be able to get the run loop's attention.
+    switch (info.opcode) {
+    case CPU_OPCODE_BRK:
+    case CPU_OPCODE_RTI:
+    case CPU_OPCODE_CLI:
+    case CPU_OPCODE_PLP:
+        return FALSE;
+    // 65C02 instructions setting Z alone, and the indexed indirect jump
+    case CPU_OPCODE_TRB:
+    case CPU_OPCODE_TSB:
+        return FALSE;
+    case CPU_OPCODE_BIT:
+        if (mode == CPU_ADDRESS_MODE_IMMEDIATE)
+            return FALSE;
+        break;
+    case CPU_OPCODE_JMP:
+        if (mode == CPU_ADDRESS_MODE_INDIRECT_ABSOLUTE_X)
+            return FALSE;
+        break;
+    default:
+        break;
+    }
+
+    jit_emit_add_cycles(t, info.cycles);
+    t->max_cycles += info.cycles;
+
+    if (mode == CPU_ADDRESS_MODE_ABSOLUTE_X || mode == CPU_ADDRESS_MODE_ABSOLUTE_Y || mode == CPU_ADDRESS_MODE_INDIRECT_Y)
+        t->max_cycles++;
+
+    switch (info.opcode) {
+    case CPU_OPCODE_ADC:
+    case CPU_OPCODE_SBC:
+        jit_emit_add(t, info.opcode == CPU_OPCODE_SBC, mode, operand);
+        break;
+    case CPU_OPCODE_AND:
+    case CPU_OPCODE_ORA:
+    case CPU_OPCODE_EOR:
+        jit_emit_read_operand(t, mode, operand);
+        emit_alu_rr(e, info.opcode == CPU_OPCODE_AND ? ALU_AND : (info.opcode == CPU_OPCODE_ORA ? ALU_OR : ALU_XOR), JIT_REG_A, RAX);
+        jit_emit_nz(t, JIT_REG_A);
+        break;
+    case CPU_OPCODE_ASL:
+    case CPU_OPCODE_LSR:
+    case CPU_OPCODE_ROL:
+    case CPU_OPCODE_ROR:
+        jit_emit_shift(t, info.opcode, mode, operand, next_pc);
+        break;
+    case CPU_OPCODE_BCC:
+        jit_emit_branch(t, CPU_STATUS_FLAG_CARRY_BIT, FALSE, operand, next_pc);
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_BCS:
+        jit_emit_branch(t, CPU_STATUS_FLAG_CARRY_BIT, TRUE, operand, next_pc);
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_BEQ:
+        jit_emit_branch(t, CPU_STATUS_FLAG_ZERO_BIT, TRUE, operand, next_pc);
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_BMI:
+        jit_emit_branch(t, CPU_STATUS_FLAG_NEGATIVE_BIT, TRUE, operand, next_pc);
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_BNE:
+        jit_emit_branch(t, CPU_STATUS_FLAG_ZERO_BIT, FALSE, operand, next_pc);
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_BPL:
+        jit_emit_branch(t, CPU_STATUS_FLAG_NEGATIVE_BIT, FALSE, operand, next_pc);
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_BVC:
+        jit_emit_branch(t, CPU_STATUS_FLAG_OVERFLOW_BIT, FALSE, operand, next_pc);
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_BVS:
+        jit_emit_branch(t, CPU_STATUS_FLAG_OVERFLOW_BIT, TRUE, operand, next_pc);
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_BRA: {
+        u16 target = (u16)(next_pc + (i8)operand);
+        u32 penalty = 1 + ((next_pc & 0xff00) != (target & 0xff00));
+
+        jit_emit_add_cycles(t, penalty);
+        t->max_cycles += penalty;
+        jit_emit_exit_to(t, target);
+
+        *terminal = TRUE;
+        break;
+    }
+    case CPU_OPCODE_BIT:
+        jit_emit_read_operand(t, mode, operand);
+        emit_alu_ri(e, ALU_AND, JIT_REG_STATUS, ~(u32)(CPU_STATUS_FLAG_NEGATIVE_BIT | CPU_STATUS_FLAG_OVERFLOW_BIT | CPU_STATUS_FLAG_ZERO_BIT));
+        emit_alu_rr(e, ALU_MOV, RCX, RAX);
+        emit_alu_ri(e, ALU_AND, RCX, CPU_STATUS_FLAG_NEGATIVE_BIT | CPU_STATUS_FLAG_OVERFLOW_BIT);
+        emit_alu_rr(e, ALU_OR, JIT_REG_STATUS, RCX);
+        emit_alu_rr(e, ALU_TEST, RAX, JIT_REG_A);
+        emit_setcc(e, CC_E, RCX);
+        emit_movzx_rr8(e, RCX, RCX);
+        emit_shl_ri(e, RCX, CPU_STATUS_ZERO_INDEX);
+        emit_alu_rr(e, ALU_OR, JIT_REG_STATUS, RCX);
+        break;
+    case CPU_OPCODE_CLC:
+        emit_alu_ri(e, ALU_AND, JIT_REG_STATUS, ~(u32)CPU_STATUS_FLAG_CARRY_BIT);
+        break;
+    case CPU_OPCODE_CLD:
+        emit_alu_ri(e, ALU_AND, JIT_REG_STATUS, ~(u32)CPU_STATUS_FLAG_DECIMAL_BIT);
+        break;
+    case CPU_OPCODE_CLV:
+        emit_alu_ri(e, ALU_AND, JIT_REG_STATUS, ~(u32)CPU_STATUS_FLAG_OVERFLOW_BIT);
+        break;
+    case CPU_OPCODE_CMP:
+        jit_emit_compare(t, JIT_REG_A, mode, operand);
+        break;
+    case CPU_OPCODE_CPX:
+        jit_emit_compare(t, JIT_REG_X, mode, operand);
+        break;
+    case CPU_OPCODE_CPY:
+        jit_emit_compare(t, JIT_REG_Y, mode, operand);
+        break;
+    case CPU_OPCODE_DEC:
+        if (mode == CPU_ADDRESS_MODE_ACCUMULATOR)
+            jit_emit_step_register(t, JIT_REG_A, 0xffffffff);
+        else
+            jit_emit_step_memory(t, mode, operand, 0xffffffff, next_pc);
+        break;
+    case CPU_OPCODE_DEX:
+        jit_emit_step_register(t, JIT_REG_X, 0xffffffff);
+        break;
+    case CPU_OPCODE_DEY:
+        jit_emit_step_register(t, JIT_REG_Y, 0xffffffff);
+        break;
+    case CPU_OPCODE_INC:
+        if (mode == CPU_ADDRESS_MODE_ACCUMULATOR)
+            jit_emit_step_register(t, JIT_REG_A, 1);
+        else
+            jit_emit_step_memory(t, mode, operand, 1, next_pc);
+        break;
+    case CPU_OPCODE_INX:
+        jit_emit_step_register(t, JIT_REG_X, 1);
+        break;
+    case CPU_OPCODE_INY:
+        jit_emit_step_register(t, JIT_REG_Y, 1);
+        break;
+    case CPU_OPCODE_JMP:
+        if (mode == CPU_ADDRESS_MODE_INDIRECT) {
+            jit_emit_address(t, mode, operand, FALSE);
+            emit_store_m16(e, JIT_REG_CPU, JIT_CPU_FIELD(pc), RAX);
+            jit_emit_exit(t);
+        }
+        else {
+            jit_emit_exit_to(t, operand);
+        }
+
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_JSR:
+        // The pushed return address points at the last byte of the JSR instruction
+        jit_emit_push_address(t);
+        emit_alu_ri(e, ALU_MOV, RDX, (u16)(next_pc - 1) >> 8);
+        jit_emit_store(t, -1);
+        jit_emit_push_address(t);
+        emit_alu_ri(e, ALU_MOV, RDX, (u16)(next_pc - 1) & 0xff);
+        jit_emit_store(t, -1);
+        jit_emit_exit_to(t, operand);
+
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_LDA:
+        jit_emit_load_register(t, JIT_REG_A, mode, operand);
+        break;
+    case CPU_OPCODE_LDX:
+        jit_emit_load_register(t, JIT_REG_X, mode, operand);
+        break;
+    case CPU_OPCODE_LDY:
+        jit_emit_load_register(t, JIT_REG_Y, mode, operand);
+        break;
+    case CPU_OPCODE_PHA:
+    case CPU_OPCODE_PHX:
+    case CPU_OPCODE_PHY:
+        jit_emit_push_address(t);
+        emit_alu_rr(e, ALU_MOV, RDX, info.opcode == CPU_OPCODE_PHA ? JIT_REG_A : (info.opcode == CPU_OPCODE_PHX ? JIT_REG_X : JIT_REG_Y));
+        jit_emit_store(t, next_pc);
+        break;
+    case CPU_OPCODE_PHP:
+        jit_emit_push_address(t);
+        emit_alu_rr(e, ALU_MOV, RDX, JIT_REG_STATUS);
+        emit_alu_ri(e, ALU_OR, RDX, CPU_STATUS_FLAG_BREAK_BIT | CPU_STATUS_FLAG_UNUSED_BIT);
+        jit_emit_store(t, next_pc);
+        break;
+    case CPU_OPCODE_PLA:
+    case CPU_OPCODE_PLX:
+    case CPU_OPCODE_PLY: {
+        u8 reg = info.opcode == CPU_OPCODE_PLA ? JIT_REG_A : (info.opcode == CPU_OPCODE_PLX ? JIT_REG_X : JIT_REG_Y);
+
+        jit_emit_pull(t);
+        emit_alu_rr(e, ALU_MOV, reg, RAX);
+        jit_emit_nz(t, reg);
+        break;
+    }
+    case CPU_OPCODE_RTS:
+        jit_emit_pull(t);
+        emit_store_m32(e, RSP, JIT_SCRATCH_0, RAX);
+        jit_emit_pull(t);
+        emit_shl_ri(e, RAX, 8);
+        emit_alu_rm(e, ALU_OR, RAX, RSP, JIT_SCRATCH_0);
+        emit_alu_ri(e, ALU_ADD, RAX, 1);
+        emit_store_m16(e, JIT_REG_CPU, JIT_CPU_FIELD(pc), RAX);
+        jit_emit_exit(t);
+
+        *terminal = TRUE;
+        break;
+    case CPU_OPCODE_SEC:
+        emit_alu_ri(e, ALU_OR, JIT_REG_STATUS, CPU_STATUS_FLAG_CARRY_BIT);
+        break;
+    case CPU_OPCODE_SED:
+        emit_alu_ri(e, ALU_OR, JIT_REG_STATUS, CPU_STATUS_FLAG_DECIMAL_BIT);
+        break;
+    case CPU_OPCODE_SEI:
+        emit_alu_ri(e, ALU_OR, JIT_REG_STATUS, CPU_STATUS_FLAG_INTERRUPT_DISABLED_BIT);
+        break;
+    case CPU_OPCODE_STA:
+    case CPU_OPCODE_STX:
+    case CPU_OPCODE_STY:
+        jit_emit_address(t, mode, operand, FALSE);
+        emit_alu_rr(e, ALU_MOV, RDX, info.opcode == CPU_OPCODE_STA ? JIT_REG_A : (info.opcode == CPU_OPCODE_STX ? JIT_REG_X : JIT_REG_Y));
+        jit_emit_store(t, next_pc);
+        break;
+    case CPU_OPCODE_STZ:
+        jit_emit_address(t, mode, operand, FALSE);
+        emit_alu_rr(e, ALU_XOR, RDX, RDX);
+        jit_emit_store(t, next_pc);
+        break;
+    case CPU_OPCODE_TAX:
+        jit_emit_transfer(t, JIT_REG_X, JIT_REG_A, TRUE);
+        break;
+    case CPU_OPCODE_TAY:
+        jit_emit_transfer(t, JIT_REG_Y, JIT_REG_A, TRUE);
+        break;
+    case CPU_OPCODE_TSX:
+        jit_emit_transfer(t, JIT_REG_X, JIT_REG_SP, TRUE);
+        break;
+    case CPU_OPCODE_TXA:
+        jit_emit_transfer(t, JIT_REG_A, JIT_REG_X, TRUE);
+        break;
+    case CPU_OPCODE_TXS:
+        jit_emit_transfer(t, JIT_REG_SP, JIT_REG_X, FALSE);
+        break;
+    case CPU_OPCODE_TYA:
+        jit_emit_transfer(t, JIT_REG_A, JIT_REG_Y, TRUE);
+        break;
+    default:
+        // NOP, and unknown opcodes which execute as such
+        break;
+    }
+
+    return TRUE;
+}
+
+static const u8 g_jit_saved_regs[] = { RBX, RBP, R12, R13, R14, R15 };
+
+static void jit_emit_prologue(jit_translation_t* t) {
+    jit_emitter_t* e = &t->e;
+
+    for (u32 i = 0; i < sizeof(g_jit_saved_regs); i++)
+        emit_push(e, g_jit_saved_regs[i]);
+
+    // sub rsp, JIT_FRAME_SIZE (keeps the stack 16-byte aligned for calls)
+    emit8(e, 0x48);
+    emit8(e, 0x83);
+    emit8(e, 0xec);
+    emit8(e, JIT_FRAME_SIZE);
+
+    emit_mov_rr64(e, JIT_REG_CPU, RDI);
+
+    emit_alu_ri(e, ALU_MOV, RAX, 0);
+    emit_store_m32(e, RSP, JIT_SCRATCH_EXIT, RAX);
+
+    emit_movzx_rm8(e, JIT_REG_A, JIT_REG_CPU, NO_REG, JIT_CPU_FIELD(a));
+    emit_movzx_rm8(e, JIT_REG_X, JIT_REG_CPU, NO_REG, JIT_CPU_FIELD(x));
+    emit_movzx_rm8(e, JIT_REG_Y, JIT_REG_CPU, NO_REG, JIT_CPU_FIELD(y));
+    emit_movzx_rm8(e, JIT_REG_SP, JIT_REG_CPU, NO_REG, JIT_CPU_FIELD(sp));
+    emit_movzx_rm8(e, JIT_REG_STATUS, JIT_REG_CPU, NO_REG, JIT_CPU_FIELD(status));
+}
+
+static void jit_emit_epilogue(jit_translation_t* t) {
+    jit_emitter_t* e = &t->e;
+
+    for (u32 i = 0; i < t->num_exits; i++)
+        emit_patch_here(e, t->exits[i]);
+
+    emit_store_m8(e, JIT_REG_CPU, NO_REG, JIT_CPU_FIELD(a), JIT_REG_A);
+    emit_store_m8(e, JIT_REG_CPU, NO_REG, JIT_CPU_FIELD(x), JIT_REG_X);
+    emit_store_m8(e, JIT_REG_CPU, NO_REG, JIT_CPU_FIELD(y), JIT_REG_Y);
+    emit_store_m8(e, JIT_REG_CPU, NO_REG, JIT_CPU_FIELD(sp), JIT_REG_SP);
+    emit_store_m8(e, JIT_REG_CPU, NO_REG, JIT_CPU_FIELD(status), JIT_REG_STATUS);
+
+    // add rsp, JIT_FRAME_SIZE
+    emit8(e, 0x48);
+    emit8(e, 0x83);
+    emit8(e, 0xc4);
+    emit8(e, JIT_FRAME_SIZE);
+
+    for (u32 i = sizeof(g_jit_saved_regs); i > 0; i--)
+        emit_pop(e, g_jit_saved_regs[i - 1]);
+
+    emit8(e, 0xc3);
+}
+
+// Translates the basic block starting at `pc`. Blocks never leave the page they start in.
+// @returns The new block, or NULL if not even the first instruction could be translated
+static jit_block_t* jit_translate(jit_t* jit, u16 pc) {
+    if (jit->num_blocks >= JIT_MAX_BLOCKS || JIT_CODE_SIZE - jit->code_used < JIT_MAX_BLOCK_CODE)
+        jit_flush(jit);
+
+    cpu_t* cpu = jit->cpu;
+    const u8* memory = cpu->load_pages[pc >> BUS_PAGE_BITS];
+    u32 offset = pc & BUS_PAGE_MASK;
+
+    jit_translation_t t;
+    memset(&t, 0, sizeof(t));
+    t.e.code = jit->code + jit->code_used;
+    t.e.capacity = JIT_MAX_BLOCK_CODE;
+    t.cpu = cpu;
+
+    jit_emit_prologue(&t);
+
+    u32 num_instructions = 0;
+    b8 terminal = FALSE;
+
+    while (!terminal && num_instructions < JIT_MAX_BLOCK_INSTRUCTIONS) {
+        cpu_instruction_info_t info = cpu->ops->info[memory[offset]];
+        u32 length = CPU_INSTRUCTION_LENGTH(info.size);
+
+        if (offset + length > BUS_PAGE_SIZE)
+            break;
+
+        u16 operand = 0;
+        if (info.size == 2)
+            operand = memory[offset + 1];
+        else if (info.size == 3)
+            operand = (u16)(memory[offset + 1] | (memory[offset + 2] << 8));
+
+        u16 next_pc = (u16)((pc & ~BUS_PAGE_MASK) + offset + length);
+        t.loaded = FALSE;
+        if (!jit_emit_instruction(&t, info, operand, next_pc, &terminal))
+            break;
+
+        if (t.loaded && !terminal)
+            jit_emit_load_exit(&t, next_pc);
+
+        offset += length;
+        num_instructions++;
+    }
+
+    if (num_instructions == 0)
+        return NULL;
+
+    if (!terminal)
+        jit_emit_exit_to(&t, (u16)((pc & ~BUS_PAGE_MASK) + offset));
+
+    jit_emit_epilogue(&t);
+
+    if (t.e.overflow)
+        return NULL;
+
+    jit_block_t* block = &jit->blocks[jit->num_blocks++];
+    block->code = (void (*)(cpu_t*))(void*)t.e.code;
+    block->max_cycles = t.max_cycles;
+
+    jit->code_used += (t.e.size + 15) & ~15u;
+
+    // Stores to the page must now invalidate the block
+    bus_mark_code_page(cpu->bus, pc >> BUS_PAGE_BITS);
+
+    return block;
+}
+
+
+b8 jit_supported() {
+    return TRUE;
+}
+
+jit_t* jit_create(cpu_t* cpu) {
+    void* code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED)
+        return NULL;
+
+    jit_t* jit = (jit_t*)calloc(1, sizeof(jit_t));
+    jit->cpu = cpu;
+    jit->code = (u8*)code;
+    jit->blocks = (jit_block_t*)calloc(JIT_MAX_BLOCKS, sizeof(jit_block_t));
+
+    return jit;
+}
+
+void jit_free(jit_t* jit) {
+    for (u32 i = 0; i < BUS_PAGE_COUNT; i++)
+        free(jit->pages[i]);
+
+    munmap(jit->code, JIT_CODE_SIZE);
+    free(jit->blocks);
+    free(jit);
+}
+
+jit_block_t* jit_lookup(jit_t* jit, u16 pc) {
+    u32 page = pc >> BUS_PAGE_BITS;
+    u32 offset = pc & BUS_PAGE_MASK;
+
+    jit_page_t* jit_page = jit->pages[page];
+    if (jit_page == NULL) {
+        // Only code in direct host memory is translated
+        if (jit->cpu->load_pages[page] == NULL)
+            return NULL;
+
+        jit_page = (jit_page_t*)calloc(1, sizeof(jit_page_t));
+        jit->pages[page] = jit_page;
+    }
+
+    jit_block_t* block = jit_page->blocks[offset];
+    if (block)
+        return (block == &g_jit_untranslatable) ? NULL : block;
+
+    // Pages with breakpoints are interpreted, so execution stops at them
+    if (++jit_page->counters[offset] < JIT_HOT_THRESHOLD || jit->cpu->load_pages[page] == NULL || jit->cpu->breakpoint_counts[page])
+        return NULL;
+
+    block = jit_translate(jit, pc);
+
+    // Translation may have flushed every page
+    jit_page = jit->pages[page];
+    if (jit_page == NULL) {
+        jit_page = (jit_page_t*)calloc(1, sizeof(jit_page_t));
+        jit->pages[page] = jit_page;
+    }
+
+    jit_page->blocks[offset] = block ? block : &g_jit_untranslatable;
+    return block;
+}
+
+void jit_invalidate_page(jit_t* jit, u32 page) {
+    jit_page_t* jit_page = jit->pages[page];
+    if (jit_page == NULL)
+        return;
+
+    memset(jit_page, 0, sizeof(jit_page_t));
+    jit->exit_requested = TRUE;
+}
+
+void jit_flush(jit_t* jit) {
+    for (u32 i = 0; i < BUS_PAGE_COUNT; i++) {
+        free(jit->pages[i]);
+        jit->pages[i] = NULL;
+    }
+
+    jit->code_used = 0;
+    jit->num_blocks = 0;
+}
+
+#else
+
+b8 jit_supported() {
+    return FALSE;
+}
+
+jit_t* jit_create(cpu_t* cpu) {
+    return NULL;
+}
+
+void jit_free(jit_t* jit) {
+}
+
+jit_block_t* jit_lookup(jit_t* jit, u16 pc) {
+    return NULL;
+}
+
+void jit_invalidate_page(jit_t* jit, u32 page) {
+}
+
+void jit_flush(jit_t* jit) {
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include "s6502/lib/interval_map.h"
+
+#include <assert.h>
+
+struct interval_map_s {
+    interval_t* intervals;  // Sorted by `begin`
+    u32 count;
+    u32 capacity;
+};
+
+// @returns Index of the first interval ending at or after a key, `map->count` if there's none
+static u32 interval_map_lower_bound(interval_map_t* map, u32 key) {
+    u32 low = 0,
+        high = map->count;
+
+    // Ends are sorted just like the beginnings, as the intervals are disjoint
+    while (low < high) {
+        u32 mid = low + (high - low) / 2;
+
+        if (map->intervals[mid].end < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+interval_map_t* interval_map_create() {
+    return (interval_map_t*)calloc(1, sizeof(interval_map_t));
+}
+
+void interval_map_free(interval_map_t* map) {
+    free(map->intervals);
+    free(map);
+}
+
+b8 interval_map_insert(interval_map_t* map, u32 begin, u32 end, void* data) {
+    assert(end >= begin);
+
+    // Immediately reject any (closed) interval overlap. Only the first interval ending at or after `begin` can overlap.
+    u32 index = interval_map_lower_bound(map, begin);
+    if (index < map->count && map->intervals[index].begin <= end)
+        return FALSE;
+
+    if (map->count == map->capacity) {
+        map->capacity = map->capacity ? map->capacity * 2 : 16;
+        map->intervals = (interval_t*)realloc(map->intervals, map->capacity * sizeof(interval_t));
+    }
+
+    memmove(&map->intervals[index + 1], &map->intervals[index], (map->count - index) * sizeof(interval_t));
+    map->intervals[index].begin = begin;
+    map->intervals[index].end = end;
+    map->intervals[index].data = data;
+    map->count++;
+
+    return TRUE;
+}
+
+const interval_t* interval_map_search(interval_map_t* map, u32 key) {
+    u32 index = interval_map_lower_bound(map, key);
+
+    if (index < map->count && map->intervals[index].begin <= key)
+        return &map->intervals[index];
+
+    return NULL;
+}
+
+u32 interval_map_query(interval_map_t* map, u32 begin, u32 end, u32* first) {
+    u32 index = interval_map_lower_bound(map, begin);
+    u32 last = index;
+
+    while (last < map->count && map->intervals[last].begin <= end)
+        last++;
+
+    *first = index;
+    return last - index;
+}
+
+u32 interval_map_get_count(interval_map_t* map) {
+    return map->count;
+}
+
+const interval_t* interval_map_get_intervals(interval_map_t* map) {
+    return map->intervals;
+}
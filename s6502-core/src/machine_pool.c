@@ -0,0 +1,455 @@
+#if defined(__linux__)
+    #define _GNU_SOURCE     // pthread_setaffinity_np
+#endif
+
+#include "s6502/machine_pool.h"
+
+// Worker threads need POSIX threads. Without them, the calling thread runs every machine by itself.
+#if defined(S6502_THREADS)
+    #define MACHINE_POOL_THREADS 1
+#else
+    #define MACHINE_POOL_THREADS 0
+#endif
+
+#if MACHINE_POOL_THREADS
+    #include <pthread.h>
+    #include <sched.h>
+    #include <unistd.h>
+#endif
+
+#define MACHINE_POOL_DEFAULT_QUANTUM 20000
+#define MACHINE_POOL_CACHE_LINE 64
+
+#if MACHINE_POOL_THREADS
+    typedef pthread_mutex_t machine_pool_lock_t;
+    typedef pthread_cond_t machine_pool_cond_t;
+
+    #define MACHINE_POOL_LOCK_INIT(lock) pthread_mutex_init(lock, NULL)
+    #define MACHINE_POOL_LOCK_DESTROY(lock) pthread_mutex_destroy(lock)
+    #define MACHINE_POOL_LOCK(lock) pthread_mutex_lock(lock)
+    #define MACHINE_POOL_UNLOCK(lock) pthread_mutex_unlock(lock)
+
+    #define MACHINE_POOL_COND_INIT(cond) pthread_cond_init(cond, NULL)
+    #define MACHINE_POOL_COND_DESTROY(cond) pthread_cond_destroy(cond)
+    #define MACHINE_POOL_COND_WAIT(cond, lock) pthread_cond_wait(cond, lock)
+    #define MACHINE_POOL_COND_SIGNAL(cond) pthread_cond_signal(cond)
+    #define MACHINE_POOL_COND_BROADCAST(cond) pthread_cond_broadcast(cond)
+
+    // Sequentially consistent, so a worker going idle and a worker queueing a machine can't miss each other
+    #define MACHINE_POOL_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+    #define MACHINE_POOL_STORE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST)
+    #define MACHINE_POOL_ADD(ptr, value) __atomic_add_fetch(ptr, value, __ATOMIC_SEQ_CST)
+#else
+    typedef u8 machine_pool_lock_t;
+    typedef u8 machine_pool_cond_t;
+
+    #define MACHINE_POOL_LOCK_INIT(lock) ((void)(lock))
+    #define MACHINE_POOL_LOCK_DESTROY(lock) ((void)(lock))
+    #define MACHINE_POOL_LOCK(lock) ((void)(lock))
+    #define MACHINE_POOL_UNLOCK(lock) ((void)(lock))
+
+    #define MACHINE_POOL_COND_INIT(cond) ((void)(cond))
+    #define MACHINE_POOL_COND_DESTROY(cond) ((void)(cond))
+    #define MACHINE_POOL_COND_WAIT(cond, lock) ((void)(cond), (void)(lock))
+    #define MACHINE_POOL_COND_SIGNAL(cond) ((void)(cond))
+    #define MACHINE_POOL_COND_BROADCAST(cond) ((void)(cond))
+
+    #define MACHINE_POOL_LOAD(ptr) (*(ptr))
+    #define MACHINE_POOL_STORE(ptr, value) (*(ptr) = (value))
+    #define MACHINE_POOL_ADD(ptr, value) (*(ptr) += (value))
+#endif
+
+typedef struct machine_pool_machine_s {
+    cpu_t* cpu;
+    bus_t* bus;
+    u64 cycles;     // Remaining cycle budget
+    machine_pool_on_done_fn on_done;
+    machine_pool_on_start_fn on_start;
+    void* user;
+} machine_pool_machine_t;
+
+// Queue of machine indices owned by one worker. The owner round-robins from the front,
+// thieves take from the back.
+typedef struct machine_pool_queue_s {
+    machine_pool_lock_t lock;
+    u32* machines;      // Ring buffer with room for every machine of the pool
+    u32 head;
+    u32 count;          // Written under the lock, read without it to skip empty queues
+    u32 capacity;
+} machine_pool_queue_t;
+
+// Worker state, padded so neighbouring workers' queues don't share cache lines
+typedef struct machine_pool_worker_s {
+    machine_pool_t* pool;
+    u32 index;
+    machine_pool_queue_t queue;
+    machine_pool_stats_t stats;
+    u8 padding[MACHINE_POOL_CACHE_LINE];
+} machine_pool_worker_t;
+
+struct machine_pool_s {
+    machine_pool_config_t config;
+
+    machine_pool_machine_t* machines;
+    u32 num_machines;
+    u32 machines_capacity;
+
+    machine_pool_worker_t* workers;
+    u32 num_threads;
+
+    // Idle workers wait on the condition for a queue to hold more than its owner is about to take,
+    // or for the run to end
+    machine_pool_lock_t lock;
+    machine_pool_cond_t idle;
+    u32 num_idle;
+    u32 remaining;      // Machines still running in the current `machine_pool_run`
+
+    machine_pool_stats_t stats;
+};
+
+
+// Queues
+
+static void machine_pool_queue_reset(machine_pool_queue_t* queue, u32 capacity) {
+    if (queue->capacity < capacity) {
+        free(queue->machines);
+        queue->machines = (u32*)malloc(capacity * sizeof(u32));
+        queue->capacity = capacity;
+    }
+
+    queue->head = 0;
+    queue->count = 0;
+}
+
+// @returns Number of machines in the queue after the push
+static u32 machine_pool_queue_push(machine_pool_queue_t* queue, u32 machine) {
+    MACHINE_POOL_LOCK(&queue->lock);
+    queue->machines[(queue->head + queue->count) % queue->capacity] = machine;
+    u32 count = queue->count + 1;
+    MACHINE_POOL_STORE(&queue->count, count);
+    MACHINE_POOL_UNLOCK(&queue->lock);
+
+    return count;
+}
+
+static b8 machine_pool_queue_pop_front(machine_pool_queue_t* queue, u32* machine) {
+    b8 result = FALSE;
+
+    MACHINE_POOL_LOCK(&queue->lock);
+    if (queue->count) {
+        *machine = queue->machines[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        MACHINE_POOL_STORE(&queue->count, queue->count - 1);
+        result = TRUE;
+    }
+    MACHINE_POOL_UNLOCK(&queue->lock);
+
+    return result;
+}
+
+static b8 machine_pool_queue_pop_back(machine_pool_queue_t* queue, u32* machine) {
+    b8 result = FALSE;
+
+    MACHINE_POOL_LOCK(&queue->lock);
+    if (queue->count) {
+        MACHINE_POOL_STORE(&queue->count, queue->count - 1);
+        *machine = queue->machines[(queue->head + queue->count) % queue->capacity];
+        result = TRUE;
+    }
+    MACHINE_POOL_UNLOCK(&queue->lock);
+
+    return result;
+}
+
+
+// Workers
+
+// Take a machine from another worker, trying each once starting with the next one.
+// Empty queues are skipped without taking their lock.
+static b8 machine_pool_steal(machine_pool_t* pool, u32 thief, u32* machine) {
+    for (u32 i = 1; i < pool->num_threads; i++) {
+        machine_pool_worker_t* victim = &pool->workers[(thief + i) % pool->num_threads];
+        if (MACHINE_POOL_LOAD(&victim->queue.count) && machine_pool_queue_pop_back(&victim->queue, machine))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+// @returns True if a queue holds a machine to steal besides the one its owner takes next
+static b8 machine_pool_has_spare(machine_pool_t* pool) {
+    for (u32 i = 0; i < pool->num_threads; i++) {
+        if (MACHINE_POOL_LOAD(&pool->workers[i].queue.count) > 1)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+// Wait until there may be a machine to steal, or the run has ended
+static void machine_pool_park(machine_pool_t* pool) {
+    MACHINE_POOL_LOCK(&pool->lock);
+    MACHINE_POOL_ADD(&pool->num_idle, 1);
+
+    // Queues are checked again after announcing the wait, as `machine_pool_requeue` checks for idle workers
+    // after queueing: one of the two sees the other
+    if (MACHINE_POOL_LOAD(&pool->remaining) && !machine_pool_has_spare(pool))
+        MACHINE_POOL_COND_WAIT(&pool->idle, &pool->lock);
+
+    MACHINE_POOL_ADD(&pool->num_idle, (u32)-1);
+    MACHINE_POOL_UNLOCK(&pool->lock);
+}
+
+// Put a machine back in a worker's queue, waking an idle worker if the owner now has one to spare
+static void machine_pool_requeue(machine_pool_t* pool, machine_pool_worker_t* worker, u32 index) {
+    if (machine_pool_queue_push(&worker->queue, index) > 1 && MACHINE_POOL_LOAD(&pool->num_idle)) {
+        MACHINE_POOL_LOCK(&pool->lock);
+        MACHINE_POOL_COND_SIGNAL(&pool->idle);
+        MACHINE_POOL_UNLOCK(&pool->lock);
+    }
+}
+
+// Count a machine as finished, waking every idle worker once none are left
+static void machine_pool_finish(machine_pool_t* pool) {
+    if (MACHINE_POOL_ADD(&pool->remaining, (u32)-1) == 0) {
+        MACHINE_POOL_LOCK(&pool->lock);
+        MACHINE_POOL_COND_BROADCAST(&pool->idle);
+        MACHINE_POOL_UNLOCK(&pool->lock);
+    }
+}
+
+#if defined(__linux__) && MACHINE_POOL_THREADS
+    #define MACHINE_POOL_PINNING 1
+#else
+    #define MACHINE_POOL_PINNING 0
+#endif
+
+static void machine_pool_pin(u32 index) {
+#if MACHINE_POOL_PINNING
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_cores <= 0)
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % (u32)num_cores, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)index;
+#endif
+}
+
+static void* machine_pool_worker(void* arg) {
+    machine_pool_worker_t* worker = (machine_pool_worker_t*)arg;
+    machine_pool_t* pool = worker->pool;
+
+    if (pool->config.pin_threads)
+        machine_pool_pin(worker->index);
+
+    for (;;) {
+        u32 index = 0;
+
+        if (!machine_pool_queue_pop_front(&worker->queue, &index)) {
+            if (!machine_pool_steal(pool, worker->index, &index)) {
+                // Machines still running elsewhere are requeued there, so keep looking until all are done
+                if (MACHINE_POOL_LOAD(&pool->remaining) == 0)
+                    break;
+
+                machine_pool_park(pool);
+                continue;
+            }
+
+            worker->stats.steals++;
+        }
+
+        machine_pool_machine_t* machine = &pool->machines[index];
+        u64 quantum = machine->cycles < pool->config.quantum_cycles ? machine->cycles : pool->config.quantum_cycles;
+
+        // Breakpoints and watchpoints stop the quantum short, so charge what actually ran
+        if (machine->on_start)
+            machine->on_start(machine->user, machine->cpu);
+
+        u64 start = 0,
+            end = 0;
+        cpu_get_state(machine->cpu, NULL, NULL, NULL, NULL, NULL, NULL, &start);
+        cpu_run(machine->cpu, quantum);
+        cpu_get_state(machine->cpu, NULL, NULL, NULL, NULL, NULL, NULL, &end);
+
+        cpu_stop_t stop;
+        cpu_get_stop(machine->cpu, &stop);
+
+        u64 spent = end - start;
+        machine->cycles = stop.reason == CPU_STOP_NONE && spent < machine->cycles ? machine->cycles - spent : 0;
+        worker->stats.quanta++;
+
+        if (machine->cycles) {
+            machine_pool_requeue(pool, worker, index);
+            continue;
+        }
+
+        if (machine->on_done) {
+            machine->cycles = machine->on_done(machine->user, machine->cpu);
+
+            if (machine->cycles) {
+                machine_pool_requeue(pool, worker, index);
+                continue;
+            }
+        }
+
+        machine_pool_finish(pool);
+    }
+
+    return NULL;
+}
+
+
+machine_pool_t* machine_pool_create(const machine_pool_config_t* config) {
+    machine_pool_t* pool = (machine_pool_t*)calloc(1, sizeof(machine_pool_t));
+
+    if (config)
+        pool->config = *config;
+
+    if (pool->config.quantum_cycles == 0)
+        pool->config.quantum_cycles = MACHINE_POOL_DEFAULT_QUANTUM;
+
+#if MACHINE_POOL_THREADS
+    pool->num_threads = pool->config.num_threads;
+    if (pool->num_threads == 0) {
+        long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+        pool->num_threads = num_cores > 0 ? (u32)num_cores : 1;
+    }
+#else
+    pool->num_threads = 1;
+#endif
+
+    pool->workers = (machine_pool_worker_t*)calloc(pool->num_threads, sizeof(machine_pool_worker_t));
+    for (u32 i = 0; i < pool->num_threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        MACHINE_POOL_LOCK_INIT(&pool->workers[i].queue.lock);
+    }
+
+    MACHINE_POOL_LOCK_INIT(&pool->lock);
+    MACHINE_POOL_COND_INIT(&pool->idle);
+
+    return pool;
+}
+
+void machine_pool_free(machine_pool_t* pool) {
+    for (u32 i = 0; i < pool->num_machines; i++) {
+        cpu_free(pool->machines[i].cpu);
+        bus_free(pool->machines[i].bus);
+    }
+
+    for (u32 i = 0; i < pool->num_threads; i++) {
+        MACHINE_POOL_LOCK_DESTROY(&pool->workers[i].queue.lock);
+        free(pool->workers[i].queue.machines);
+    }
+
+    MACHINE_POOL_COND_DESTROY(&pool->idle);
+    MACHINE_POOL_LOCK_DESTROY(&pool->lock);
+
+    free(pool->workers);
+    free(pool->machines);
+    free(pool);
+}
+
+u32 machine_pool_add(machine_pool_t* pool, cpu_t* cpu, bus_t* bus, u64 cycles, machine_pool_on_done_fn on_done, void* user) {
+    assert(cpu != NULL && bus != NULL);
+
+    if (pool->num_machines == pool->machines_capacity) {
+        pool->machines_capacity = pool->machines_capacity ? pool->machines_capacity * 2 : 16;
+        pool->machines = (machine_pool_machine_t*)realloc(pool->machines, pool->machines_capacity * sizeof(machine_pool_machine_t));
+    }
+
+    machine_pool_machine_t* machine = &pool->machines[pool->num_machines];
+    machine->cpu = cpu;
+    machine->bus = bus;
+    machine->cycles = cycles;
+    machine->on_done = on_done;
+    machine->on_start = NULL;
+    machine->user = user;
+
+    return pool->num_machines++;
+}
+
+void machine_pool_set_cycles(machine_pool_t* pool, u32 machine, u64 cycles) {
+    assert(machine < pool->num_machines);
+    pool->machines[machine].cycles = cycles;
+}
+
+void machine_pool_set_start_callback(machine_pool_t* pool, u32 machine, machine_pool_on_start_fn on_start) {
+    assert(machine < pool->num_machines);
+    pool->machines[machine].on_start = on_start;
+}
+
+void machine_pool_run(machine_pool_t* pool) {
+    // Deal the machines out round-robin
+    for (u32 i = 0; i < pool->num_threads; i++)
+        machine_pool_queue_reset(&pool->workers[i].queue, pool->num_machines);
+
+    pool->remaining = 0;
+    for (u32 i = 0; i < pool->num_machines; i++) {
+        if (pool->machines[i].cycles == 0)
+            continue;
+
+        machine_pool_queue_push(&pool->workers[pool->remaining % pool->num_threads].queue, i);
+        pool->remaining++;
+    }
+
+#if MACHINE_POOL_THREADS
+    // Queues of workers whose thread couldn't be started get stolen by the others
+    pthread_t* threads = (pthread_t*)calloc(pool->num_threads, sizeof(pthread_t));
+    b8* started = (b8*)calloc(pool->num_threads, sizeof(b8));
+
+    for (u32 i = 1; i < pool->num_threads; i++)
+        started[i] = pthread_create(&threads[i], NULL, machine_pool_worker, &pool->workers[i]) == 0;
+#endif
+
+#if MACHINE_POOL_PINNING
+    // The calling thread gets pinned as worker 0 for the duration of the run only
+    cpu_set_t affinity;
+    b8 restore_affinity = pool->config.pin_threads 
+        && pthread_getaffinity_np(pthread_self(), sizeof(affinity), &affinity) == 0;
+#endif
+
+    machine_pool_worker(&pool->workers[0]);
+
+#if MACHINE_POOL_PINNING
+    if (restore_affinity)
+        pthread_setaffinity_np(pthread_self(), sizeof(affinity), &affinity);
+#endif
+
+#if MACHINE_POOL_THREADS
+    for (u32 i = 1; i < pool->num_threads; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+    }
+
+    free(started);
+    free(threads);
+#endif
+
+    for (u32 i = 0; i < pool->num_threads; i++) {
+        pool->stats.quanta += pool->workers[i].stats.quanta;
+        pool->stats.steals += pool->workers[i].stats.steals;
+        memset(&pool->workers[i].stats, 0, sizeof(machine_pool_stats_t));
+    }
+}
+
+cpu_t* machine_pool_get_cpu(machine_pool_t* pool, u32 machine) {
+    assert(machine < pool->num_machines);
+    return pool->machines[machine].cpu;
+}
+
+u32 machine_pool_get_num_machines(machine_pool_t* pool) {
+    return pool->num_machines;
+}
+
+u32 machine_pool_get_num_threads(machine_pool_t* pool) {
+    return pool->num_threads;
+}
+
+void machine_pool_get_stats(machine_pool_t* pool, machine_pool_stats_t* stats) {
+    *stats = pool->stats;
+}
@@ -0,0 +1,206 @@
+#include "s6502/pci.h"
+
+#include <stdio.h>
+
+// ROM image files are memory-mapped and shared on POSIX hosts, and read into a buffer of their own elsewhere
+#if defined(__unix__) || defined(__APPLE__)
+    #define PCI_IMAGE_MAPPED 1
+#else
+    #define PCI_IMAGE_MAPPED 0
+#endif
+
+// Machines may be set up from several threads, but only where there are POSIX threads to run them
+#if PCI_IMAGE_MAPPED && defined(S6502_THREADS)
+    #define PCI_IMAGES_THREADS 1
+#else
+    #define PCI_IMAGES_THREADS 0
+#endif
+
+#define PCI_IMAGE_MAX_SIZE 0x10000
+
+#if PCI_IMAGE_MAPPED
+
+#if PCI_IMAGES_THREADS
+    #include <pthread.h>
+
+    #define PCI_IMAGES_LOCK() pthread_mutex_lock(&g_pci_images_lock)
+    #define PCI_IMAGES_UNLOCK() pthread_mutex_unlock(&g_pci_images_lock)
+#else
+    #define PCI_IMAGES_LOCK() ((void)0)
+    #define PCI_IMAGES_UNLOCK() ((void)0)
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only file mapping, shared by every ROM PCI unit created from the same file
+struct pci_image_s {
+    u8* memory;
+    u32 size;
+    u32 refs;       // PCI units using the image
+
+    dev_t device;   // Identifies the file regardless of the path it was opened by
+    ino_t inode;
+    pci_image_t* next;
+};
+
+// Mapped images, guarded by the lock as machines may be set up from several threads
+#if PCI_IMAGES_THREADS
+static pthread_mutex_t g_pci_images_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static pci_image_t* g_pci_images;
+
+// Find the mapping of a file, or map it
+// @returns Image with a reference taken, NULL if the file can't be mapped
+static pci_image_t* pci_image_acquire(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > PCI_IMAGE_MAX_SIZE) {
+        close(fd);
+        return NULL;
+    }
+
+    PCI_IMAGES_LOCK();
+
+    pci_image_t* image = g_pci_images;
+    while (image && (image->device != st.st_dev || image->inode != st.st_ino))
+        image = image->next;
+
+    if (image == NULL) {
+        void* memory = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (memory != MAP_FAILED) {
+            image = (pci_image_t*)calloc(1, sizeof(pci_image_t));
+            image->memory = (u8*)memory;
+            image->size = (u32)st.st_size;
+            image->device = st.st_dev;
+            image->inode = st.st_ino;
+            image->next = g_pci_images;
+            g_pci_images = image;
+        }
+    }
+
+    if (image)
+        image->refs++;
+
+    PCI_IMAGES_UNLOCK();
+    close(fd);
+
+    return image;
+}
+
+static void pci_image_release(pci_image_t* image) {
+    PCI_IMAGES_LOCK();
+
+    if (--image->refs == 0) {
+        pci_image_t** link = &g_pci_images;
+        while (*link != image)
+            link = &(*link)->next;
+
+        *link = image->next;
+        munmap(image->memory, image->size);
+        free(image);
+    }
+
+    PCI_IMAGES_UNLOCK();
+}
+
+static pci_t* pci_create_image(const char* name, pci_image_t* image) {
+    pci_t* pci = (pci_t*)calloc(1, sizeof(pci_t));
+    pci->name = name;
+    pci->kind = PCI_KIND_MEMORY;
+    pci->memory = image->memory;
+    pci->memory_size = image->size;
+    pci->read_only = TRUE;
+    pci->image = image;
+
+    return pci;
+}
+
+#else
+
+// Read a whole image file into a ROM PCI unit of its own
+// @returns New PCI unit instance, NULL if the file can't be read
+static pci_t* pci_read_image(const char* name, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    // Read one byte more than the largest image, to tell files that are too large
+    u8* buffer = (u8*)malloc(PCI_IMAGE_MAX_SIZE + 1);
+    size_t size = fread(buffer, 1, PCI_IMAGE_MAX_SIZE + 1, file);
+    fclose(file);
+
+    pci_t* pci = NULL;
+    if (size > 0 && size <= PCI_IMAGE_MAX_SIZE) {
+        pci = pci_create_memory(name, (u32)size, TRUE);
+        memcpy(pci->memory, buffer, size);
+    }
+
+    free(buffer);
+    return pci;
+}
+
+#endif
+
+
+pci_t* pci_create_memory(const char* name, u32 size, b8 read_only) {
+    assert(size > 0);
+
+    pci_t* pci = (pci_t*)calloc(1, sizeof(pci_t));
+    pci->name = name;
+    pci->kind = PCI_KIND_MEMORY;
+    pci->memory = (u8*)calloc(size, sizeof(u8));
+    pci->memory_size = size;
+    pci->read_only = read_only;
+
+    return pci;
+}
+
+pci_t* pci_create_rom_file(const char* name, const char* path) {
+#if PCI_IMAGE_MAPPED
+    pci_image_t* image = pci_image_acquire(path);
+    if (image == NULL)
+        return NULL;
+
+    return pci_create_image(name, image);
+#else
+    return pci_read_image(name, path);
+#endif
+}
+
+pci_t* pci_create_rom_shared(const char* name, pci_t* rom) {
+#if PCI_IMAGE_MAPPED
+    assert(rom->image != NULL);
+
+    PCI_IMAGES_LOCK();
+    rom->image->refs++;
+    PCI_IMAGES_UNLOCK();
+
+    return pci_create_image(name, rom->image);
+#else
+    pci_t* pci = pci_create_memory(name, rom->memory_size, TRUE);
+    memcpy(pci->memory, rom->memory, rom->memory_size);
+    return pci;
+#endif
+}
+
+void pci_free(pci_t* pci) {
+#if PCI_IMAGE_MAPPED
+    if (pci->image) {
+        pci_image_release(pci->image);
+        free(pci);
+        return;
+    }
+#endif
+
+    if (pci->kind == PCI_KIND_MEMORY)
+        free(pci->memory);
+
+    free(pci);
+}
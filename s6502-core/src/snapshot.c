@@ -0,0 +1,248 @@
+#include "s6502/snapshot.h"
+#include "cpu_internal.h"
+
+// Saved PCI unit
+// Nothing refers to the snapshotted machine's PCI units, so forks don't need that machine.
+typedef struct snapshot_pci_s {
+    const char* name;
+    u16 addr_start;
+    u16 addr_end;
+    u32 mirror_size;        // See `bus_attach_pci_mirrored`
+    u32 bank_offset;        // Memory PCI units, see `bus_switch_bank`
+    u32 memory_size;        // Memory PCI units
+    b8 read_only;
+    pci_t* rom;             // ROM images: PCI unit sharing the image (taking a reference on it), for forks
+
+    u8* contents;           // Memory PCI units: contents of the whole backing buffer, immutable once taken.
+                            // Not taken for ROM images, they can't change.
+    void* state;            // Device PCI units: state written by `on_save`
+    u32 state_size;
+} snapshot_pci_t;
+
+struct snapshot_s {
+    u8 a, x, y, sp, status;
+    u16 pc;
+    u64 cycles;
+    cpu_config_t config;    // CPU the snapshot was taken of, for forks
+
+    bus_t* bus;             // Bus of the snapshotted machine
+    u32 dirty_generation;   // Its dirty page tracking generation, while it's this snapshot's
+
+    snapshot_pci_t* pci;
+    u32 num_pci;
+};
+
+// The mapped range is processed in chunks of at most a page. Bus pages mapped directly are
+// only current on the bus, anything else is only reachable through the PCI unit's buffer.
+// @param[in] bus
+// @param[in] addr Chunk start address
+// @param[in] end Mapped range end address
+// @param[out] on_bus True if the chunk is an entire bus page, mapped directly
+// @returns Chunk end address
+static u32 snapshot_chunk_end(bus_t* bus, u32 addr, u32 end, b8* on_bus) {
+    u32 page_end = addr | BUS_PAGE_MASK;
+    u32 chunk_end = page_end < end ? page_end : end;
+
+    *on_bus = (addr & BUS_PAGE_MASK) == 0 && chunk_end == page_end && bus_get_page_memory(bus, addr >> BUS_PAGE_BITS) != NULL;
+    return chunk_end;
+}
+
+// Mirrored memory only goes through the bus over its first mirror
+// @returns End address of the bank's window onto the backing buffer
+static u32 snapshot_window_end(const snapshot_pci_t* saved) {
+    u32 size = (u32)(saved->addr_end - saved->addr_start) + 1;
+    return saved->addr_start + (size < saved->mirror_size ? size : saved->mirror_size) - 1;
+}
+
+// @returns Offset into the backing buffer of an address in the bank's window
+static inline u32 snapshot_bank_addr(const snapshot_pci_t* saved, u32 addr) {
+    return saved->bank_offset + (addr - saved->addr_start);
+}
+
+// Find the PCI unit attached at an address
+// @returns Attachment index, `U32_MAX` if there's none
+static u32 snapshot_find_pci(bus_t* bus, u16 addr_start, u16 addr_end) {
+    for (u32 i = 0; i < bus_get_num_pci(bus); i++) {
+        u16 start = 0,
+            end = 0;
+        bus_get_pci(bus, i, &start, &end);
+
+        if (start == addr_start && end == addr_end)
+            return i;
+    }
+
+    return U32_MAX;
+}
+
+// Put a saved memory PCI unit's bank and contents back
+// @param[in] index The PCI unit's attachment index
+// @param[in] tracked Only whole pages marked dirty on the bus need to be restored
+// @param[in] share Share whole pages with the snapshot rather than copying them
+static void snapshot_restore_memory(snapshot_pci_t* saved, bus_t* bus, u32 index, pci_t* pci, b8 tracked, b8 share) {
+    // Switching marks the window's pages dirty, as they now show another part of the buffer
+    if (bus_get_bank(bus, index) != saved->bank_offset)
+        bus_switch_bank(bus, index, saved->bank_offset);
+
+    u32 end = snapshot_window_end(saved);
+    u32 window_start = saved->bank_offset,
+        window_end = snapshot_bank_addr(saved, end) + 1;
+
+    // Outside of the window, the buffer may have changed while banked in without any tracking
+    if (!tracked || !pci->read_only) {
+        memcpy(pci->memory, saved->contents, window_start);
+        memcpy(&pci->memory[window_end], &saved->contents[window_end], pci->memory_size - window_end);
+    }
+
+    for (u32 addr = saved->addr_start, chunk_end; addr <= end; addr = chunk_end + 1) {
+        b8 on_bus;
+        chunk_end = snapshot_chunk_end(bus, addr, end, &on_bus);
+
+        const u8* source = &saved->contents[snapshot_bank_addr(saved, addr)];
+        u32 page = addr >> BUS_PAGE_BITS;
+
+        if (!on_bus)
+            memcpy(&pci->memory[snapshot_bank_addr(saved, addr)], source, chunk_end - addr + 1);
+        else if (share)
+            bus_share_page(bus, page, source);
+        else if (!tracked || bus_test_dirty_page(bus, page))
+            bus_write_page(bus, page, source);
+    }
+}
+
+static void snapshot_restore_cpu(snapshot_t* snapshot, cpu_t* cpu) {
+    cpu->a = snapshot->a;
+    cpu->x = snapshot->x;
+    cpu->y = snapshot->y;
+    cpu->sp = snapshot->sp;
+    cpu_set_status(cpu, snapshot->status);
+    cpu->pc = snapshot->pc;
+    cpu->cycles = snapshot->cycles;
+    cpu->bus_cycle = snapshot->cycles;
+}
+
+
+snapshot_t* snapshot_create(cpu_t* cpu) {
+    snapshot_t* snapshot = (snapshot_t*)calloc(1, sizeof(snapshot_t));
+    bus_t* bus = cpu->bus;
+
+    cpu_get_state(cpu, &snapshot->a, &snapshot->x, &snapshot->y, &snapshot->sp, &snapshot->status, &snapshot->pc, &snapshot->cycles);
+    snapshot->config.backend = cpu->backend;
+    snapshot->config.variant = cpu->ops->variant;
+    snapshot->config.timing = cpu->ops->timing;
+    snapshot->bus = bus;
+
+    snapshot->num_pci = bus_get_num_pci(bus);
+    snapshot->pci = (snapshot_pci_t*)calloc(snapshot->num_pci, sizeof(snapshot_pci_t));
+
+    for (u32 i = 0; i < snapshot->num_pci; i++) {
+        snapshot_pci_t* saved = &snapshot->pci[i];
+        pci_t* pci = bus_get_pci(bus, i, &saved->addr_start, &saved->addr_end);
+        saved->name = pci->name;
+        saved->mirror_size = bus_get_pci_mirror_size(bus, i);
+
+        if (pci->kind == PCI_KIND_MEMORY) {
+            saved->bank_offset = bus_get_bank(bus, i);
+            saved->memory_size = pci->memory_size;
+            saved->read_only = pci->read_only;
+        }
+
+        // ROM images can't change, so there's nothing else to save
+        if (pci->image) {
+            saved->rom = pci_create_rom_shared(pci->name, pci);
+            continue;
+        }
+
+        if (pci->kind == PCI_KIND_MEMORY) {
+            u32 end = snapshot_window_end(saved);
+            saved->contents = (u8*)malloc(pci->memory_size);
+            memcpy(saved->contents, pci->memory, pci->memory_size);
+
+            // Shared pages are only current on the bus, not in the PCI unit's buffer
+            for (u32 addr = saved->addr_start, chunk_end; addr <= end; addr = chunk_end + 1) {
+                b8 on_bus;
+                chunk_end = snapshot_chunk_end(bus, addr, end, &on_bus);
+
+                if (on_bus)
+                    memcpy(&saved->contents[snapshot_bank_addr(saved, addr)], bus_get_page_memory(bus, addr >> BUS_PAGE_BITS), BUS_PAGE_SIZE);
+            }
+        }
+        else if (pci->on_save) {
+            saved->state_size = pci->on_save(pci, NULL);
+            saved->state = malloc(saved->state_size ? saved->state_size : 1);
+            pci->on_save(pci, saved->state);
+        }
+    }
+
+    snapshot->dirty_generation = bus_track_dirty_pages(bus);
+
+    return snapshot;
+}
+
+void snapshot_free(snapshot_t* snapshot) {
+    for (u32 i = 0; i < snapshot->num_pci; i++) {
+        free(snapshot->pci[i].contents);
+        free(snapshot->pci[i].state);
+
+        if (snapshot->pci[i].rom)
+            pci_free(snapshot->pci[i].rom);
+    }
+
+    free(snapshot->pci);
+    free(snapshot);
+}
+
+void snapshot_restore(snapshot_t* snapshot, cpu_t* cpu) {
+    bus_t* bus = cpu->bus;
+    b8 own = bus == snapshot->bus;
+    b8 tracked = own && bus_get_dirty_generation(bus) == snapshot->dirty_generation;
+
+    for (u32 i = 0; i < snapshot->num_pci; i++) {
+        snapshot_pci_t* saved = &snapshot->pci[i];
+        u32 index = own ? i : snapshot_find_pci(bus, saved->addr_start, saved->addr_end);
+        assert(index != U32_MAX);
+        pci_t* pci = bus_get_pci(bus, index, NULL, NULL);
+
+        if (saved->contents)
+            snapshot_restore_memory(saved, bus, index, pci, tracked, !own);
+        else if (saved->rom)
+            bus_switch_bank(bus, index, saved->bank_offset);
+        else if (saved->state && pci->on_restore)
+            pci->on_restore(pci, saved->state, saved->state_size);
+    }
+
+    snapshot_restore_cpu(snapshot, cpu);
+
+    if (own)
+        snapshot->dirty_generation = bus_track_dirty_pages(bus);
+}
+
+cpu_t* snapshot_fork(snapshot_t* snapshot, bus_t* bus) {
+    for (u32 i = 0; i < snapshot->num_pci; i++) {
+        snapshot_pci_t* saved = &snapshot->pci[i];
+
+        if (saved->contents) {
+            pci_t* pci = pci_create_memory(saved->name, saved->memory_size, saved->read_only);
+            bus_attach_pci_mirrored(bus, pci, saved->addr_start, saved->addr_end, saved->mirror_size);
+            bus_adopt_pci(bus, pci);
+
+            snapshot_restore_memory(saved, bus, bus_get_num_pci(bus) - 1, pci, FALSE, TRUE);
+        }
+        else if (saved->rom) {
+            pci_t* pci = pci_create_rom_shared(saved->name, saved->rom);
+            bus_attach_pci_mirrored(bus, pci, saved->addr_start, saved->addr_end, saved->mirror_size);
+            bus_adopt_pci(bus, pci);
+            bus_switch_bank(bus, bus_get_num_pci(bus) - 1, saved->bank_offset);
+        }
+        else if (saved->state) {
+            u32 index = snapshot_find_pci(bus, saved->addr_start, saved->addr_end);
+            pci_t* pci = index != U32_MAX ? bus_get_pci(bus, index, NULL, NULL) : NULL;
+            if (pci && pci->on_restore)
+                pci->on_restore(pci, saved->state, saved->state_size);
+        }
+    }
+
+    cpu_t* cpu = cpu_create_ex(bus, &snapshot->config);
+    snapshot_restore_cpu(snapshot, cpu);
+
+    return cpu;
+}
@@ -0,0 +1,315 @@
+#include "s6502/trace.h"
+
+#include <stdio.h>
+
+// The ring buffer is drained by a writer thread where POSIX threads are available. Without them,
+// recording drains it whenever it fills up.
+#if defined(S6502_THREADS)
+    #define TRACE_WRITER_THREAD 1
+#else
+    #define TRACE_WRITER_THREAD 0
+#endif
+
+#if TRACE_WRITER_THREAD
+    #include <pthread.h>
+    #include <sched.h>
+    #include <time.h>
+#endif
+
+#define TRACE_MAGIC "S6502TR1"
+#define TRACE_MAGIC_SIZE 8
+#define TRACE_CACHE_LINE 64
+#define TRACE_WRITER_IDLE_NS 1000000   // Writer thread sleep while the ring buffer is empty
+
+// Encoded record layout: flags byte, opcode byte, operand bytes (little endian), the PC if it's
+// not the one after the previous instruction, each changed register, then the cycle delta
+// as a zigzag LEB128 (snapshot restores can take the cycle count back).
+#define TRACE_FLAG_OPERAND_SIZE_MASK 0x03
+#define TRACE_FLAG_PC_BIT BIT(2)
+#define TRACE_FLAG_A_BIT BIT(3)
+#define TRACE_FLAG_X_BIT BIT(4)
+#define TRACE_FLAG_Y_BIT BIT(5)
+#define TRACE_FLAG_SP_BIT BIT(6)
+#define TRACE_FLAG_STATUS_BIT BIT(7)
+
+#define TRACE_MAX_RECORD_SIZE (1 + 1 + 2 + 2 + 5 + 10)
+
+// The ring buffer's indices are only ever written by one side each
+#if TRACE_WRITER_THREAD
+    #define TRACE_LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+    #define TRACE_STORE_RELEASE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#else
+    #define TRACE_LOAD_ACQUIRE(ptr) (*(ptr))
+    #define TRACE_STORE_RELEASE(ptr, value) (*(ptr) = (value))
+#endif
+
+struct trace_s {
+    FILE* file;
+#if TRACE_WRITER_THREAD
+    pthread_t writer;
+#endif
+
+    u8* buffer;
+    u32 buffer_mask;
+
+    // Producer side: bytes appended, and the last record encoded against
+    u64 head;
+    u64 num_records;
+    trace_record_t previous;
+    u8 padding0[TRACE_CACHE_LINE];
+
+    // Writer side: bytes written out
+    u64 tail;
+    u8 padding1[TRACE_CACHE_LINE];
+
+    b8 stopping;
+};
+
+struct trace_reader_s {
+    FILE* file;
+    trace_record_t previous;
+};
+
+// Address of the instruction following a record's, where the next record is expected
+static inline u16 trace_next_pc(const trace_record_t* record) {
+    return (u16)(record->pc + 1 + record->operand_size);
+}
+
+// @param[in] previous Last record encoded
+// @param[in] record
+// @param[out] bytes At least `TRACE_MAX_RECORD_SIZE` bytes
+// @returns Encoded size
+static u32 trace_encode(const trace_record_t* previous, const trace_record_t* record, u8* bytes) {
+    u32 size = 2;
+    u8 flags = record->operand_size & TRACE_FLAG_OPERAND_SIZE_MASK;
+
+    bytes[1] = record->opcode;
+
+    for (u32 i = 0; i < record->operand_size; i++)
+        bytes[size++] = (u8)(record->operand >> (i * 8));
+
+    if (record->pc != trace_next_pc(previous)) {
+        flags |= TRACE_FLAG_PC_BIT;
+        bytes[size++] = (u8)record->pc;
+        bytes[size++] = (u8)(record->pc >> 8);
+    }
+
+    #define TRACE_ENCODE_REGISTER(reg, bit) \
+        if (record->reg != previous->reg) { \
+            flags |= bit; \
+            bytes[size++] = record->reg; \
+        }
+    TRACE_ENCODE_REGISTER(a, TRACE_FLAG_A_BIT)
+    TRACE_ENCODE_REGISTER(x, TRACE_FLAG_X_BIT)
+    TRACE_ENCODE_REGISTER(y, TRACE_FLAG_Y_BIT)
+    TRACE_ENCODE_REGISTER(sp, TRACE_FLAG_SP_BIT)
+    TRACE_ENCODE_REGISTER(status, TRACE_FLAG_STATUS_BIT)
+    #undef TRACE_ENCODE_REGISTER
+
+    i64 delta = (i64)(record->cycles - previous->cycles);
+    u64 zigzag = ((u64)delta << 1) ^ (u64)(delta >> 63);
+
+    do {
+        u8 byte = zigzag & 0x7f;
+        zigzag >>= 7;
+        bytes[size++] = zigzag ? byte | 0x80 : byte;
+    } while (zigzag);
+
+    bytes[0] = flags;
+    return size;
+}
+
+// Write out the ring buffer up to `head`
+static void trace_drain(trace_t* trace, u64 head) {
+    u32 buffer_size = trace->buffer_mask + 1;
+    u64 tail = trace->tail;
+
+    u32 start = (u32)tail & trace->buffer_mask;
+    u32 size = (u32)(head - tail);
+    u32 first = size < buffer_size - start ? size : buffer_size - start;
+
+    fwrite(&trace->buffer[start], 1, first, trace->file);
+    fwrite(trace->buffer, 1, size - first, trace->file);
+
+    TRACE_STORE_RELEASE(&trace->tail, head);
+}
+
+#if TRACE_WRITER_THREAD
+
+// Write out the ring buffer as records come in, until the trace is freed and the buffer is empty
+static void* trace_writer_main(void* arg) {
+    trace_t* trace = (trace_t*)arg;
+
+    for (;;) {
+        // Checked before the head, so everything recorded before stopping is seen
+        b8 stopping = TRACE_LOAD_ACQUIRE(&trace->stopping);
+        u64 head = TRACE_LOAD_ACQUIRE(&trace->head);
+
+        if (head == trace->tail) {
+            if (stopping)
+                break;
+
+            struct timespec idle = { 0, TRACE_WRITER_IDLE_NS };
+            nanosleep(&idle, NULL);
+            continue;
+        }
+
+        trace_drain(trace, head);
+    }
+
+    return NULL;
+}
+
+#endif
+
+
+trace_t* trace_create(const char* path, u32 buffer_size) {
+    if (buffer_size == 0)
+        buffer_size = TRACE_DEFAULT_BUFFER_SIZE;
+
+    assert((buffer_size & (buffer_size - 1)) == 0 && buffer_size >= TRACE_MAX_RECORD_SIZE);
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        return NULL;
+
+    fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_SIZE, file);
+
+    trace_t* trace = (trace_t*)calloc(1, sizeof(trace_t));
+    trace->file = file;
+    trace->buffer = (u8*)malloc(buffer_size);
+    trace->buffer_mask = buffer_size - 1;
+
+#if TRACE_WRITER_THREAD
+    if (pthread_create(&trace->writer, NULL, trace_writer_main, trace) != 0) {
+        fclose(file);
+        free(trace->buffer);
+        free(trace);
+        return NULL;
+    }
+#endif
+
+    return trace;
+}
+
+void trace_free(trace_t* trace) {
+#if TRACE_WRITER_THREAD
+    TRACE_STORE_RELEASE(&trace->stopping, TRUE);
+    pthread_join(trace->writer, NULL);
+#else
+    trace_drain(trace, trace->head);
+#endif
+
+    fclose(trace->file);
+    free(trace->buffer);
+    free(trace);
+}
+
+void trace_record(trace_t* trace, const trace_record_t* record) {
+    u8 bytes[TRACE_MAX_RECORD_SIZE];
+    u32 size = trace_encode(&trace->previous, record, bytes);
+    u32 buffer_size = trace->buffer_mask + 1;
+    u64 head = trace->head;
+
+    while (head + size - TRACE_LOAD_ACQUIRE(&trace->tail) > buffer_size) {
+#if TRACE_WRITER_THREAD
+        sched_yield();
+#else
+        trace_drain(trace, head);
+#endif
+    }
+
+    u32 start = (u32)head & trace->buffer_mask;
+    u32 first = size < buffer_size - start ? size : buffer_size - start;
+
+    memcpy(&trace->buffer[start], bytes, first);
+    memcpy(trace->buffer, &bytes[first], size - first);
+
+    TRACE_STORE_RELEASE(&trace->head, head + size);
+    trace->previous = *record;
+    trace->num_records++;
+}
+
+u64 trace_get_num_records(trace_t* trace) {
+    return trace->num_records;
+}
+
+u64 trace_get_num_bytes(trace_t* trace) {
+    return trace->head;
+}
+
+
+trace_reader_t* trace_reader_open(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    char magic[TRACE_MAGIC_SIZE];
+    if (fread(magic, 1, TRACE_MAGIC_SIZE, file) != TRACE_MAGIC_SIZE || memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    trace_reader_t* reader = (trace_reader_t*)calloc(1, sizeof(trace_reader_t));
+    reader->file = file;
+
+    return reader;
+}
+
+void trace_reader_free(trace_reader_t* reader) {
+    fclose(reader->file);
+    free(reader);
+}
+
+b8 trace_reader_next(trace_reader_t* reader, trace_record_t* record) {
+    FILE* file = reader->file;
+    const trace_record_t* previous = &reader->previous;
+
+    int flags = getc(file);
+    int opcode = getc(file);
+    if (flags == EOF || opcode == EOF)
+        return FALSE;
+
+    *record = *previous;
+    record->opcode = (u8)opcode;
+    record->operand_size = flags & TRACE_FLAG_OPERAND_SIZE_MASK;
+    record->operand = 0;
+    record->pc = trace_next_pc(previous);
+
+    // Reads past the end of a truncated record are caught at the cycle delta, which comes last
+    for (u32 i = 0; i < record->operand_size; i++)
+        record->operand |= (u16)((u8)getc(file) << (i * 8));
+
+    if (flags & TRACE_FLAG_PC_BIT) {
+        record->pc = (u8)getc(file);
+        record->pc |= (u16)((u8)getc(file) << 8);
+    }
+
+    #define TRACE_DECODE_REGISTER(reg, bit) \
+        if (flags & bit) \
+            record->reg = (u8)getc(file);
+    TRACE_DECODE_REGISTER(a, TRACE_FLAG_A_BIT)
+    TRACE_DECODE_REGISTER(x, TRACE_FLAG_X_BIT)
+    TRACE_DECODE_REGISTER(y, TRACE_FLAG_Y_BIT)
+    TRACE_DECODE_REGISTER(sp, TRACE_FLAG_SP_BIT)
+    TRACE_DECODE_REGISTER(status, TRACE_FLAG_STATUS_BIT)
+    #undef TRACE_DECODE_REGISTER
+
+    u64 zigzag = 0;
+    int byte;
+    u32 shift = 0;
+
+    do {
+        byte = getc(file);
+        if (byte == EOF || shift >= 64)
+            return FALSE;
+
+        zigzag |= (u64)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    record->cycles = previous->cycles + ((zigzag >> 1) ^ (0 - (zigzag & 1)));
+    reader->previous = *record;
+
+    return TRUE;
+}
@@ -0,0 +1,110 @@
+#include "cpu_internal.h"
+
+#include <stdio.h>
+
+// Build-time generator of the decimal mode tables (`cpu_decimal_tables_t`), written out as a C source file
+// of constant arrays, so the core neither computes them at run time nor needs to synchronize doing so.
+
+static cpu_decimal_tables_t g_nmos;
+static cpu_decimal_tables_t g_65c02;
+
+// @returns N and Z of a result, in their status register positions
+static u8 nz_flags(u8 value) {
+    return (value & CPU_STATUS_FLAG_NEGATIVE_BIT) | (value == 0 ? CPU_STATUS_FLAG_ZERO_BIT : 0);
+}
+
+// Work out every decimal mode outcome digit by digit, as the parts do. Invalid BCD operands
+// get the same (meaningless, but deterministic) results as on hardware.
+// On NMOS parts, ADC takes N and V from the sum before the high digit is adjusted, and Z from the binary sum.
+// SBC sets all flags as in binary mode. The 65C02 subtracts differently, and takes N and Z from the result.
+static void compute_tables() {
+    for (u32 carry = 0; carry < 2; carry++) {
+        for (u32 a = 0; a < 256; a++) {
+            for (u32 m = 0; m < 256; m++) {
+                u32 index = CPU_DECIMAL_INDEX(carry, a, m);
+
+                u32 low = (a & 0x0f) + (m & 0x0f) + carry;
+                if (low >= 0x0a)
+                    low = ((low + 0x06) & 0x0f) + 0x10;
+
+                u32 sum = (a & 0xf0) + (m & 0xf0) + low;
+                u8 flags = (sum & CPU_STATUS_FLAG_NEGATIVE_BIT)
+                    | ((~(a ^ m) & (a ^ sum) & 0x80) >> 1)
+                    | (((a + m + carry) & 0xff) == 0 ? CPU_STATUS_FLAG_ZERO_BIT : 0);
+
+                if (sum >= 0xa0)
+                    sum += 0x60;
+                if (sum >= 0x100)
+                    flags |= CPU_STATUS_FLAG_CARRY_BIT;
+
+                g_nmos.adc[index] = (u16)((flags << 8) | (sum & 0xff));
+
+                flags = (flags & (CPU_STATUS_FLAG_OVERFLOW_BIT | CPU_STATUS_FLAG_CARRY_BIT)) | nz_flags((u8)sum);
+                g_65c02.adc[index] = (u16)((flags << 8) | (sum & 0xff));
+
+                i32 low_diff = (i32)(a & 0x0f) - (i32)(m & 0x0f) + (i32)carry - 1;
+                if (low_diff < 0)
+                    low_diff = ((low_diff - 0x06) & 0x0f) - 0x10;
+
+                i32 diff = (i32)(a & 0xf0) - (i32)(m & 0xf0) + low_diff;
+                if (diff < 0)
+                    diff -= 0x60;
+
+                u32 binary = a + (m ^ 0xff) + carry;
+                flags = (binary & CPU_STATUS_FLAG_NEGATIVE_BIT)
+                    | ((~(a ^ m ^ 0xff) & (a ^ binary) & 0x80) >> 1)
+                    | ((binary & 0xff) == 0 ? CPU_STATUS_FLAG_ZERO_BIT : 0)
+                    | (binary >> 8);
+
+                g_nmos.sbc[index] = (u16)((flags << 8) | (diff & 0xff));
+
+                diff = (i32)a - (i32)m + (i32)carry - 1;
+                if (diff < 0)
+                    diff -= 0x60;
+                if ((i32)(a & 0x0f) - (i32)(m & 0x0f) + (i32)carry - 1 < 0)
+                    diff -= 0x06;
+
+                flags = (flags & (CPU_STATUS_FLAG_OVERFLOW_BIT | CPU_STATUS_FLAG_CARRY_BIT)) | nz_flags((u8)diff);
+                g_65c02.sbc[index] = (u16)((flags << 8) | (diff & 0xff));
+            }
+        }
+    }
+}
+
+static void write_array(FILE* file, const char* field, const u16* entries, u32 count) {
+    fprintf(file, "    .%s = {", field);
+
+    for (u32 i = 0; i < count; i++)
+        fprintf(file, "%s0x%04x,", (i % 16) ? " " : "\n        ", entries[i]);
+
+    fprintf(file, "\n    },\n");
+}
+
+static void write_tables(FILE* file, const char* name, const cpu_decimal_tables_t* tables) {
+    fprintf(file, "\nconst cpu_decimal_tables_t %s = {\n", name);
+    write_array(file, "adc", tables->adc, sizeof(tables->adc) / sizeof(tables->adc[0]));
+    write_array(file, "sbc", tables->sbc, sizeof(tables->sbc) / sizeof(tables->sbc[0]));
+    fprintf(file, "};\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <output.c>\n", argv[0]);
+        return 2;
+    }
+
+    FILE* file = fopen(argv[1], "w");
+    if (file == NULL) {
+        fprintf(stderr, "Can't create %s\n", argv[1]);
+        return 1;
+    }
+
+    compute_tables();
+
+    fprintf(file, "// Generated by s6502-core/tools/decimal_tables.c, do not edit\n");
+    fprintf(file, "#include \"cpu_internal.h\"\n");
+    write_tables(file, "g_cpu_nmos_decimal_tables", &g_nmos);
+    write_tables(file, "g_cpu_65c02_decimal_tables", &g_65c02);
+
+    return fclose(file) == 0 ? 0 : 1;
+}
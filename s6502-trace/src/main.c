@@ -0,0 +1,113 @@
+#include "s6502/cpu.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Renders a binary instruction trace (see `cpu_set_trace`) as text, one instruction per line:
+// cycle count, address, instruction bytes, disassembly, then the registers before it executed.
+// Traces don't record the CPU variant, it's given on the command line (NMOS by default).
+
+// Format an instruction's operand in assembler syntax
+// @param[in] variant CPU variant the trace was recorded on
+// @param[in] record
+// @param[out] text At least 16 characters
+static void format_operand(cpu_variant variant, const trace_record_t* record, char* text) {
+    cpu_instruction_info_t info = cpu_get_variant_instruction_info(variant, record->opcode);
+    u16 operand = record->operand;
+
+    switch (info.address_mode) {
+    case CPU_ADDRESS_MODE_ACCUMULATOR:
+        sprintf(text, "A");
+        break;
+    case CPU_ADDRESS_MODE_ABSOLUTE:
+        sprintf(text, "$%04X", operand);
+        break;
+    case CPU_ADDRESS_MODE_ABSOLUTE_X:
+        sprintf(text, "$%04X,X", operand);
+        break;
+    case CPU_ADDRESS_MODE_ABSOLUTE_Y:
+        sprintf(text, "$%04X,Y", operand);
+        break;
+    case CPU_ADDRESS_MODE_IMMEDIATE:
+        sprintf(text, "#$%02X", operand);
+        break;
+    case CPU_ADDRESS_MODE_ZEROPAGE:
+        sprintf(text, "$%02X", operand);
+        break;
+    case CPU_ADDRESS_MODE_ZEROPAGE_X:
+        sprintf(text, "$%02X,X", operand);
+        break;
+    case CPU_ADDRESS_MODE_ZEROPAGE_Y:
+        sprintf(text, "$%02X,Y", operand);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT:
+        sprintf(text, "($%04X)", operand);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT_X:
+        sprintf(text, "($%02X,X)", operand);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT_Y:
+        sprintf(text, "($%02X),Y", operand);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT_ZEROPAGE:
+        sprintf(text, "($%02X)", operand);
+        break;
+    case CPU_ADDRESS_MODE_INDIRECT_ABSOLUTE_X:
+        sprintf(text, "($%04X,X)", operand);
+        break;
+    case CPU_ADDRESS_MODE_RELATIVE:
+        // Shown as the branch target
+        sprintf(text, "$%04X", (u16)(record->pc + 2 + (i8)operand));
+        break;
+    default:
+        text[0] = '\0';
+    }
+}
+
+int main(int argc, char** argv) {
+    static const char* const variant_names[CPU_VARIANT_COUNT] = { "nmos", "65c02", "2a03" };
+    u32 variant = CPU_VARIANT_NMOS;
+
+    if (argc == 4 && strcmp(argv[1], "--variant") == 0) {
+        while (variant < CPU_VARIANT_COUNT && strcmp(argv[2], variant_names[variant]) != 0)
+            variant++;
+    }
+    else if (argc != 2) {
+        variant = CPU_VARIANT_COUNT;
+    }
+
+    if (variant == CPU_VARIANT_COUNT) {
+        fprintf(stderr, "Usage: %s [--variant nmos|65c02|2a03] <trace file>\n", argv[0]);
+        return 1;
+    }
+
+    const char* path = argv[argc - 1];
+    trace_reader_t* reader = trace_reader_open(path);
+    if (reader == NULL) {
+        fprintf(stderr, "%s: not a trace file\n", path);
+        return 1;
+    }
+
+    trace_record_t record;
+    while (trace_reader_next(reader, &record)) {
+        char bytes[16];
+        char operand[16];
+
+        if (record.operand_size == 2)
+            sprintf(bytes, "%02X %02X %02X", record.opcode, record.operand & 0xff, record.operand >> 8);
+        else if (record.operand_size == 1)
+            sprintf(bytes, "%02X %02X", record.opcode, record.operand);
+        else
+            sprintf(bytes, "%02X", record.opcode);
+
+        format_operand((cpu_variant)variant, &record, operand);
+
+        printf("%12llu  %04X  %-8s  %s %-9s  A:%02X X:%02X Y:%02X SP:%02X P:%02X\n",
+            record.cycles, record.pc, bytes, cpu_get_variant_mnemonic((cpu_variant)variant, record.opcode), operand,
+            record.a, record.x, record.y, record.sp, record.status);
+    }
+
+    trace_reader_free(reader);
+
+    return 0;
+}
@@ -0,0 +1,418 @@
+#include "batch.h"
+#include "s6502/lib/host_time.h"
+#include "s6502/machine_pool.h"
+#include "s6502/pci.h"
+#include "s6502/snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cycles run between stop condition checks, also the machine pool's quantum
+#define BATCH_CHUNK_CYCLES 1000000
+
+#define BATCH_VECTOR_RESET 0xfffc
+#define BATCH_VECTOR_IRQ 0xfffe
+#define BATCH_STACK 0x0100
+
+typedef enum {
+    BATCH_STOP_BUDGET = 0,  // Ran the whole cycle budget
+    BATCH_STOP_TRAP,
+    BATCH_STOP_BRK,
+    BATCH_STOP_SENTINEL,
+    BATCH_STOP_LOAD_FAILED
+} batch_stop_reason;
+
+typedef struct batch_result_s {
+    batch_stop_reason reason;
+    char error[128];    // Why loading failed
+    u64 cycles;
+    double elapsed;     // Host time spent running the machine, in seconds
+    u8 a, x, y, sp, status;
+    u16 pc;
+} batch_result_t;
+
+// A run's machine, as the machine pool's user pointer. Runs go through the pool one chunk at a time.
+typedef struct batch_machine_s {
+    const batch_config_t* config;
+    batch_result_t* result;
+    const u8* memory;
+    u64 start;                  // Cycle count after reset
+    double chunk_time;          // Host time the running chunk started
+    snapshot_t* chunk_start;    // With `stop_on_trap`, the machine at the start of the running chunk
+    i32 brk_handler;            // With `stop_on_brk`, address of the breakpoint on the IRQ/BRK handler, negative for none
+} batch_machine_t;
+
+// Load a run's images into a 64 KiB memory image
+// @returns False if an image can't be read or doesn't fit, with the reason in `result->error`
+static b8 batch_load(const batch_run_t* run, u8* memory, batch_result_t* result) {
+    for (u32 i = 0; i < run->num_images; i++) {
+        const batch_image_t* image = &run->images[i];
+
+        FILE* file = fopen(image->path, "rb");
+        if (file == NULL) {
+            snprintf(result->error, sizeof(result->error), "can't open %s", image->path);
+            return FALSE;
+        }
+
+        // Read one byte past the space left, to tell images that don't fit
+        u32 space = BUS_ADDR_MAX + 1 - image->addr;
+        u8* buffer = (u8*)malloc(space + 1);
+        size_t size = fread(buffer, 1, space + 1, file);
+        fclose(file);
+
+        if (size > space) {
+            snprintf(result->error, sizeof(result->error), "%s doesn't fit at $%04X", image->path, image->addr);
+            free(buffer);
+            return FALSE;
+        }
+
+        memcpy(&memory[image->addr], buffer, size);
+        free(buffer);
+    }
+
+    return TRUE;
+}
+
+// @returns True if the instruction at `pc` jumps or branches to itself with the flags in `status`,
+// so the CPU stays there forever
+static b8 batch_is_trap(const u8* memory, cpu_variant variant, u16 pc, u8 status) {
+    cpu_instruction_info_t info = cpu_get_variant_instruction_info(variant, memory[pc]);
+    u8 lo = memory[(u16)(pc + 1)];
+    u8 hi = memory[(u16)(pc + 2)];
+
+    if (info.opcode == CPU_OPCODE_JMP && info.address_mode == CPU_ADDRESS_MODE_ABSOLUTE)
+        return (u16)(lo | (hi << 8)) == pc;
+
+    // A branch to itself has an offset of -2
+    if (info.address_mode != CPU_ADDRESS_MODE_RELATIVE || lo != 0xfe)
+        return FALSE;
+
+    switch (info.opcode) {
+    case CPU_OPCODE_BPL:
+        return !(status & CPU_STATUS_FLAG_NEGATIVE_BIT);
+    case CPU_OPCODE_BMI:
+        return (status & CPU_STATUS_FLAG_NEGATIVE_BIT) != 0;
+    case CPU_OPCODE_BVC:
+        return !(status & CPU_STATUS_FLAG_OVERFLOW_BIT);
+    case CPU_OPCODE_BVS:
+        return (status & CPU_STATUS_FLAG_OVERFLOW_BIT) != 0;
+    case CPU_OPCODE_BCC:
+        return !(status & CPU_STATUS_FLAG_CARRY_BIT);
+    case CPU_OPCODE_BCS:
+        return (status & CPU_STATUS_FLAG_CARRY_BIT) != 0;
+    case CPU_OPCODE_BNE:
+        return !(status & CPU_STATUS_FLAG_ZERO_BIT);
+    case CPU_OPCODE_BEQ:
+        return (status & CPU_STATUS_FLAG_ZERO_BIT) != 0;
+    case CPU_OPCODE_BRA:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+// @returns True if the CPU is at a trap, see `batch_is_trap`
+static b8 batch_at_trap(cpu_t* cpu, const u8* memory) {
+    u16 pc = 0;
+    u8 status = 0;
+    cpu_get_state(cpu, NULL, NULL, NULL, NULL, &status, &pc, NULL);
+
+    return batch_is_trap(memory, cpu_get_variant(cpu), pc, status);
+}
+
+// Run a chunk that ended in a trap again from its start, up to the first time the CPU reaches the trap
+// @param[in] chunk_start Snapshot taken at the start of the chunk
+// @param[in] end Cycle count the chunk ended at
+static void batch_rewind_to_trap(cpu_t* cpu, snapshot_t* chunk_start, const u8* memory, u64 end) {
+    u16 trap = 0;
+    cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, &trap, NULL);
+
+    b8 added = cpu_add_breakpoint(cpu, trap);
+    snapshot_restore(chunk_start, cpu);
+
+    // Runs are deterministic, so the chunk reaches the trap again. Until then, stores of other values
+    // than the sentinel's stop it too.
+    for (;;) {
+        u64 now = 0;
+        cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, NULL, &now);
+        if (now >= end)
+            break;
+
+        cpu_run(cpu, end - now);
+
+        cpu_stop_t stop;
+        cpu_get_stop(cpu, &stop);
+
+        if (stop.reason == CPU_STOP_NONE || (stop.reason == CPU_STOP_BREAKPOINT && stop.addr == trap && batch_at_trap(cpu, memory)))
+            break;
+    }
+
+    if (added)
+        cpu_remove_breakpoint(cpu, trap);
+}
+
+// Set up a machine for a run
+// @param[out] bus_out The machine's address bus
+// @returns The machine's CPU, NULL if the run's images can't be loaded
+static cpu_t* batch_setup(const batch_config_t* config, const batch_run_t* run, batch_machine_t* machine, bus_t** bus_out) {
+    pci_t* ram = pci_create_memory("RAM", BUS_ADDR_MAX + 1, FALSE);
+    u8* memory = ram->memory;
+
+    if (!batch_load(run, memory, machine->result)) {
+        machine->result->reason = BATCH_STOP_LOAD_FAILED;
+        pci_free(ram);
+        return NULL;
+    }
+
+    if (config->entry >= 0) {
+        memory[BATCH_VECTOR_RESET] = (u8)(config->entry & 0xff);
+        memory[BATCH_VECTOR_RESET + 1] = (u8)(config->entry >> 8);
+    }
+
+    bus_t* bus = bus_create();
+    bus_attach_pci(bus, ram, 0x0000, BUS_ADDR_MAX);
+    bus_adopt_pci(bus, ram);
+
+    cpu_t* cpu = cpu_create_ex(bus, &config->cpu);
+
+    if (config->sentinel_addr >= 0)
+        bus_add_watchpoint(bus, (u16)config->sentinel_addr, (u16)config->sentinel_addr, BUS_WATCH_STORE);
+
+    // Storing the IRQ/BRK vector ends the chunk, so the next one starts with the breakpoint moved
+    if (config->stop_on_brk)
+        bus_add_watchpoint(bus, BATCH_VECTOR_IRQ, BATCH_VECTOR_IRQ + 1, BUS_WATCH_STORE);
+
+    cpu_reset(cpu);
+
+    machine->config = config;
+    machine->memory = memory;
+    machine->brk_handler = -1;
+    cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, NULL, &machine->start);
+
+    *bus_out = bus;
+    return cpu;
+}
+
+// Move the breakpoint on the IRQ/BRK handler to where the vector points now, as images may install it at runtime
+static void batch_update_brk_handler(batch_machine_t* machine, cpu_t* cpu) {
+    const u8* memory = machine->memory;
+    u16 handler = (u16)(memory[BATCH_VECTOR_IRQ] | (memory[BATCH_VECTOR_IRQ + 1] << 8));
+
+    if (machine->brk_handler == handler)
+        return;
+
+    if (machine->brk_handler >= 0)
+        cpu_remove_breakpoint(cpu, (u16)machine->brk_handler);
+
+    cpu_add_breakpoint(cpu, handler);
+    machine->brk_handler = handler;
+}
+
+// @returns True if the CPU stopped at the IRQ/BRK handler because of a BRK. With no interrupt sources,
+// only BRK enters the handler through the vector, but jumps and calls can reach it too. Those don't push P
+// with the B flag set.
+static b8 batch_at_brk(batch_machine_t* machine, cpu_t* cpu, const cpu_stop_t* stop) {
+    if (stop->reason != CPU_STOP_BREAKPOINT || stop->addr != machine->brk_handler)
+        return FALSE;
+
+    u8 sp = 0;
+    cpu_get_state(cpu, NULL, NULL, NULL, &sp, NULL, NULL, NULL);
+
+    u8 pushed = machine->memory[BATCH_STACK | (u8)(sp + 1)];
+    return (pushed & CPU_STATUS_FLAG_BREAK_BIT) != 0;
+}
+
+// Start the next chunk of a run
+// @returns Cycle budget of the chunk, 0 if the run's budget is spent
+static u64 batch_next_chunk(batch_machine_t* machine, cpu_t* cpu) {
+    u64 now = 0;
+    cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, NULL, &now);
+
+    u64 spent = now - machine->start;
+    if (spent >= machine->config->cycles)
+        return 0;
+
+    // A trapped CPU is still at its trap when the chunk ends. Keep the chunk's start, to run it again
+    // up to where the trap was first reached.
+    if (machine->config->stop_on_trap)
+        machine->chunk_start = snapshot_create(cpu);
+
+    if (machine->config->stop_on_brk)
+        batch_update_brk_handler(machine, cpu);
+
+    u64 left = machine->config->cycles - spent;
+    return left < BATCH_CHUNK_CYCLES ? left : BATCH_CHUNK_CYCLES;
+}
+
+// Record the final state of a run
+static void batch_finish(batch_machine_t* machine, cpu_t* cpu) {
+    batch_result_t* result = machine->result;
+
+    u64 now = 0;
+    cpu_get_state(cpu, &result->a, &result->x, &result->y, &result->sp, &result->status, &result->pc, &now);
+    result->cycles = now - machine->start;
+}
+
+// Time a run's chunk, on the machine pool worker about to run it
+static void batch_on_chunk_start(void* user, cpu_t* cpu) {
+    (void)cpu;
+    ((batch_machine_t*)user)->chunk_time = host_time_now();
+}
+
+// Check a run's stop conditions once a chunk has run, on the machine pool worker that ran it
+// @returns Cycle budget of the next chunk, 0 once the run has stopped
+static u64 batch_on_chunk_done(void* user, cpu_t* cpu) {
+    batch_machine_t* machine = (batch_machine_t*)user;
+    const batch_config_t* config = machine->config;
+    batch_result_t* result = machine->result;
+
+    // Chunks are the pool's quanta, so this is the time the worker spent running the machine
+    result->elapsed += host_time_now() - machine->chunk_time;
+
+    cpu_stop_t stop;
+    cpu_get_stop(cpu, &stop);
+
+    if (stop.reason == CPU_STOP_NONE && config->stop_on_trap && batch_at_trap(cpu, machine->memory)) {
+        u64 now = 0;
+        cpu_get_state(cpu, NULL, NULL, NULL, NULL, NULL, NULL, &now);
+        batch_rewind_to_trap(cpu, machine->chunk_start, machine->memory, now);
+        result->reason = BATCH_STOP_TRAP;
+    }
+
+    if (machine->chunk_start) {
+        snapshot_free(machine->chunk_start);
+        machine->chunk_start = NULL;
+    }
+
+    if (batch_at_brk(machine, cpu, &stop))
+        result->reason = BATCH_STOP_BRK;
+    else if (stop.reason == CPU_STOP_WATCHPOINT && stop.addr == config->sentinel_addr && stop.value == config->sentinel_value)
+        result->reason = BATCH_STOP_SENTINEL;
+
+    // Stores of other values than the sentinel's, and to the IRQ/BRK vector, just resume the run
+    u64 next = result->reason == BATCH_STOP_BUDGET ? batch_next_chunk(machine, cpu) : 0;
+    if (next == 0)
+        batch_finish(machine, cpu);
+
+    return next;
+}
+
+// Print a run's result on one line
+static void batch_print_result(const batch_run_t* run, const batch_result_t* result) {
+    if (result->reason == BATCH_STOP_LOAD_FAILED) {
+        printf("%s: load failed, %s\n", run->name, result->error);
+        return;
+    }
+
+    char reason[32];
+    switch (result->reason) {
+    case BATCH_STOP_TRAP:
+        snprintf(reason, sizeof(reason), "trap at $%04X", result->pc);
+        break;
+    case BATCH_STOP_BRK:
+        snprintf(reason, sizeof(reason), "BRK");
+        break;
+    case BATCH_STOP_SENTINEL:
+        snprintf(reason, sizeof(reason), "sentinel");
+        break;
+    default:
+        snprintf(reason, sizeof(reason), "cycle budget");
+        break;
+    }
+
+    double mhz = result->elapsed > 0.0 ? (double)result->cycles / result->elapsed * 1e-6 : 0.0;
+    printf("%s: %s after %llu cycles, %.2f emulated MHz (%.3f s)  A:%02X X:%02X Y:%02X SP:%02X P:%02X PC:%04X\n",
+        run->name, reason, result->cycles, mhz, result->elapsed,
+        result->a, result->x, result->y, result->sp, result->status, result->pc);
+}
+
+
+b8 batch_parse_run(const char* arg, batch_run_t* run) {
+    memset(run, 0, sizeof(batch_run_t));
+    run->name = arg;
+
+    // Split on commas and '@'s in a copy, which the run's paths then point into. It lives as long as the process.
+    size_t size = strlen(arg) + 1;
+    char* copy = (char*)malloc(size);
+    memcpy(copy, arg, size);
+
+    for (char* image = strtok(copy, ","); image; image = strtok(NULL, ",")) {
+        if (run->num_images == BATCH_MAX_IMAGES)
+            return FALSE;
+
+        char* at = strrchr(image, '@');
+        u32 addr = 0;
+
+        if (at) {
+            char* end = NULL;
+            *at = '\0';
+            addr = (u32)strtoul(at + 1, &end, 16);
+
+            if (end == at + 1 || *end != '\0' || addr > BUS_ADDR_MAX)
+                return FALSE;
+        }
+
+        if (image[0] == '\0')
+            return FALSE;
+
+        run->images[run->num_images].path = image;
+        run->images[run->num_images].addr = (u16)addr;
+        run->num_images++;
+    }
+
+    return run->num_images > 0;
+}
+
+u32 batch_execute(const batch_config_t* config, const batch_run_t* runs, u32 num_runs) {
+    batch_result_t* results = (batch_result_t*)calloc(num_runs, sizeof(batch_result_t));
+    batch_machine_t* machines = (batch_machine_t*)calloc(num_runs, sizeof(batch_machine_t));
+
+    // One chunk per quantum, so stop conditions are checked after each
+    machine_pool_config_t pool_config = { .num_threads = config->num_threads, .quantum_cycles = BATCH_CHUNK_CYCLES };
+    machine_pool_t* pool = machine_pool_create(&pool_config);
+
+    double start = host_time_now();
+
+    for (u32 i = 0; i < num_runs; i++) {
+        batch_machine_t* machine = &machines[i];
+        machine->result = &results[i];
+
+        bus_t* bus = NULL;
+        cpu_t* cpu = batch_setup(config, &runs[i], machine, &bus);
+        if (cpu == NULL)
+            continue;
+
+        // The pool skips a run without a budget
+        u64 cycles = batch_next_chunk(machine, cpu);
+        if (cycles == 0)
+            batch_finish(machine, cpu);
+
+        u32 index = machine_pool_add(pool, cpu, bus, cycles, batch_on_chunk_done, machine);
+        machine_pool_set_start_callback(pool, index, batch_on_chunk_start);
+    }
+
+    machine_pool_run(pool);
+
+    double elapsed = host_time_now() - start;
+
+    u32 counts[BATCH_STOP_LOAD_FAILED + 1] = { 0 };
+    u64 cycles = 0;
+
+    for (u32 i = 0; i < num_runs; i++) {
+        batch_print_result(&runs[i], &results[i]);
+        counts[results[i].reason]++;
+        cycles += results[i].cycles;
+    }
+
+    printf("%u runs on %u threads in %.3f s, %.2f emulated MHz in total: %u trapped, %u BRK, %u sentinel, %u ran out of cycles, %u failed to load\n",
+        num_runs, machine_pool_get_num_threads(pool), elapsed, elapsed > 0.0 ? (double)cycles / elapsed * 1e-6 : 0.0,
+        counts[BATCH_STOP_TRAP], counts[BATCH_STOP_BRK], counts[BATCH_STOP_SENTINEL],
+        counts[BATCH_STOP_BUDGET], counts[BATCH_STOP_LOAD_FAILED]);
+
+    machine_pool_free(pool);
+    free(machines);
+    free(results);
+
+    return counts[BATCH_STOP_LOAD_FAILED];
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "s6502/cpu.h"
+
+// Headless batch runs: each run loads binary images into a fresh machine (64 KiB of RAM), resets it
+// through the reset vector and runs it until a stop condition or the end of its cycle budget.
+// Runs go through a machine pool (s6502/machine_pool.h), and are reported in the order they were given.
+
+#define BATCH_MAX_IMAGES 8
+
+// A binary image, loaded at an address
+typedef struct batch_image_s {
+    const char* path;
+    u16 addr;
+} batch_image_t;
+
+typedef struct batch_run_s {
+    const char* name;   // Printed with the results
+    batch_image_t images[BATCH_MAX_IMAGES];
+    u32 num_images;
+} batch_run_t;
+
+// Options shared by every run of a batch
+typedef struct batch_config_s {
+    cpu_config_t cpu;
+    u64 cycles;         // Cycle budget per run
+    i32 entry;          // Reset vector override, negative to keep the images'
+    b8 stop_on_trap;    // Stop on a jump or taken branch to itself
+    b8 stop_on_brk;     // Stop on a BRK entering the IRQ/BRK handler (runs have no interrupt sources)
+    i32 sentinel_addr;  // Stop once `sentinel_value` is stored to this address, negative for none
+    u8 sentinel_value;
+    u32 num_threads;    // Worker threads, 0 for one per online core
+} batch_config_t;
+
+// Parse a run from its command line form, "path[@addr][,path[@addr]...]" with hexadecimal addresses (0 by default)
+// @param[in] arg Command line argument, which must outlive the run
+// @param[out] run
+// @returns False if the argument is malformed
+b8 batch_parse_run(const char* arg, batch_run_t* run);
+
+// Execute every run, then print one line per run and a summary
+// @param[in] config
+// @param[in] runs
+// @param[in] num_runs
+// @returns Number of runs whose images couldn't be loaded
+u32 batch_execute(const batch_config_t* config, const batch_run_t* runs, u32 num_runs);
@@ -1,42 +1,232 @@
+#include "batch.h"
 #include "s6502/cpu.h"
 #include "s6502/pci.h"
 
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 void on_attach(pci_t* pci) {
     printf("PCI attached: %s\n", pci->name);
 }
 
-u8 on_load(pci_t* pci, u16 addr) {
-    printf("PCI on_load: %s %i\n", pci->name, addr);
-    return 1;
+static void usage(const char* program) {
+    fprintf(stderr, "usage: %s [--profile] [--trace <file>] [--break <addr>] [--variant <nmos|65c02|2a03>] [--accurate]\n"
+        "       %s [--jit] [--accurate] [--variant <name>] [--cycles <n>] [--jobs <n>] [--entry <addr>] [--trap] [--brk]\n"
+        "          [--sentinel <addr>=<value>] path[@addr][,path[@addr]...]...\n"
+        "Addresses and values are hexadecimal.\n", program, program);
 }
 
-void on_store(pci_t* pci, u16 addr, u8 value) {
-    printf("PCI on_store: %s %i %i\n", pci->name, addr, value);
+// Parse a whole argument as an unsigned number
+// @param[in] arg
+// @param[in] base
+// @param[in] max Largest value accepted
+// @param[out] value
+// @returns False if the argument is empty, has anything after the number, or the number is above `max`
+static b8 parse_number(const char* arg, int base, u64 max, u64* value) {
+    char* end = NULL;
+
+    if (arg[0] == '\0' || arg[0] == '-' || arg[0] == '+')
+        return FALSE;
+
+    errno = 0;
+    *value = strtoull(arg, &end, base);
+
+    return errno == 0 && *end == '\0' && *value <= max;
 }
 
 int main(int argc, char** argv) {
+    // Without images, runs a built-in demo program:
+    // --profile: print bus accesses after running
+    // --trace <file>: record an instruction trace, rendered as text by s6502-trace
+    // --break <addr>: stop at a breakpoint (hexadecimal address)
+    // --variant <nmos|65c02|2a03>: CPU variant to emulate
+    // --accurate: cycle-accurate bus timing, issuing every dummy access
+    // Every other argument is a headless batch run, "path[@addr][,path[@addr]...]" (see batch.h), with:
+    // --jit: run with the JIT backend
+    // --cycles <n>: cycle budget per run (default 100000000)
+    // --jobs <n>: worker threads (default one per core)
+    // --entry <addr>: override the reset vector
+    // --trap: stop on a jump or branch to itself
+    // --brk: stop on BRK
+    // --sentinel <addr>=<value>: stop once the value is stored to the address (both hexadecimal)
+    static const char* const variant_names[CPU_VARIANT_COUNT] = { "nmos", "65c02", "2a03" };
+
+    b8 profile = FALSE;
+    const char* trace_path = NULL;
+    i32 breakpoint = -1;
+    cpu_config_t config = { 0 };
+
+    batch_config_t batch = { 0 };
+    batch.cycles = 100000000;
+    batch.entry = -1;
+    batch.sentinel_addr = -1;
+
+    batch_run_t* runs = (batch_run_t*)calloc(argc, sizeof(batch_run_t));
+    u32 num_runs = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        u64 value = 0;
+
+        // Options taking a value
+        if (strcmp(option, "--trace") == 0 || strcmp(option, "--break") == 0 || strcmp(option, "--variant") == 0
+            || strcmp(option, "--cycles") == 0 || strcmp(option, "--jobs") == 0 || strcmp(option, "--entry") == 0
+            || strcmp(option, "--sentinel") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "%s expects a value\n", option);
+                usage(argv[0]);
+                return 2;
+            }
+
+            const char* arg = argv[++i];
+            b8 valid = TRUE;
+
+            if (strcmp(option, "--trace") == 0) {
+                trace_path = arg;
+            }
+            else if (strcmp(option, "--break") == 0) {
+                valid = parse_number(arg, 16, BUS_ADDR_MAX, &value);
+                breakpoint = (i32)value;
+            }
+            else if (strcmp(option, "--variant") == 0) {
+                u32 variant = 0;
+
+                while (variant < CPU_VARIANT_COUNT && strcmp(arg, variant_names[variant]) != 0)
+                    variant++;
+
+                valid = variant < CPU_VARIANT_COUNT;
+                config.variant = (cpu_variant)variant;
+            }
+            else if (strcmp(option, "--cycles") == 0) {
+                valid = parse_number(arg, 10, U64_MAX, &batch.cycles);
+            }
+            else if (strcmp(option, "--jobs") == 0) {
+                valid = parse_number(arg, 10, U32_MAX, &value);
+                batch.num_threads = (u32)value;
+            }
+            else if (strcmp(option, "--entry") == 0) {
+                valid = parse_number(arg, 16, BUS_ADDR_MAX, &value);
+                batch.entry = (i32)value;
+            }
+            else {
+                // <addr>=<value>
+                char addr[8] = { 0 };
+                const char* equals = strchr(arg, '=');
+                u64 sentinel_value = 0;
+
+                valid = equals && (size_t)(equals - arg) < sizeof(addr);
+                if (valid) {
+                    memcpy(addr, arg, (size_t)(equals - arg));
+                    valid = parse_number(addr, 16, BUS_ADDR_MAX, &value) && parse_number(equals + 1, 16, U8_MAX, &sentinel_value);
+                }
+
+                batch.sentinel_addr = (i32)value;
+                batch.sentinel_value = (u8)sentinel_value;
+            }
+
+            if (!valid) {
+                fprintf(stderr, "Invalid value %s for %s\n", arg, option);
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (strcmp(option, "--profile") == 0)
+            profile = TRUE;
+        else if (strcmp(option, "--accurate") == 0)
+            config.timing = CPU_TIMING_CYCLE_ACCURATE;
+        else if (strcmp(option, "--jit") == 0)
+            config.backend = CPU_BACKEND_JIT;
+        else if (strcmp(option, "--trap") == 0)
+            batch.stop_on_trap = TRUE;
+        else if (strcmp(option, "--brk") == 0)
+            batch.stop_on_brk = TRUE;
+        else if (strncmp(option, "--", 2) == 0) {
+            fprintf(stderr, "Unknown option %s\n", option);
+            usage(argv[0]);
+            return 2;
+        }
+        else {
+            if (!batch_parse_run(option, &runs[num_runs])) {
+                fprintf(stderr, "Malformed run %s, expected path[@addr][,path[@addr]...]\n", option);
+                return 1;
+            }
+
+            num_runs++;
+        }
+    }
+
+    if (num_runs) {
+        batch.cpu = config;
+        u32 failed = batch_execute(&batch, runs, num_runs);
+        free(runs);
+
+        return failed ? 1 : 0;
+    }
+
+    free(runs);
+
     bus_t* bus = bus_create();
-    cpu_t* cpu = cpu_create(bus);
 
-    u32 word = 0xa9ff0000; // LDA #255
-    cpu_instruction_t inst = cpu_decode(cpu, word);
-    cpu_exec(cpu, inst);
+    pci_t* ram = pci_create_memory("RAM", BUS_ADDR_MAX + 1, FALSE);
+    ram->on_attach = on_attach;
+
+    ram->on_attach(ram);
+    bus_attach_pci(bus, ram, 0x0000, BUS_ADDR_MAX);
+    u8* memory = ram->memory;
+
+    // LDA #255, followed by a NOP sled
+    memset(&memory[0x0200], 0xea, 0x100);
+    memory[0x0200] = 0xa9;
+    memory[0x0201] = 0xff;
+
+    // Reset vector
+    memory[0xfffc] = 0x00;
+    memory[0xfffd] = 0x02;
+
+    if (profile && !bus_enable_profiling(bus, TRUE))
+        fprintf(stderr, "Bus profiling not compiled in (S6502_BUS_PROFILE)\n");
 
-    pci_t pci = {
-        .name = "TestPCI",
-        .on_attach = on_attach,
-        .on_load = on_load,
-        .on_store = on_store
-    };
+    cpu_t* cpu = cpu_create_ex(bus, &config);
 
-    pci.on_attach(&pci);
-    pci.on_load(&pci, 0x1000);
-    pci.on_store(&pci, 0x1000, 1);
+    trace_t* trace = NULL;
+    if (trace_path) {
+        trace = trace_create(trace_path, 0);
+        if (trace == NULL)
+            fprintf(stderr, "Can't create trace file %s\n", trace_path);
+        else if (!cpu_set_trace(cpu, trace))
+            fprintf(stderr, "Tracing not compiled in (S6502_TRACE)\n");
+    }
+
+    if (breakpoint >= 0)
+        cpu_add_breakpoint(cpu, (u16)breakpoint);
+
+    cpu_reset(cpu);
+    cpu_run(cpu, 100);
+
+    cpu_stop_t stop;
+    cpu_get_stop(cpu, &stop);
+    if (stop.reason == CPU_STOP_BREAKPOINT)
+        printf("Stopped at breakpoint 0x%04x\n", stop.addr);
+
+    if (trace) {
+        cpu_set_trace(cpu, NULL);
+        trace_free(trace);
+    }
+
+    if (profile)
+        bus_dump_profile(bus, stdout);
+
+    u8 a = 0;
+    u16 pc = 0;
+    u64 cycles = 0;
+    cpu_get_state(cpu, &a, NULL, NULL, NULL, NULL, &pc, &cycles);
+    printf("A: %i PC: 0x%04x Cycles: %llu\n", a, pc, cycles);
 
     cpu_free(cpu);
     bus_free(bus);
+    pci_free(ram);
 
     return 0;
-}
\ No newline at end of file
+}